@@ -7,7 +7,7 @@
  *
  * CREATED:	    07/15/2017
  *
- * LAST EDITED:	    03/14/2018
+ * LAST EDITED:	    10/14/2026
  ***/
 
 /* TODO: Implement more efficient searching for the hash table */
@@ -24,21 +24,55 @@
 
 #ifdef CONFIG_DEBUG_CHAIN_HASH
 #include <stdio.h>
+
+#include "hash-functions.h"
 #endif
 
 #include <stdlib.h>
 #include <time.h>
 
 #include "chain-hash.h"
-#include "list.h"
+#include "chash-alloc.h"
+#include "chash-bitmap.h"
+#include "chash-clock.h"
+#include "chash-defer.h"
+#include "chash-filter.h"
+#include "chash-image.h"
+#include "chash-internal.h"
+#include "chash-lock.h"
+#include "chash-snap.h"
+#include "chash-stats.h"
+#include "chash-timer.h"
+#include "chash-trace.h"
+#include "open-hash.h"
 
 /******************************************************************************
  * STATIC FUNCTION PROTOTYPES
  ***/
 
+static int size_add(CHash *, int);
+static int put(CHash *, void **, CHashPutMode, void *);
+static int lookup(CHash *, void **, void **);
+static void rehash_start(CHash *);
+static void rehash_step(CHash *);
+static CHashElmt ** find_link(CHash *, const void *, uint64_t);
+static CHashElmt * find_promote(CHash *, const void *, uint64_t);
+static CHashElmt * unlink_first(CHash *, int *);
+static CHashElmt ** first_link(CHash *, unsigned int);
+static void unlink_elmt(CHash *, CHashElmt **);
+static CHashElmt ** link_to(CHash *, CHashElmt *);
+static void drop_elmt(CHash *, CHashElmt *);
+static int migrate_bucket(CHash *, unsigned int);
+static int lookup_unlocked(CHash *, CHashEpoch *, void **, void **);
+static CHashElmt * find_unlocked(CHashElmt **, CHash *, const void *,
+				 uint64_t);
+static CHashElmt * first_unlocked(CHashElmt **, unsigned int);
+static uint64_t scan_step(CHash *, unsigned int);
+static unsigned int scan_bucket(CHash *, uint64_t, unsigned int);
+static void destroy_table(CHash *, CHashElmt **, unsigned int);
+
 #ifdef CONFIG_DEBUG_CHAIN_HASH
 static _Noreturn void error_exit(char * msg);
-static int hash_func(const void *);
 static int match_func(const void *, const void *);
 void print_func(void *);
 #endif
@@ -52,8 +86,9 @@ void print_func(void *);
  *
  * DESCRIPTION:	    Initializes and returns a CHash struct with the parameters.
  *
- * ARGUMENTS:	    size: (int) -- the size of the array. The size will remain
- *			constant if not compiled with CONFIG_DYNAMIC_STRUCTURES
+ * ARGUMENTS:	    size: (int) -- the initial size of the array. The table
+ *			grows and shrinks with the load factor, but never
+ *			shrinks below this size.
  *		    hash: (int (*)(const void *)) -- user-defined hash function
  *		    match: (int (*)(const void *, const void *) -- user defined
  *			function to compare two keys.
@@ -70,25 +105,180 @@ CHash * chash_init(int size,
 		   int (*match)(const void *, const void *),
 		   void (*destroy)(void *))
 {
-  CHash * tbl = malloc(sizeof(CHash));
+  return chash_init_opts(size, hash, match, destroy, NULL);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_init_opts
+ *
+ * DESCRIPTION:	    Initializes and returns a CHash struct with the parameters
+ *		    and the options in opts.
+ *
+ * ARGUMENTS:	    size, hash, match, destroy: same as chash_init.
+ *		    opts: (const CHashOpts *) -- the options, or NULL.
+ *
+ * RETURN:	    Reference to allocated CHash structure.
+ *
+ * NOTES:	    none.
+ ***/
+CHash * chash_init_opts(int size,
+			int (*hash)(const void *),
+			int (*match)(const void *, const void *),
+			void (*destroy)(void *),
+			const CHashOpts * opts)
+{
+  static const CHashOpts defaults = {0};
+  if (opts == NULL)
+    opts = &defaults;
+
+  if (size <= 0 || (hash == NULL && opts->hash64 == NULL) || match == NULL)
+    return NULL;
+
+  if (opts->filter && opts->engine != CHASH_ENGINE_CHAIN)
+    return NULL;
+  if ((opts->capacity || opts->expiry)
+      && (opts->engine != CHASH_ENGINE_CHAIN || opts->intrusive
+	  || opts->concurrency == CHASH_CONCURRENCY_EPOCH))
+    return NULL;
+  if (opts->defer != CHASH_DEFER_NONE
+      && (opts->engine != CHASH_ENGINE_CHAIN || opts->intrusive
+	  || opts->concurrency == CHASH_CONCURRENCY_EPOCH))
+    return NULL;
+  if (opts->defer == CHASH_DEFER_THREAD
+      && opts->concurrency == CHASH_CONCURRENCY_NONE
+      && (opts->allocator != NULL || opts->poolsize))
+    return NULL; /* The collector frees elements with no lock to take. */
+  if (opts->snapshots
+      && (opts->engine != CHASH_ENGINE_CHAIN || opts->intrusive || opts->map
+	  || opts->capacity || opts->expiry
+	  || opts->concurrency == CHASH_CONCURRENCY_EPOCH))
+    return NULL;
+  if (opts->inlinekey
+      && (opts->engine != CHASH_ENGINE_CHAIN || opts->intrusive
+	  || opts->key == NULL))
+    return NULL;
+  if (opts->intrusive && (opts->engine != CHASH_ENGINE_CHAIN || opts->poolsize
+			  || opts->concurrency == CHASH_CONCURRENCY_EPOCH
+			  || opts->map))
+    return NULL;
+
+  CHashIndex index = opts->index;
+  unsigned int stripes = 1;
+  if (opts->concurrency != CHASH_CONCURRENCY_NONE) {
+    if (opts->engine != CHASH_ENGINE_CHAIN)
+      return NULL;
+    if (index == CHASH_INDEX_MODULO)
+      index = CHASH_INDEX_FIBONACCI;
+    while (stripes < (opts->stripes ? opts->stripes : CHASH_DEFAULT_STRIPES))
+      stripes *= 2;
+  }
+
+  unsigned int buckets = size;
+  if (index != CHASH_INDEX_MODULO) {
+    for (buckets = stripes; buckets < (unsigned int)size; buckets *= 2)
+      ;
+  }
+
+  const CHashAllocator libc = {0};
+  const CHashAllocator * allocator = opts->allocator != NULL
+    ? opts->allocator : &libc;
+  CHash * tbl = cmem_alloc(allocator, sizeof(CHash));
 
   if (tbl == NULL)
     return NULL;
 
-  *tbl = (CHash){.buckets = size,
+  *tbl = (CHash){.buckets = buckets,
 		 .hash = hash,
+		 .hash64 = opts->hash64,
+		 .index = index,
 		 .match = match,
 		 .destroy = destroy,
 		 .size = 0,
-		 .table = calloc(size, sizeof(list *))
+		 .table = NULL,
+		 .oldtable = NULL,
+		 .oldbuckets = 0,
+		 .rehashidx = 0,
+		 .minbuckets = buckets,
+		 .maxload = CHASH_DEFAULT_MAX_LOAD,
+		 .minload = CHASH_DEFAULT_MIN_LOAD,
+		 .engine = opts->engine,
+		 .ctrl = NULL,
+		 .slots = NULL,
+		 .values = NULL,
+		 .deleted = 0,
+		 .image = NULL,
+		 .imagebytes = 0,
+		 .allocator = *allocator,
+		 .freelist = NULL,
+		 .slabs = NULL,
+		 .slabsize = opts->poolsize,
+		 .stripes = 1,
+		 .locks = NULL,
+		 .counters = NULL,
+		 .intrusive = opts->intrusive,
+		 .hook = opts->hook,
+		 .reorder = opts->reorder,
+		 .map = opts->map != 0,
+		 .destroy_value = opts->map ? opts->destroy_value : NULL,
+		 .filter = NULL,
+		 .filterbits = opts->filter,
+		 .clock = NULL,
+		 .capacity = opts->capacity,
+		 .wheels = NULL,
+		 .expiry = opts->expiry != 0,
+		 .ttl = opts->ttl,
+		 .now = opts->now,
+		 .deferred = NULL,
+		 .snapshots = NULL,
+		 .inlinekey = opts->inlinekey,
+		 .key = opts->inlinekey ? opts->key : NULL
   };
+  ctrace_init(tbl, opts->trace);
 
-  for (int i = 0; i < size; i++) {
-    if ((tbl->table[i] = list_create(destroy)) == NULL)
-      return NULL; /* TODO: chash_init - Fix in case of mem leak? */
+  if (cstats_init(tbl, opts->concurrency != CHASH_CONCURRENCY_NONE
+		  ? CHASH_STATS_SLOTS : 1)) {
+    cmem_free(allocator, tbl, sizeof(CHash));
+    return NULL;
   }
 
-  return tbl;
+  switch (tbl->engine) {
+  case CHASH_ENGINE_CHAIN:
+    if (tbl->filterbits
+	&& (tbl->filter = cfilter_create(tbl, buckets)) == NULL)
+      break;
+    tbl->table = cmem_calloc(allocator, 1, cbits_table_bytes(buckets));
+    if (tbl->table != NULL) {
+      if (!cstripe_init(tbl, opts->concurrency, stripes)) {
+	if (tbl->capacity == 0 || !cclock_init(tbl, tbl->capacity)) {
+	  if (!tbl->expiry || !ctimer_init(tbl)) {
+	    if (!opts->snapshots || !csnap_init(tbl)) {
+	      if (opts->defer == CHASH_DEFER_NONE
+		  || !cdefer_init(tbl, opts->defer))
+		return tbl;
+	      csnap_destroy(tbl);
+	    }
+	    ctimer_destroy(tbl);
+	  }
+	  cclock_destroy(tbl);
+	}
+	cstripe_destroy(tbl);
+      }
+      cmem_free(allocator, tbl->table, cbits_table_bytes(buckets));
+    }
+    cfilter_free(tbl, tbl->filter);
+    break;
+  case CHASH_ENGINE_OPEN:
+    if (!ohash_init(tbl, size))
+      return tbl;
+    break;
+  case CHASH_ENGINE_IMAGE:
+    break; /* Only chash_load creates these. */
+  }
+
+  cstats_destroy(tbl, opts->concurrency != CHASH_CONCURRENCY_NONE
+		 ? CHASH_STATS_SLOTS : 1);
+  cmem_free(allocator, tbl, sizeof(CHash));
+  return NULL;
 }
 
 /******************************************************************************
@@ -103,22 +293,110 @@ CHash * chash_init(int size,
  * RETURN:	    int -- 0 on success, 1 if the table already contains the
  *		    data, -1 if there is an error..
  *
- * NOTES:	    none.
+ * NOTES:	    New elements always go into tbl->table, even mid-rehash.
  ***/
 int chash_insert(CHash * tbl, const void * data)
 {
-  if (data == NULL)
+  void * copy = (void *)data;
+  return put(tbl, &copy, CHASH_PUT_FIND, NULL);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_find_or_insert
+ *
+ * DESCRIPTION:	    Returns the element matching *data if there is one, and
+ *		    inserts *data otherwise.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (void **) -- the data to insert. Receives the
+ *			element found, if there is one.
+ *
+ * RETURN:	    int -- 0 if *data was inserted, 1 if it was found, -1 if
+ *		    there is an error.
+ *
+ * NOTES:	    Hashes *data once, and walks its bucket once.
+ ***/
+int chash_find_or_insert(CHash * tbl, void ** data)
+{
+  return put(tbl, data, CHASH_PUT_FIND, NULL);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_upsert
+ *
+ * DESCRIPTION:	    Inserts data into the table, replacing the element matching
+ *		    it if there is one.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (const void *) -- the data to insert.
+ *
+ * RETURN:	    int -- 0 if data was inserted, 1 if it replaced an element,
+ *		    -1 if there is an error or tbl is a map.
+ *
+ * NOTES:	    The element replaced is freed with tbl->destroy (if set),
+ *		    unless it is data itself.
+ ***/
+int chash_upsert(CHash * tbl, const void * data)
+{
+  if (tbl->map)
     return -1;
 
-  int bucket = tbl->hash(data) % tbl->buckets;
-  if (tbl->table[bucket] == NULL)
+  void * copy = (void *)data;
+  return put(tbl, &copy, CHASH_PUT_REPLACE, NULL);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_put
+ *
+ * DESCRIPTION:	    Associates value with key in a map table, inserting key if
+ *		    it is not already there.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the map table in question.
+ *		    key: (const void *) -- the key.
+ *		    value: (void *) -- the value.
+ *
+ * RETURN:	    int -- 0 if key was inserted, 1 if the value of a matching
+ *		    key was replaced, -1 if there is an error or tbl is not a
+ *		    map.
+ *
+ * NOTES:	    The value is replaced in place, so the key in the table
+ *		    stays and key is not taken. The old value is freed with
+ *		    tbl->destroy_value (if set) unless it is value itself: after
+ *		    the stripe is unlocked, or a grace period on
+ *		    CHASH_CONCURRENCY_EPOCH tables.
+ ***/
+int chash_put(CHash * tbl, const void * key, void * value)
+{
+  if (!tbl->map)
     return -1;
 
-  list * tmplist = tbl->table[bucket];
-  if (!list_insnxt(tmplist, list_tail(tmplist), data))
-    tbl->size++;
+  void * copy = (void *)key;
+  return put(tbl, &copy, CHASH_PUT_VALUE, value);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_get
+ *
+ * DESCRIPTION:	    Looks up the value associated with key in a map table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the map table in question.
+ *		    key: (const void *) -- the key.
+ *		    value: (void **) -- receives the value, unless NULL.
+ *
+ * RETURN:	    int -- 1 if key was found, 0 if it was not, -1 if key is
+ *		    NULL or tbl is not a map.
+ *
+ * NOTES:	    Takes the same locks as chash_lookup. Only the element is
+ *		    compared during the search; the value is read once it
+ *		    matched.
+ ***/
+int chash_get(CHash * tbl, const void * key, void ** value)
+{
+  if (!tbl->map || key == NULL)
+    return -1;
 
-  return 0;
+  void * copy = (void *)key;
+  return lookup(tbl, &copy, value);
 }
 
 /******************************************************************************
@@ -132,42 +410,150 @@ int chash_insert(CHash * tbl, const void * data)
  *
  * RETURN:	    int -- 0 on success, -1 otherwise.
  *
- * NOTES:	    
+ * NOTES:	    When *data is not NULL, the matching element is freed with
+ *		    tbl->destroy (if set) and *data is left untouched. When
+ *		    *data is NULL, the first element found is unlinked and
+ *		    returned in *data without being destroyed. The value of
+ *		    the element of a map table is destroyed either way. The
+ *		    destroy functions are called after the stripe has been
+ *		    unlocked, or after a grace period on
+ *		    CHASH_CONCURRENCY_EPOCH tables.
  ***/
 int chash_remove(CHash * tbl, void ** data)
 { 
-  if (tbl->size == 0)
+  if (chash_size(tbl) == 0)
     return -1; /* Do not allow removal from an empty list. */
 
-  if (*data != NULL) {
-    int bucket = tbl->hash(*data) % tbl->buckets;
-
-    listelmt * prev = NULL;
-    for (listelmt * elmt = list_head(tbl->table[bucket]);
-	   elmt != NULL; elmt = list_next(elmt)) {
-      if (tbl->match(*data, list_data(elmt))) {
+  if (tbl->engine == CHASH_ENGINE_OPEN)
+    return ohash_remove(tbl, data);
+  if (tbl->engine == CHASH_ENGINE_IMAGE)
+    return -1;
 
-	list_remnxt(tbl->table[bucket], prev, data);
-	tbl->destroy(data);
-	tbl->size--;
-	return 0;
+  rehash_step(tbl);
 
-      }
-      prev = elmt;
+  CHashEpoch * epoch = cstripe_epoch(tbl);
+  CHashElmt * elmt = NULL;
+  int resize = 0;
+  if (*data != NULL) {
+    uint64_t hash = chash_hashof(tbl, *data);
+    unsigned int stripe = cstripe_of_hash(tbl, hash);
+    cstripe_write(tbl, stripe);
+    CHashElmt ** link = tbl->filter == NULL || cfilter_test(tbl->filter, hash)
+      ? find_link(tbl, *data, hash) : NULL;
+    if (link != NULL && !csnap_write(tbl, hash)) {
+      elmt = *link;
+      unlink_elmt(tbl, link);
+      resize = size_add(tbl, -1);
     }
+    cstripe_unlock(tbl, stripe);
+
+    if (elmt == NULL)
+      return -1;
+    if (epoch != NULL)
+      cepoch_retire(tbl, epoch, CEPOCH_ELEMENT, elmt, 0);
+    else
+      drop_elmt(tbl, elmt);
   } else {
-    int i;
-    for (i = 0; i < tbl->buckets; i++)
-      if (list_size(tbl->table[i]) > 0)
-	break;
+    if ((elmt = unlink_first(tbl, &resize)) == NULL)
+      return -1;
+    *data = elmt->data;
+    if (epoch != NULL) {
+      cepoch_retire(tbl, epoch, CEPOCH_NODE, elmt, 0);
+    } else {
+      if (tbl->map)
+	chash_drop_value(tbl, *chash_valueof(elmt));
+      cmem_elmt_put(tbl, elmt);
+    }
+  }
 
-    list_remnxt(tbl->table[i], NULL, data);
-    tbl->size--;
+  cstats_count(tbl, removes, 1);
+  if (resize)
+    rehash_start(tbl);
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_expire
+ *
+ * DESCRIPTION:	    Sets the deadline of the element matching data.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the expiring table in question.
+ *		    data: (const void *) -- the data in question.
+ *		    ttl: (uint64_t) -- milliseconds from now until the element
+ *			expires, or 0 for it to never expire.
+ *
+ * RETURN:	    int -- 0 on success, -1 if no element matches, the element
+ *		    has already expired, or tbl does not expire its elements.
+ *
+ * NOTES:	    Moves the element between the slots of the wheel of its
+ *		    stripe, which takes constant time.
+ ***/
+int chash_expire(CHash * tbl, const void * data, uint64_t ttl)
+{
+  if (tbl->wheels == NULL || data == NULL)
+    return -1;
+
+  uint64_t hash = chash_hashof(tbl, data), now = ctimer_now(tbl);
+  unsigned int stripe = cstripe_of_hash(tbl, hash);
+  cstripe_write(tbl, stripe);
+  CHashElmt ** link = find_link(tbl, data, hash);
+  int result = -1;
+  if (link != NULL && !ctimer_expired(tbl, *link, now)) {
+    ctimer_set(tbl, stripe, *link, ttl != 0 ? now + ttl : 0);
+    result = 0;
+  }
+  cstripe_unlock(tbl, stripe);
+  return result;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_reap
+ *
+ * DESCRIPTION:	    Removes every element whose deadline has passed.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    unsigned int -- the number of elements removed, always 0
+ *		    if tbl does not expire its elements.
+ *
+ * NOTES:	    Advances the wheel of each stripe in turn, with only that
+ *		    stripe held, and destroys the elements it expired once the
+ *		    stripe is released.
+ ***/
+unsigned int chash_reap(CHash * tbl)
+{
+  if (tbl->wheels == NULL)
     return 0;
+
+  uint64_t now = ctimer_now(tbl);
+  unsigned int reaped = 0;
+  int resize = 0;
+  for (unsigned int s = 0; s < tbl->stripes; s++) {
+    cstripe_write(tbl, s);
+    CHashElmt * due = ctimer_advance(tbl, &(tbl->wheels[s]), now);
+    CHashElmt * dead = NULL;
+    while (due != NULL) {
+      CHashElmt * next = chash_timerof(tbl, due)->next;
+      unlink_elmt(tbl, link_to(tbl, due));
+      resize |= size_add(tbl, -1);
+      due->next = dead;
+      dead = due;
+      due = next;
+    }
+    cstripe_unlock(tbl, s);
+
+    while (dead != NULL) {
+      CHashElmt * next = dead->next;
+      drop_elmt(tbl, dead);
+      reaped++;
+      dead = next;
+    }
   }
-  
-  /* If we got to this point, obviously something went wrong. */
-  return -1;
+
+  cstats_count(tbl, expired, reaped);
+  if (resize)
+    rehash_start(tbl);
+  return reaped;
 }
 
 /******************************************************************************
@@ -182,25 +568,189 @@ int chash_remove(CHash * tbl, void ** data)
  *
  * RETURN:	    0 if the table does not contain the data, 1 if it does.
  *
- * NOTES:	    none.
+ * NOTES:	    Only takes the stripe for reading. The bucket is only
+ *		    reordered when that excludes every other thread, as under
+ *		    CHASH_CONCURRENCY_MUTEX. On CHASH_CONCURRENCY_EPOCH tables,
+ *		    takes no lock and leaves the rehash to the writers. When
+ *		    *data is NULL, returns the first element found. Elements
+ *		    past their deadline are not found, but only chash_reap or
+ *		    an insert of the same data unlinks them.
  ***/
 int chash_lookup(CHash * tbl, void ** data)
 {
-  if (*data != NULL) {
-    int bucket = tbl->hash(*data) % tbl->buckets;
+  return lookup(tbl, data, NULL);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_insert_batch
+ *
+ * DESCRIPTION:	    Inserts count elements into the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table to insert into.
+ *		    data: (const void **) -- the data to insert.
+ *		    count: (int) -- the number of elements of data.
+ *
+ * RETURN:	    int -- the number of elements inserted, which stops short
+ *		    of count at the first element that could not be inserted.
+ *
+ * NOTES:	    Works through the batch CHASH_BATCH_WINDOW elements at a
+ *		    time: allocates and hashes them and prefetches their buckets
+ *		    for writing, then links them in and updates the size and
+ *		    load factor once for the window.
+ ***/
+int chash_insert_batch(CHash * tbl, const void ** data, int count)
+{
+  if (tbl->engine != CHASH_ENGINE_CHAIN || tbl->locks != NULL
+      || tbl->clock != NULL || tbl->wheels != NULL
+      || tbl->snapshots != NULL) {
+    int i;
+    for (i = 0; i < count && !chash_insert(tbl, data[i]); i++)
+      ;
+    return i;
+  }
 
-    for (listelmt * elmt = list_head(tbl->table[bucket]);
-	 elmt != NULL; elmt = list_next(elmt)) {
-      if (tbl->match(*data, list_data(elmt))) {
-	*data = list_data(elmt);
-	return 1;
+  int done = 0;
+  while (done < count) {
+    CHashElmt * elmts[CHASH_BATCH_WINDOW];
+    unsigned int buckets[CHASH_BATCH_WINDOW];
+    int n = 0;
+
+    rehash_step(tbl);
+    for (; n < CHASH_BATCH_WINDOW && done + n < count; n++) {
+      if (data[done + n] == NULL
+	  || (elmts[n] = cmem_elmt_get(tbl, data[done + n])) == NULL)
+	break;
+      elmts[n]->hash = chash_hashof(tbl, data[done + n]);
+      buckets[n] = chash_indexof(tbl, elmts[n]->hash, tbl->buckets);
+      __builtin_prefetch(&(tbl->table[buckets[n]]), 1);
+    }
+
+    uint64_t * bits = cbits_of(tbl->table, tbl->buckets);
+    int linked = 0, grow = 0;
+    for (; linked < n; linked++) {
+      CHashElmt * elmt = elmts[linked];
+      if ((tbl->filter == NULL || cfilter_test(tbl->filter, elmt->hash))
+	  && find_link(tbl, data[done + linked], elmt->hash) != NULL)
+	break;
+      grow |= cfilter_add(tbl, elmt->hash);
+      elmt->next = tbl->table[buckets[linked]];
+      tbl->table[buckets[linked]] = elmt;
+      if (elmt->next == NULL)
+	cbits_set(tbl, bits, buckets[linked]);
+    }
+    for (int i = linked; i < n; i++)
+      cmem_elmt_put(tbl, elmts[i]);
+
+    done += linked;
+    cstats_count(tbl, inserts, linked);
+    if (grow)
+      cfilter_grow(tbl);
+    if (size_add(tbl, linked))
+      rehash_start(tbl);
+
+    if (linked < CHASH_BATCH_WINDOW && done < count)
+      break; /* data[done] is NULL, already present, or out of memory. */
+  }
+
+  return done;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_lookup_batch
+ *
+ * DESCRIPTION:	    Queries the table for count elements.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (void **) -- the data in question. Found elements are
+ *			replaced with the stored data.
+ *		    count: (int) -- the number of elements of data.
+ *		    results: (int *) -- if not NULL, receives the result of
+ *			each lookup.
+ *
+ * RETURN:	    int -- the number of elements found.
+ *
+ * NOTES:	    Works through the batch CHASH_BATCH_WINDOW elements at a
+ *		    time, in three passes: hash and prefetch the buckets, then
+ *		    prefetch the first element of each chain, then search. With
+ *		    a filter, its blocks are prefetched first instead, and the
+ *		    keys it rules out are dropped from the later passes.
+ ***/
+int chash_lookup_batch(CHash * tbl, void ** data, int count, int * results)
+{
+  int found = 0;
+  if (tbl->engine != CHASH_ENGINE_CHAIN || tbl->locks != NULL) {
+    for (int i = 0; i < count; i++) {
+      int result = data[i] != NULL && chash_lookup(tbl, &(data[i]));
+      if (results != NULL)
+	results[i] = result;
+      found += result;
+    }
+    return found;
+  }
+
+  uint64_t now = ctimer_now(tbl);
+  for (int done = 0; done < count; done += CHASH_BATCH_WINDOW) {
+    uint64_t hashes[CHASH_BATCH_WINDOW];
+    int maybe[CHASH_BATCH_WINDOW];
+    int n = count - done < CHASH_BATCH_WINDOW
+      ? count - done : CHASH_BATCH_WINDOW;
+
+    rehash_step(tbl);
+    for (int i = 0; i < n; i++) {
+      if (!(maybe[i] = data[done + i] != NULL))
+	continue;
+      hashes[i] = chash_hashof(tbl, data[done + i]);
+      if (tbl->filter != NULL) {
+	__builtin_prefetch(cfilter_block(tbl->filter,
+					 cfilter_mix(hashes[i])));
+	continue;
       }
+      __builtin_prefetch(&(tbl->table[chash_indexof(tbl, hashes[i],
+						    tbl->buckets)]));
+      if (tbl->oldtable != NULL)
+	__builtin_prefetch(&(tbl->oldtable[chash_indexof(tbl, hashes[i],
+							 tbl->oldbuckets)]));
+    }
+
+    for (int i = 0; i < n; i++) {
+      if (!maybe[i])
+	continue;
+      if (tbl->filter != NULL) {
+	if (!(maybe[i] = cfilter_test(tbl->filter, hashes[i])))
+	  continue;
+	if (tbl->oldtable != NULL)
+	  __builtin_prefetch(&(tbl->oldtable[chash_indexof(tbl, hashes[i],
+							   tbl->oldbuckets)]));
+      }
+      CHashElmt * head = tbl->table[chash_indexof(tbl, hashes[i],
+						  tbl->buckets)];
+      if (head != NULL)
+	__builtin_prefetch(head);
+    }
+
+    for (int i = 0; i < n; i++) {
+      CHashElmt * elmt = NULL;
+      if (maybe[i] && tbl->reorder != CHASH_REORDER_NONE
+	  && !csnap_live(tbl))
+	elmt = find_promote(tbl, data[done + i], hashes[i]);
+      else if (maybe[i]) {
+	CHashElmt ** link = find_link(tbl, data[done + i], hashes[i]);
+	elmt = link != NULL ? *link : NULL;
+      }
+      if (elmt != NULL && ctimer_expired(tbl, elmt, now))
+	elmt = NULL;
+      if (elmt != NULL) {
+	cclock_touch(tbl, elmt);
+	data[done + i] = elmt->data;
+	found++;
+      }
+      cstats_lookup(tbl, elmt != NULL);
+      if (results != NULL)
+	results[done + i] = elmt != NULL;
     }
-  } else {
-    *data = list_data(list_head(tbl->table[0]));
-    return 1;
   }
-  return 0;
+
+  return found;
 }
 
 /******************************************************************************
@@ -214,13 +764,137 @@ int chash_lookup(CHash * tbl, void ** data)
  *
  * RETURN:	    void.
  *
- * NOTES:	    none.
+ * NOTES:	    Visits the table one stripe at a time.
  ***/
 void chash_traverse(CHash * tbl, void (*callback)(void *))
 {
-  for (int i = 0; i < tbl->buckets; i++) {
-    list_traverse(tbl->table[i], callback);
+  if (tbl->engine == CHASH_ENGINE_OPEN) {
+    ohash_traverse(tbl, callback);
+    return;
+  }
+  if (tbl->engine == CHASH_ENGINE_IMAGE) {
+    cimage_traverse(tbl, callback);
+    return;
+  }
+
+  for (unsigned int s = 0; s < tbl->stripes; s++) {
+    cstripe_read(tbl, s);
+    if (tbl->oldtable != NULL) {
+      const uint64_t * bits = cbits_of(tbl->oldtable, tbl->oldbuckets);
+      for (unsigned int i = cbits_first(tbl, bits, tbl->oldbuckets, s);
+	   i < tbl->oldbuckets; i = cbits_next(tbl, bits, tbl->oldbuckets, i)) {
+	for (CHashElmt * elmt = tbl->oldtable[i]; elmt != NULL;
+	     elmt = elmt->next)
+	  callback(elmt->data);
+      }
+    }
+
+    const uint64_t * bits = cbits_of(tbl->table, tbl->buckets);
+    for (unsigned int i = cbits_first(tbl, bits, tbl->buckets, s);
+	 i < tbl->buckets; i = cbits_next(tbl, bits, tbl->buckets, i)) {
+      for (CHashElmt * elmt = tbl->table[i]; elmt != NULL; elmt = elmt->next)
+	callback(elmt->data);
+    }
+    cstripe_unlock(tbl, s);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_scan
+ *
+ * DESCRIPTION:	    Calls callback() on the elements of one bucket, and returns
+ *		    a cursor from which to continue.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the hash table in question.
+ *		    cursor: (uint64_t) -- 0 to start a scan, or the value
+ *			returned by the previous call.
+ *		    callback: (void (*)(void *, void *)) -- the callback.
+ *		    arg: (void *) -- passed through to callback.
+ *
+ * RETURN:	    uint64_t -- the cursor for the next call, or 0 when the
+ *		    scan is complete.
+ *
+ * NOTES:	    The cursor is a position in hash space, which the bucket of
+ *		    any size containing it is a prefix of, so the same cursor
+ *		    stays meaningful when the table grows or shrinks. During a
+ *		    rehash, the bucket of the smaller array is visited along
+ *		    with every bucket of the larger one it splits into. Under
+ *		    CHASH_INDEX_FIBONACCI the bucket is the top bits of the
+ *		    hash, so the cursor counts up. Otherwise it is the low bits,
+ *		    and the cursor keeps the bits above minbuckets reversed, as
+ *		    in the SCAN command of Redis. All of these buckets lie in
+ *		    the same stripe, which is the only one held.
+ ***/
+uint64_t chash_scan(CHash * tbl, uint64_t cursor,
+		    void (*callback)(void *, void *), void * arg)
+{
+  if (tbl->engine == CHASH_ENGINE_OPEN)
+    return ohash_scan(tbl, cursor, callback, arg);
+  if (tbl->engine == CHASH_ENGINE_IMAGE)
+    return cimage_scan(tbl, cursor, callback, arg);
+
+  unsigned int stripe = 0;
+  if (tbl->stripes > 1 && tbl->index == CHASH_INDEX_FIBONACCI)
+    stripe = (cursor >> 1) >> (63 - __builtin_ctz(tbl->stripes));
+  else if (tbl->stripes > 1)
+    stripe = (cursor >> 32) & (tbl->stripes - 1);
+  cstripe_read(tbl, stripe);
+
+  CHashElmt ** small = tbl->table, ** large = tbl->oldtable;
+  unsigned int nsmall = tbl->buckets, nlarge = tbl->oldbuckets;
+  if (large != NULL && nlarge < nsmall) {
+    small = tbl->oldtable, nsmall = tbl->oldbuckets;
+    large = tbl->table, nlarge = tbl->buckets;
+  }
+
+  uint64_t step = scan_step(tbl, nsmall);
+  cursor &= ~(step - 1);
+  for (CHashElmt * elmt = small[scan_bucket(tbl, cursor, nsmall)];
+       elmt != NULL; elmt = elmt->next)
+    callback(elmt->data, arg);
+
+  if (large != NULL) {
+    uint64_t substep = scan_step(tbl, nlarge);
+    uint64_t position = cursor;
+    do {
+      for (CHashElmt * elmt = large[scan_bucket(tbl, position, nlarge)];
+	   elmt != NULL; elmt = elmt->next)
+	callback(elmt->data, arg);
+      position += substep;
+    } while (position != cursor + step);
   }
+  cstripe_unlock(tbl, stripe);
+
+  cursor += step;
+  if (tbl->index == CHASH_INDEX_FIBONACCI)
+    return step == 0 ? 0 : cursor;
+  return (cursor >> 32) < tbl->minbuckets ? cursor : 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_set_load_factor
+ *
+ * DESCRIPTION:	    Sets the load factors which trigger an incremental grow or
+ *		    shrink of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table to configure.
+ *		    max: (float) -- grow when size > max * buckets. 0 disables.
+ *		    min: (float) -- shrink when size < min * buckets. 0
+ *			disables.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the factors are invalid.
+ *
+ * NOTES:	    Halving the table doubles its load, so min must be less
+ *		    than max / 2 or the table would oscillate.
+ ***/
+int chash_set_load_factor(CHash * tbl, float max, float min)
+{
+  if (max < 0 || min < 0 || (max > 0 && min * 2 >= max))
+    return -1;
+
+  tbl->maxload = max;
+  tbl->minload = min;
+  return 0;
 }
 
 /******************************************************************************
@@ -235,14 +909,31 @@ void chash_traverse(CHash * tbl, void (*callback)(void *))
  *
  * RETURN:	    void.
  *
- * NOTES:	    none.
+ * NOTES:	    A deferred table first empties its queue, or with a
+ *		    collector thread, leaves the rest to it.
  ***/
 void chash_destroy(CHash * tbl)
 {
-  for (int i = 0; i < tbl->buckets; i++)
-    list_destroy(&(tbl->table[i]));
-  free(tbl->table);
-  free(tbl);
+  if (tbl->deferred != NULL && cdefer_close(tbl))
+    return;
+
+  CHashAllocator allocator = tbl->allocator;
+  cstats_destroy(tbl, tbl->locks != NULL ? CHASH_STATS_SLOTS : 1);
+  if (tbl->engine == CHASH_ENGINE_OPEN) {
+    ohash_destroy(tbl);
+  } else if (tbl->engine == CHASH_ENGINE_IMAGE) {
+    cimage_destroy(tbl);
+  } else {
+    csnap_destroy(tbl);
+    cclock_destroy(tbl);
+    ctimer_destroy(tbl);
+    cstripe_destroy(tbl);
+    destroy_table(tbl, tbl->oldtable, tbl->oldbuckets);
+    destroy_table(tbl, tbl->table, tbl->buckets);
+    cfilter_free(tbl, tbl->filter);
+    cmem_node_release(tbl);
+  }
+  cmem_free(&allocator, tbl, sizeof(CHash));
 }
 
 /******************************************************************************
@@ -252,21 +943,27 @@ void chash_destroy(CHash * tbl)
 #ifdef CONFIG_DEBUG_CHAIN_HASH
 int main(int argc, char * argv[]) {
 
-  CHash * hash = chash_init(10, hash_func, match_func, free);
+  CHash * hash = chash_init(10, chash_hash_int, match_func, free);
   if (hash == NULL)
     error_exit("There was a problem in chash_init");
 
   int * pInt;
+  unsigned int inserted = 0;
 
   srand((unsigned)time(NULL));
   for (int i = 0; i < 10; i++) {
     pInt = malloc(sizeof(int));
     *pInt = rand() % 20;
-    if(chash_insert(hash, (void *)pInt) < 0)
+    int ret = chash_insert(hash, (void *)pInt);
+    if (ret < 0)
       error_exit("There was an error inserting pInt!");
+    else if (ret == 1)
+      free(pInt); /* Duplicates are not inserted. */
+    else
+      inserted++;
   }
 
-  if (chash_size(hash) != 10)
+  if (chash_size(hash) != inserted)
     error_exit("The size isn't right.");
 
   pInt = NULL;
@@ -282,6 +979,957 @@ int main(int argc, char * argv[]) {
  * STATIC FUNCTIONS
  ***/
 
+/******************************************************************************
+ * FUNCTION:	    put
+ *
+ * DESCRIPTION:	    Searches the table for *data, and inserts it if it is not
+ *		    found. Implements chash_insert, chash_find_or_insert,
+ *		    chash_upsert and chash_put.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (void **) -- the data to insert. Receives the element
+ *			found if mode is CHASH_PUT_FIND.
+ *		    mode: (CHashPutMode) -- what is done with an element found.
+ *		    value: (void *) -- the value of *data, on a map table.
+ *
+ * RETURN:	    int -- 0 if *data was inserted, 1 if an element was found,
+ *		    -1 if there is an error.
+ *
+ * NOTES:	    The search and the insertion happen under one hold of the
+ *		    stripe, so two threads can never insert the same data. An
+ *		    element is only allocated once the search misses. On epoch
+ *		    and intrusive tables, a replacement links a new element in
+ *		    place of the old one, which is then retired or destroyed.
+ *		    Otherwise only the data pointer of the element changes. A
+ *		    value is always replaced in place, with a release store
+ *		    for the lookups of epoch tables. Inserting into a full cache
+ *		    table unlinks the victim of the CLOCK hand in the same hold
+ *		    of the stripe, and destroys it once the stripe is released.
+ *		    An expired element is unlinked and destroyed the same way,
+ *		    and *data inserted in its place. Replacing an element or
+ *		    its value restarts its lifetime.
+ ***/
+static int put(CHash * tbl, void ** data, CHashPutMode mode, void * value)
+{
+  if (*data == NULL)
+    return -1;
+
+  if (tbl->engine == CHASH_ENGINE_OPEN)
+    return ohash_put(tbl, data, mode, value);
+  if (tbl->engine == CHASH_ENGINE_IMAGE)
+    return -1;
+
+  rehash_step(tbl);
+
+  CHashEpoch * epoch = cstripe_epoch(tbl);
+  uint64_t hash = chash_hashof(tbl, *data), now = ctimer_now(tbl);
+  unsigned int stripe = cstripe_of_hash(tbl, hash);
+  cstripe_write(tbl, stripe);
+  CHashElmt ** link = tbl->filter == NULL || cfilter_test(tbl->filter, hash)
+    ? find_link(tbl, *data, hash) : NULL;
+  CHashElmt * elmt = NULL, * expired = NULL;
+  if (link != NULL && ctimer_expired(tbl, *link, now)) {
+    /* Dead already: replaced like an element that was never there. */
+    expired = *link;
+    unlink_elmt(tbl, link);
+    size_add(tbl, -1);
+    link = NULL;
+  }
+  if (link != NULL)
+    cclock_touch(tbl, *link);
+  if (link != NULL && mode != CHASH_PUT_FIND)
+    ctimer_set(tbl, stripe, *link, tbl->ttl != 0 ? now + tbl->ttl : 0);
+  if (link != NULL && mode == CHASH_PUT_VALUE) {
+    void * old = __atomic_exchange_n(chash_valueof(*link), value,
+				     __ATOMIC_ACQ_REL);
+    cstripe_unlock(tbl, stripe);
+    if (old != value && old != NULL && tbl->destroy_value != NULL) {
+      if (epoch != NULL)
+	cepoch_retire(tbl, epoch, CEPOCH_VALUE, old, 0);
+      else if (tbl->deferred != NULL)
+	cdefer_data(tbl, NULL, old);
+      else
+	chash_drop_value(tbl, old);
+    }
+    return 1;
+  }
+  if (link != NULL && (mode == CHASH_PUT_FIND || (*link)->data == *data)) {
+    if (mode == CHASH_PUT_FIND)
+      *data = (*link)->data;
+    cstripe_unlock(tbl, stripe);
+    return 1;
+  }
+  if (csnap_write(tbl, hash)) {
+    cstripe_unlock(tbl, stripe);
+    return -1; /* The bucket could not be saved for a snapshot. */
+  }
+
+  if (link == NULL || epoch != NULL || tbl->intrusive
+      || tbl->snapshots != NULL) {
+    if ((elmt = cmem_elmt_get(tbl, *data)) == NULL) {
+      cstripe_unlock(tbl, stripe);
+      if (expired != NULL)
+	drop_elmt(tbl, expired);
+      return -1;
+    }
+    elmt->hash = hash;
+    if (mode == CHASH_PUT_VALUE)
+      *chash_valueof(elmt) = value;
+  }
+
+  if (link != NULL) {
+    CHashElmt * old = *link;
+    void * olddata = old->data;
+    if (elmt != NULL) {
+      elmt->next = old->next;
+      __atomic_store_n(link, elmt, __ATOMIC_RELEASE);
+    } else {
+      old->data = *data;
+    }
+    cstripe_unlock(tbl, stripe);
+
+    if (epoch != NULL) {
+      cepoch_retire(tbl, epoch, CEPOCH_ELEMENT, old, 0);
+    } else if (tbl->snapshots != NULL) {
+      drop_elmt(tbl, old);
+    } else {
+      if (tbl->destroy != NULL && tbl->deferred != NULL)
+	cdefer_data(tbl, olddata, NULL);
+      else
+	chash_drop_data(tbl, olddata);
+      if (elmt != NULL)
+	cmem_elmt_put(tbl, old);
+    }
+    return 1;
+  }
+
+  /* A full cache makes room in the stripe before the element joins it. */
+  CHashElmt * victim = cclock_victim(tbl, stripe);
+  if (victim != NULL)
+    unlink_elmt(tbl, link_to(tbl, victim));
+  cclock_link(tbl, stripe, elmt);
+  ctimer_start(tbl, stripe, elmt, now);
+
+  /* Counted before it is published, so a lookup finding it passes the
+     filter. */
+  int grow = cfilter_add(tbl, hash);
+  unsigned int bucket = chash_indexof(tbl, hash, tbl->buckets);
+  elmt->next = tbl->table[bucket];
+  __atomic_store_n(&(tbl->table[bucket]), elmt, __ATOMIC_RELEASE);
+  if (elmt->next == NULL)
+    cbits_set(tbl, cbits_of(tbl->table, tbl->buckets), bucket);
+  int resize = victim == NULL ? size_add(tbl, 1) : 0;
+  cstripe_unlock(tbl, stripe);
+  cstats_count(tbl, inserts, 1);
+
+  if (victim != NULL) {
+    drop_elmt(tbl, victim);
+    cstats_count(tbl, evictions, 1);
+  }
+  if (expired != NULL) {
+    drop_elmt(tbl, expired);
+    cstats_count(tbl, expired, 1);
+  }
+
+  if (grow)
+    cfilter_grow(tbl);
+  if (resize)
+    rehash_start(tbl);
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    lookup
+ *
+ * DESCRIPTION:	    Queries the table for *data. Implements chash_lookup and
+ *		    chash_get.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (void **) -- the data in question.
+ *		    value: (void **) -- receives the value of the element found
+ *			on a map table, unless NULL.
+ *
+ * RETURN:	    int -- 0 if the table does not contain the data, 1 if it
+ *		    does.
+ *
+ * NOTES:	    See chash_lookup.
+ ***/
+static int lookup(CHash * tbl, void ** data, void ** value)
+{
+  if (tbl->engine == CHASH_ENGINE_OPEN)
+    return ohash_lookup(tbl, data, value);
+  if (tbl->engine == CHASH_ENGINE_IMAGE)
+    return cimage_lookup(tbl, data);
+
+  CHashEpoch * epoch = cstripe_epoch(tbl);
+  if (epoch != NULL) {
+    int found = lookup_unlocked(tbl, epoch, data, value);
+    cstats_lookup(tbl, found);
+    return found;
+  }
+
+  rehash_step(tbl);
+
+  int found = 0;
+  if (*data != NULL) {
+    uint64_t hash = chash_hashof(tbl, *data), now = ctimer_now(tbl);
+    unsigned int stripe = cstripe_of_hash(tbl, hash);
+    cstripe_read(tbl, stripe);
+    if (tbl->filter != NULL && !cfilter_test(tbl->filter, hash)) {
+      /* Never inserted: the bucket is not even read. */
+    } else if (tbl->reorder != CHASH_REORDER_NONE
+	       && cstripe_exclusive(tbl) && !csnap_live(tbl)) {
+      CHashElmt * elmt = find_promote(tbl, *data, hash);
+      if (elmt != NULL && !ctimer_expired(tbl, elmt, now)) {
+	cclock_touch(tbl, elmt);
+	*data = elmt->data;
+	found = 1;
+	if (value != NULL)
+	  *value = __atomic_load_n(chash_valueof(elmt), __ATOMIC_ACQUIRE);
+      }
+    } else {
+      CHashElmt ** link = find_link(tbl, *data, hash);
+      if (link != NULL && !ctimer_expired(tbl, *link, now)) {
+	cclock_touch(tbl, *link);
+	*data = (*link)->data;
+	found = 1;
+	if (value != NULL)
+	  *value = __atomic_load_n(chash_valueof(*link), __ATOMIC_ACQUIRE);
+      }
+    }
+    cstripe_unlock(tbl, stripe);
+  } else {
+    for (unsigned int s = 0; !found && s < tbl->stripes; s++) {
+      cstripe_read(tbl, s);
+      CHashElmt ** link = first_link(tbl, s);
+      if (link != NULL) {
+	*data = (*link)->data;
+	found = 1;
+	if (value != NULL)
+	  *value = __atomic_load_n(chash_valueof(*link), __ATOMIC_ACQUIRE);
+      }
+      cstripe_unlock(tbl, s);
+    }
+  }
+  cstats_lookup(tbl, found);
+  return found;
+}
+
+/******************************************************************************
+ * FUNCTION:	    size_add
+ *
+ * DESCRIPTION:	    Adjusts the size of the table after an insertion or a
+ *		    removal, and reports whether the table should be resized.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    delta: (int) -- 1 for an insertion, -1 for a removal.
+ *
+ * RETURN:	    int -- 1 if the new size crosses a load factor.
+ *
+ * NOTES:	    Must be called with a stripe of the table held, so that the
+ *		    bucket arrays cannot change underneath it.
+ ***/
+static int size_add(CHash * tbl, int delta)
+{
+  unsigned int size = __atomic_add_fetch(&(tbl->size), delta,
+					 __ATOMIC_RELAXED);
+  if (tbl->oldtable != NULL)
+    return 0;
+
+  if (delta > 0)
+    return tbl->maxload > 0 && size > tbl->maxload * tbl->buckets;
+  return tbl->minload > 0 && tbl->buckets > tbl->minbuckets
+    && size < tbl->minload * tbl->buckets;
+}
+
+/******************************************************************************
+ * FUNCTION:	    rehash_start
+ *
+ * DESCRIPTION:	    Begins an incremental rehash of the table, doubling it if
+ *		    it is above its maximum load factor, or halving it if it is
+ *		    below its minimum.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table to resize.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    If another thread is already resizing, or the new array
+ *		    cannot be allocated, the table simply stays at its current
+ *		    size. Must be called with no stripe held.
+ ***/
+static void rehash_start(CHash * tbl)
+{
+  if (!cstripe_rehash_trylock(tbl))
+    return;
+
+  /* The bucket arrays can only change with the rehash lock held. */
+  unsigned int buckets = 0, size = chash_size(tbl);
+  if (tbl->oldtable != NULL)
+    buckets = 0;
+  else if (tbl->maxload > 0 && size > tbl->maxload * tbl->buckets)
+    buckets = tbl->buckets * 2;
+  else if (tbl->minload > 0 && tbl->buckets > tbl->minbuckets
+	   && size < tbl->minload * tbl->buckets)
+    buckets = tbl->buckets / 2 < tbl->minbuckets
+      ? tbl->minbuckets : tbl->buckets / 2;
+
+  uint64_t start = ctrace_start(tbl);
+  CHashElmt ** table = NULL;
+  if (buckets != 0)
+    table = cmem_calloc(&(tbl->allocator), 1, cbits_table_bytes(buckets));
+
+  if (table != NULL) {
+    cstripe_write_all(tbl);
+    if (csnap_live(tbl)) {
+      /* Snapshots read the arrays in place. Resize once they are gone. */
+      cstripe_unlock_all(tbl);
+      cmem_free(&(tbl->allocator), table, cbits_table_bytes(buckets));
+      cstripe_rehash_unlock(tbl);
+      return;
+    }
+    unsigned int from = tbl->buckets;
+    cepoch_swap_begin(cstripe_epoch(tbl));
+    __atomic_store_n(&(tbl->oldtable), tbl->table, __ATOMIC_RELAXED);
+    __atomic_store_n(&(tbl->oldbuckets), tbl->buckets, __ATOMIC_RELAXED);
+    tbl->rehashidx = 0;
+    __atomic_store_n(&(tbl->table), table, __ATOMIC_RELAXED);
+    __atomic_store_n(&(tbl->buckets), buckets, __ATOMIC_RELAXED);
+    cepoch_swap_end(cstripe_epoch(tbl));
+    cstripe_unlock_all(tbl);
+    ctrace_resize(tbl, from, buckets, start);
+  }
+  cstripe_rehash_unlock(tbl);
+}
+
+/******************************************************************************
+ * FUNCTION:	    rehash_step
+ *
+ * DESCRIPTION:	    Migrates up to CHASH_REHASH_STEP non-empty buckets from
+ *		    tbl->oldtable into tbl->table. Finishes the rehash when the
+ *		    old array has been drained.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table being rehashed.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    At most ten empty buckets are visited per bucket moved, so
+ *		    a sparse table still does a bounded amount of work per call.
+ *		    Elements are relinked using their stored hash, so neither
+ *		    tbl->hash nor the allocator is called. Each old bucket only
+ *		    needs its own stripe, since its elements all land in
+ *		    buckets of the same stripe. Must be called with no stripe
+ *		    held. On CHASH_CONCURRENCY_EPOCH tables, the old elements
+ *		    and array are retired rather than freed.
+ ***/
+static void rehash_step(CHash * tbl)
+{
+  if (__atomic_load_n(&(tbl->oldtable), __ATOMIC_RELAXED) == NULL)
+    return;
+
+  if (!cstripe_rehash_trylock(tbl))
+    return;
+
+  CHashEpoch * epoch = cstripe_epoch(tbl);
+  int moved = 0, empty = CHASH_REHASH_STEP * 10;
+  while (tbl->oldtable != NULL && moved < CHASH_REHASH_STEP
+	 && tbl->rehashidx < tbl->oldbuckets) {
+    unsigned int stripe = cstripe_of_bucket(tbl, tbl->rehashidx,
+					    tbl->oldbuckets);
+    cstripe_write(tbl, stripe);
+    CHashElmt * chain = tbl->oldtable[tbl->rehashidx];
+    int found = csnap_live(tbl) ? -1 : migrate_bucket(tbl, tbl->rehashidx);
+    cstripe_unlock(tbl, stripe);
+
+    if (found < 0)
+      break; /* Out of memory for the copies, or snapshots are live. */
+    tbl->rehashidx++;
+    if (found) {
+      moved++;
+      if (epoch != NULL)
+	cepoch_retire(tbl, epoch, CEPOCH_CHAIN, chain, 0);
+    } else if (--empty == 0) {
+      break;
+    }
+  }
+
+  if (tbl->oldtable != NULL && tbl->rehashidx >= tbl->oldbuckets) {
+    cstripe_write_all(tbl);
+    if (csnap_live(tbl)) {
+      cstripe_unlock_all(tbl);
+      cstripe_rehash_unlock(tbl);
+      return;
+    }
+    CHashElmt ** oldtable = tbl->oldtable;
+    size_t bytes = cbits_table_bytes(tbl->oldbuckets);
+    cepoch_swap_begin(epoch);
+    __atomic_store_n(&(tbl->oldtable), NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&(tbl->oldbuckets), 0, __ATOMIC_RELAXED);
+    tbl->rehashidx = 0;
+    cepoch_swap_end(epoch);
+    cstripe_unlock_all(tbl);
+
+    if (epoch != NULL)
+      cepoch_retire(tbl, epoch, CEPOCH_ARRAY, oldtable, bytes);
+    else
+      cmem_free(&(tbl->allocator), oldtable, bytes);
+  }
+  cstripe_rehash_unlock(tbl);
+}
+
+/******************************************************************************
+ * FUNCTION:	    migrate_bucket
+ *
+ * DESCRIPTION:	    Moves the elements of one bucket of tbl->oldtable into
+ *		    tbl->table, and empties the old bucket.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table being rehashed, with the stripe
+ *			of the bucket held.
+ *		    index: (unsigned int) -- the bucket of tbl->oldtable.
+ *
+ * RETURN:	    int -- 1 if elements were moved, 0 if the bucket was empty,
+ *		    -1 if the bucket could not be moved.
+ *
+ * NOTES:	    Lookups on a CHASH_CONCURRENCY_EPOCH table may be walking
+ *		    the old chain, so it is copied into the new array and left
+ *		    intact for the caller to retire. The copies are published
+ *		    before the old bucket is emptied, so a lookup checking the
+ *		    old array and then the new one always finds the element.
+ ***/
+static int migrate_bucket(CHash * tbl, unsigned int index)
+{
+  CHashElmt * elmt = tbl->oldtable[index];
+  if (elmt == NULL)
+    return 0;
+
+  if (cstripe_epoch(tbl) != NULL) {
+    CHashElmt * copies = NULL;
+    for (; elmt != NULL; elmt = elmt->next) {
+      CHashElmt * copy = cmem_node_alloc(tbl);
+      if (copy == NULL) {
+	while (copies != NULL) {
+	  CHashElmt * next = copies->next;
+	  cmem_node_free(tbl, copies);
+	  copies = next;
+	}
+	return -1;
+      }
+      *copy = (CHashElmt){.next = copies, .hash = elmt->hash,
+			  .data = elmt->data};
+      if (tbl->map)
+	*chash_valueof(copy) = *chash_valueof(elmt);
+      if (tbl->inlinekey != 0)
+	memcpy(chash_inlineof(tbl, copy), chash_inlineof(tbl, elmt),
+	       chash_inlinesize(tbl));
+      copies = copy;
+    }
+    elmt = copies;
+  }
+
+  uint64_t * bits = cbits_of(tbl->table, tbl->buckets);
+  while (elmt != NULL) {
+    CHashElmt * next = elmt->next;
+    unsigned int bucket = chash_indexof(tbl, elmt->hash, tbl->buckets);
+    elmt->next = tbl->table[bucket];
+    __atomic_store_n(&(tbl->table[bucket]), elmt, __ATOMIC_RELEASE);
+    if (elmt->next == NULL)
+      cbits_set(tbl, bits, bucket);
+    elmt = next;
+  }
+  __atomic_store_n(&(tbl->oldtable[index]), NULL, __ATOMIC_RELEASE);
+  cbits_clear(tbl, cbits_of(tbl->oldtable, tbl->oldbuckets), index);
+  return 1;
+}
+
+/******************************************************************************
+ * FUNCTION:	    lookup_unlocked
+ *
+ * DESCRIPTION:	    The lookup of a CHASH_CONCURRENCY_EPOCH table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    epoch: (CHashEpoch *) -- its epoch state.
+ *		    data: (void **) -- the data in question.
+ *		    value: (void **) -- as for lookup.
+ *
+ * RETURN:	    int -- 0 if the table does not contain the data, 1 if it
+ *		    does.
+ *
+ * NOTES:	    Reads the bucket arrays under a sequence count, since they
+ *		    are replaced by writers as a group. A miss is only trusted
+ *		    if the arrays were not replaced during the search; a stale
+ *		    array may have been drained into a newer one.
+ ***/
+static int lookup_unlocked(CHash * tbl, CHashEpoch * epoch, void ** data,
+			   void ** value)
+{
+  uint64_t hash = *data != NULL ? chash_hashof(tbl, *data) : 0;
+  unsigned int ticket = cepoch_enter(epoch);
+
+  /* The filter is replaced whole, and retired like a bucket array. */
+  CHashFilter * filter = __atomic_load_n(&(tbl->filter), __ATOMIC_ACQUIRE);
+  if (*data != NULL && filter != NULL && !cfilter_test(filter, hash)) {
+    cepoch_exit(epoch, ticket);
+    return 0;
+  }
+
+  CHashElmt * elmt;
+  unsigned int seq;
+  do {
+    CHashElmt ** table, ** oldtable;
+    unsigned int buckets, oldbuckets;
+    do {
+      while ((seq = __atomic_load_n(&(epoch->seq), __ATOMIC_ACQUIRE)) & 1)
+	;
+      oldtable = __atomic_load_n(&(tbl->oldtable), __ATOMIC_RELAXED);
+      oldbuckets = __atomic_load_n(&(tbl->oldbuckets), __ATOMIC_RELAXED);
+      table = __atomic_load_n(&(tbl->table), __ATOMIC_RELAXED);
+      buckets = __atomic_load_n(&(tbl->buckets), __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&(epoch->seq), __ATOMIC_RELAXED) != seq);
+
+    if (*data == NULL) {
+      elmt = NULL;
+      if (oldtable != NULL)
+	elmt = first_unlocked(oldtable, oldbuckets);
+      if (elmt == NULL)
+	elmt = first_unlocked(table, buckets);
+    } else {
+      elmt = NULL;
+      if (oldtable != NULL)
+	elmt = find_unlocked(&(oldtable[chash_indexof(tbl, hash, oldbuckets)]),
+			     tbl, *data, hash);
+      if (elmt == NULL)
+	elmt = find_unlocked(&(table[chash_indexof(tbl, hash, buckets)]), tbl,
+			     *data, hash);
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (elmt == NULL
+	   && __atomic_load_n(&(epoch->seq), __ATOMIC_RELAXED) != seq);
+
+  if (elmt != NULL) {
+    *data = elmt->data;
+    if (value != NULL)
+      *value = __atomic_load_n(chash_valueof(elmt), __ATOMIC_ACQUIRE);
+  }
+  cepoch_exit(epoch, ticket);
+  return elmt != NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    find_unlocked
+ *
+ * DESCRIPTION:	    Searches a chain which writers may be changing.
+ *
+ * ARGUMENTS:	    link: (CHashElmt **) -- the bucket holding the chain.
+ *		    tbl: (CHash *) -- the table in question.
+ *		    data: (const void *) -- the data to compare against.
+ *		    hash: (uint64_t) -- the hash of data.
+ *
+ * RETURN:	    CHashElmt * -- the matching element, or NULL.
+ *
+ * NOTES:	    Every link is loaded with acquire semantics, pairing with
+ *		    the release stores that publish it.
+ ***/
+static CHashElmt * find_unlocked(CHashElmt ** link, CHash * tbl,
+				 const void * data, uint64_t hash)
+{
+  CHashKey key = {NULL, 0};
+  CHashElmt * elmt;
+  unsigned int probes = 0;
+  while ((elmt = __atomic_load_n(link, __ATOMIC_ACQUIRE)) != NULL) {
+    probes++;
+    if (chash_matches(tbl, &key, data, hash, elmt))
+      break;
+    link = &(elmt->next);
+  }
+  cstats_count(tbl, probes, probes);
+  ctrace_probe(tbl, hash, probes);
+  return elmt;
+}
+
+/******************************************************************************
+ * FUNCTION:	    find_link
+ *
+ * DESCRIPTION:	    Searches the table for an element matching data. Stored
+ *		    hashes are compared first, then inline keys, if any, so
+ *		    tbl->match is only called on elements whose hash is equal
+ *		    to that of data, and whose key might be.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (const void *) -- the data to search for.
+ *		    hash: (uint64_t) -- the hash of data.
+ *
+ * RETURN:	    CHashElmt ** -- the link pointing to the matching element,
+ *		    so that the caller may unlink it, or NULL if not found.
+ *
+ * NOTES:	    Searches tbl->oldtable as well while the table is being
+ *		    rehashed.
+ ***/
+static CHashElmt ** find_link(CHash * tbl, const void * data,
+			      uint64_t hash)
+{
+  CHashKey key = {NULL, 0};
+  unsigned int probes = 0;
+  if (tbl->oldtable != NULL) {
+    unsigned int bucket = chash_indexof(tbl, hash, tbl->oldbuckets);
+    for (CHashElmt ** link = &(tbl->oldtable[bucket]);
+	 *link != NULL; link = &((*link)->next)) {
+      probes++;
+      if (chash_matches(tbl, &key, data, hash, *link)) {
+	cstats_count(tbl, probes, probes);
+	ctrace_probe(tbl, hash, probes);
+	return link;
+      }
+    }
+  }
+
+  for (CHashElmt ** link = &(tbl->table[chash_indexof(tbl, hash,
+							tbl->buckets)]);
+       *link != NULL; link = &((*link)->next)) {
+    probes++;
+    if (chash_matches(tbl, &key, data, hash, *link)) {
+      cstats_count(tbl, probes, probes);
+      ctrace_probe(tbl, hash, probes);
+      return link;
+    }
+  }
+
+  cstats_count(tbl, probes, probes);
+  ctrace_probe(tbl, hash, probes);
+  return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    find_promote
+ *
+ * DESCRIPTION:	    Searches the table like find_link, then moves the matching
+ *		    element toward the head of its bucket according to
+ *		    tbl->reorder.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question, with its stripe
+ *			held exclusively.
+ *		    data: (const void *) -- the data to search for.
+ *		    hash: (uint64_t) -- the hash of data.
+ *
+ * RETURN:	    CHashElmt * -- the matching element, or NULL if not found.
+ *
+ * NOTES:	    An element is promoted within the bucket array it is in,
+ *		    so reordering never interferes with a rehash.
+ ***/
+static CHashElmt * find_promote(CHash * tbl, const void * data,
+				uint64_t hash)
+{
+  CHashKey key = {NULL, 0};
+  unsigned int probes = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    CHashElmt ** head;
+    if (pass == 0 && tbl->oldtable == NULL)
+      continue;
+    else if (pass == 0)
+      head = &(tbl->oldtable[chash_indexof(tbl, hash, tbl->oldbuckets)]);
+    else
+      head = &(tbl->table[chash_indexof(tbl, hash, tbl->buckets)]);
+
+    for (CHashElmt ** prev = NULL, ** link = head; *link != NULL;
+	 prev = link, link = &((*link)->next)) {
+      CHashElmt * elmt = *link;
+      probes++;
+      if (!chash_matches(tbl, &key, data, hash, elmt))
+	continue;
+
+      if (prev != NULL) {
+	*link = elmt->next;
+	if (tbl->reorder == CHASH_REORDER_MTF)
+	  prev = head;
+	elmt->next = *prev;
+	*prev = elmt;
+      }
+      cstats_count(tbl, probes, probes);
+      ctrace_probe(tbl, hash, probes);
+      return elmt;
+    }
+  }
+
+  cstats_count(tbl, probes, probes);
+  ctrace_probe(tbl, hash, probes);
+  return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    unlink_first
+ *
+ * DESCRIPTION:	    Unlinks the first element found in the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    resize: (int *) -- set to 1 if the table should be resized
+ *			afterwards.
+ *
+ * RETURN:	    CHashElmt * -- the unlinked element, or NULL.
+ *
+ * NOTES:	    Scans one stripe at a time, old buckets before new ones.
+ ***/
+static CHashElmt * unlink_first(CHash * tbl, int * resize)
+{
+  for (unsigned int s = 0; s < tbl->stripes; s++) {
+    cstripe_write(tbl, s);
+    CHashElmt ** link = first_link(tbl, s);
+    if (link != NULL && csnap_write(tbl, (*link)->hash)) {
+      cstripe_unlock(tbl, s);
+      return NULL;
+    }
+    if (link != NULL) {
+      CHashElmt * elmt = *link;
+      unlink_elmt(tbl, link);
+      *resize = size_add(tbl, -1);
+      cstripe_unlock(tbl, s);
+      return elmt;
+    }
+    cstripe_unlock(tbl, s);
+  }
+
+  return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    first_link
+ *
+ * DESCRIPTION:	    Finds the first non-empty bucket covered by a stripe.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    stripe: (unsigned int) -- the stripe, held by the caller.
+ *
+ * RETURN:	    CHashElmt ** -- the bucket, or NULL if the stripe is empty.
+ *
+ * NOTES:	    Searches tbl->oldtable first, which lets a drain help the
+ *		    rehash along. Skips empty buckets a word of the bitmap at a
+ *		    time.
+ ***/
+static CHashElmt ** first_link(CHash * tbl, unsigned int stripe)
+{
+  if (tbl->oldtable != NULL) {
+    unsigned int i = cbits_first(tbl, cbits_of(tbl->oldtable, tbl->oldbuckets),
+				 tbl->oldbuckets, stripe);
+    if (i < tbl->oldbuckets)
+      return &(tbl->oldtable[i]);
+  }
+
+  unsigned int i = cbits_first(tbl, cbits_of(tbl->table, tbl->buckets),
+			       tbl->buckets, stripe);
+  return i < tbl->buckets ? &(tbl->table[i]) : NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    unlink_elmt
+ *
+ * DESCRIPTION:	    Unlinks the element at *link from its chain, and clears
+ *		    the bit of its bucket if that leaves the bucket empty.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with the stripe held for
+ *			writing.
+ *		    link: (CHashElmt **) -- the link to the element.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Only the last element of a chain can leave it empty, so the
+ *		    bucket is only looked up then, from the stored hash.
+ ***/
+static void unlink_elmt(CHash * tbl, CHashElmt ** link)
+{
+  CHashElmt * elmt = *link;
+  __atomic_store_n(link, elmt->next, __ATOMIC_RELEASE);
+  cfilter_remove(tbl, elmt->hash);
+  cclock_unlink(tbl, elmt);
+  ctimer_cancel(tbl, elmt);
+  if (elmt->next != NULL)
+    return;
+
+  unsigned int bucket = chash_indexof(tbl, elmt->hash, tbl->buckets);
+  if (link == &(tbl->table[bucket])) {
+    cbits_clear(tbl, cbits_of(tbl->table, tbl->buckets), bucket);
+  } else if (tbl->oldtable != NULL) {
+    bucket = chash_indexof(tbl, elmt->hash, tbl->oldbuckets);
+    if (link == &(tbl->oldtable[bucket]))
+      cbits_clear(tbl, cbits_of(tbl->oldtable, tbl->oldbuckets), bucket);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    link_to
+ *
+ * DESCRIPTION:	    Finds the link pointing to an element of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with the stripe of the element
+ *			held.
+ *		    elmt: (CHashElmt *) -- the element.
+ *
+ * RETURN:	    CHashElmt ** -- the link.
+ *
+ * NOTES:	    Compares the elements themselves, so neither tbl->match nor
+ *		    tbl->hash is called. The element must be in the table.
+ ***/
+static CHashElmt ** link_to(CHash * tbl, CHashElmt * elmt)
+{
+  CHashElmt ** link = &(tbl->table[chash_indexof(tbl, elmt->hash,
+						 tbl->buckets)]);
+  while (*link != NULL && *link != elmt)
+    link = &((*link)->next);
+  if (*link != NULL || tbl->oldtable == NULL)
+    return link;
+
+  link = &(tbl->oldtable[chash_indexof(tbl, elmt->hash, tbl->oldbuckets)]);
+  while (*link != elmt)
+    link = &((*link)->next);
+  return link;
+}
+
+/******************************************************************************
+ * FUNCTION:	    drop_elmt
+ *
+ * DESCRIPTION:	    Destroys an element unlinked from the table, with its data
+ *		    and value.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with no stripe held.
+ *		    elmt: (CHashElmt *) -- the element.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Deferred tables queue the element instead, and tables with
+ *		    live snapshots hold it until they are released.
+ ***/
+static void drop_elmt(CHash * tbl, CHashElmt * elmt)
+{
+  if (csnap_hold(tbl, elmt))
+    return;
+  if (tbl->deferred != NULL) {
+    cdefer_push(tbl, elmt);
+    return;
+  }
+
+  chash_drop_data(tbl, elmt->data);
+  if (tbl->map)
+    chash_drop_value(tbl, *chash_valueof(elmt));
+  cmem_elmt_put(tbl, elmt);
+}
+
+/******************************************************************************
+ * FUNCTION:	    first_unlocked
+ *
+ * DESCRIPTION:	    Finds an element of a bucket array which writers may be
+ *		    changing.
+ *
+ * ARGUMENTS:	    table: (CHashElmt **) -- the array.
+ *		    buckets: (unsigned int) -- its size.
+ *
+ * RETURN:	    CHashElmt * -- the head of the first occupied bucket, or
+ *		    NULL if there is none.
+ *
+ * NOTES:	    A bit may be stale, so the bucket itself is checked too.
+ ***/
+static CHashElmt * first_unlocked(CHashElmt ** table, unsigned int buckets)
+{
+  const uint64_t * bits = cbits_of(table, buckets);
+  CHashElmt * elmt = NULL;
+  for (unsigned int i = cbits_scan(bits, 0, buckets);
+       elmt == NULL && i < buckets; i = cbits_scan(bits, i + 1, buckets))
+    elmt = __atomic_load_n(&(table[i]), __ATOMIC_ACQUIRE);
+  return elmt;
+}
+
+/******************************************************************************
+ * FUNCTION:	    scan_step
+ *
+ * DESCRIPTION:	    Returns how far chash_scan moves the cursor for one bucket
+ *		    of an array of the given size.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    buckets: (unsigned int) -- the size of the array.
+ *
+ * RETURN:	    uint64_t -- the distance, which is also the alignment of
+ *		    the position of every bucket. 0 stands for 2^64, when one
+ *		    bucket covers the whole hash space.
+ *
+ * NOTES:	    Every array other than a Fibonacci-indexed one holds
+ *		    minbuckets times a power of two buckets.
+ ***/
+static uint64_t scan_step(CHash * tbl, unsigned int buckets)
+{
+  if (tbl->index == CHASH_INDEX_FIBONACCI)
+    return buckets == 1 ? 0 : 1ULL << (64 - __builtin_ctz(buckets));
+  return 1ULL << (32 - __builtin_ctz(buckets / tbl->minbuckets));
+}
+
+/******************************************************************************
+ * FUNCTION:	    scan_bucket
+ *
+ * DESCRIPTION:	    Returns the bucket of an array of the given size which
+ *		    contains a chash_scan cursor.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    cursor: (uint64_t) -- the cursor.
+ *		    buckets: (unsigned int) -- the size of the array.
+ *
+ * RETURN:	    unsigned int -- the bucket.
+ *
+ * NOTES:	    Outside of CHASH_INDEX_FIBONACCI, the high half of the
+ *		    cursor is the bucket modulo minbuckets, and the low half
+ *		    holds the remaining bits of the bucket, most significant
+ *		    bit last.
+ ***/
+static unsigned int scan_bucket(CHash * tbl, uint64_t cursor,
+				unsigned int buckets)
+{
+  if (tbl->index == CHASH_INDEX_FIBONACCI)
+    return (cursor >> (63 - __builtin_ctz(buckets))) >> 1;
+
+  uint32_t high = cursor;
+  high = ((high >> 1) & 0x55555555) | ((high & 0x55555555) << 1);
+  high = ((high >> 2) & 0x33333333) | ((high & 0x33333333) << 2);
+  high = ((high >> 4) & 0x0f0f0f0f) | ((high & 0x0f0f0f0f) << 4);
+  high = __builtin_bswap32(high);
+  return (cursor >> 32)
+    + tbl->minbuckets * (high & (buckets / tbl->minbuckets - 1));
+}
+
+/******************************************************************************
+ * FUNCTION:	    destroy_table
+ *
+ * DESCRIPTION:	    Frees every element in a bucket array, then the array.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table owning the array.
+ *		    table: (CHashElmt **) -- the bucket array, may be NULL.
+ *		    buckets: (unsigned int) -- the size of the bucket array.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    If the elements come from a node pool, or are hooks inside
+ *		    the user's objects, and there is no destroy function for
+ *		    them or their values, the chains are not walked at all: any
+ *		    pool is released afterwards by cmem_node_release.
+ ***/
+static void destroy_table(CHash * tbl, CHashElmt ** table,
+			  unsigned int buckets)
+{
+  if (table == NULL)
+    return;
+
+  int walk = tbl->destroy != NULL || tbl->destroy_value != NULL
+    || (tbl->slabsize == 0 && !tbl->intrusive);
+  const uint64_t * bits = cbits_of(table, buckets);
+  for (unsigned int i = cbits_scan(bits, 0, buckets); walk && i < buckets;
+       i = cbits_scan(bits, i + 1, buckets)) {
+    CHashElmt * elmt = table[i];
+    while (elmt != NULL) {
+      CHashElmt * next = elmt->next;
+      chash_drop_data(tbl, elmt->data);
+      if (tbl->map)
+	chash_drop_value(tbl, *chash_valueof(elmt));
+      if (tbl->slabsize == 0)
+	cmem_elmt_put(tbl, elmt);
+      elmt = next;
+    }
+  }
+  cmem_free(&(tbl->allocator), table, cbits_table_bytes(buckets));
+}
+
 #ifdef CONFIG_DEBUG_CHAIN_HASH
 /******************************************************************************
  * FUNCTION:	    error_exit
@@ -301,23 +1949,6 @@ static _Noreturn void error_exit(char * msg)
   exit(1);
 }
 
-/******************************************************************************
- * FUNCTION:	    hash_func
- *
- * DESCRIPTION:	    Static function for hashing the data in the test hashtable.
- *
- * ARGUMENTS:	    data: (const void *) -- the data to put into the table.
- *
- * RETURN:	    int -- the hash key for referring to the data in the table.
- *
- * NOTES:	    debug function -- not present in finished executable unless
- *		    CONFIG_DEBUG_CHAIN_HASH is defined.
- ***/
-static int hash_func(const void * data)
-{
-  return *(int *)data;
-}
-
 /******************************************************************************
  * FUNCTION:	    match_func
  *
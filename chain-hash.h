@@ -9,7 +9,7 @@
  *
  * CREATED:	    07/15/2017
  *
- * LAST EDITED:	    03/14/2018
+ * LAST EDITED:	    10/14/2026
  ***/
 
 /**
@@ -29,32 +29,484 @@
  * INCLUDES
  ***/
 
-#include "list.h"
+#include <stddef.h>
+#include <stdint.h>
 
 /******************************************************************************
  * MACRO DEFINITIONS
  ***/
 
+/**
+ * \brief Default maximum load factor (elements per bucket) before the table
+ * begins to grow.
+ */
+#ifndef CHASH_DEFAULT_MAX_LOAD
+#define CHASH_DEFAULT_MAX_LOAD 1.0f
+#endif
+
+/**
+ * \brief Default minimum load factor before the table begins to shrink.
+ */
+#ifndef CHASH_DEFAULT_MIN_LOAD
+#define CHASH_DEFAULT_MIN_LOAD 0.1f
+#endif
+
+/**
+ * \brief Number of non-empty buckets migrated per operation while the table
+ * is being rehashed.
+ */
+#ifndef CHASH_REHASH_STEP
+#define CHASH_REHASH_STEP 4
+#endif
+
+/**
+ * \brief Number of keys chash_lookup_batch and chash_insert_batch have in
+ * flight at once. Their bucket loads are all issued before any is used.
+ */
+#ifndef CHASH_BATCH_WINDOW
+#define CHASH_BATCH_WINDOW 16
+#endif
+
+/**
+ * \brief Default number of lock stripes of a concurrent table.
+ */
+#ifndef CHASH_DEFAULT_STRIPES
+#define CHASH_DEFAULT_STRIPES 64
+#endif
+
+/**
+ * \brief Number of elements per slab of the node pool chash_build gives a
+ * table that was not asked for one.
+ */
+#ifndef CHASH_BUILD_POOLSIZE
+#define CHASH_BUILD_POOLSIZE 256
+#endif
+
+/**
+ * \brief Number of elements per slab of the node pool of a shard placed on a
+ * NUMA node, when it was not asked for one.
+ */
+#ifndef CHASH_SHARD_POOLSIZE
+#define CHASH_SHARD_POOLSIZE 256
+#endif
+
+/**
+ * \brief Most elements the CLOCK hand of a cache table examines per eviction.
+ * If all of them were referenced, the last one is evicted anyway.
+ */
+#ifndef CHASH_CLOCK_SWEEP
+#define CHASH_CLOCK_SWEEP 16
+#endif
+
+/**
+ * \brief Number of levels of the timer wheels of an expiring table. Each
+ * level has 64 slots, each 64 times as long as the last, so deadlines up to
+ * 64^CHASH_WHEEL_LEVELS milliseconds away are placed directly; later ones are
+ * placed again as they come closer.
+ */
+#ifndef CHASH_WHEEL_LEVELS
+#define CHASH_WHEEL_LEVELS 4
+#endif
+
+/**
+ * \brief Number of queued elements which wake the collector thread of a
+ * CHASH_DEFER_THREAD table.
+ */
+#ifndef CHASH_DEFER_BATCH
+#define CHASH_DEFER_BATCH 64
+#endif
+
+/**
+ * \brief Milliseconds the collector thread of a CHASH_DEFER_THREAD table waits
+ * for a batch to fill up before destroying what it has.
+ */
+#ifndef CHASH_DEFER_INTERVAL
+#define CHASH_DEFER_INTERVAL 10
+#endif
+
+/**
+ * \brief Default number of elements, or groups, a probe of a traced table
+ * examines before it counts as a long chain. See CHashTrace.
+ */
+#ifndef CHASH_TRACE_CHAIN
+#define CHASH_TRACE_CHAIN 8
+#endif
+
+/**
+ * \brief Default nanoseconds a call to the destroy function of a traced table
+ * takes before it counts as slow. See CHashTrace.
+ */
+#ifndef CHASH_TRACE_DESTROY
+#define CHASH_TRACE_DESTROY 100000
+#endif
+
+/**
+ * \brief Number of chain lengths counted separately by chash_stats. Longer
+ * chains are counted in the last entry.
+ */
+#ifndef CHASH_STATS_HISTOGRAM
+#define CHASH_STATS_HISTOGRAM 16
+#endif
+
 /**
  * \brief Returns the size of the Hash.
  */
-#define chash_size(Table) ((Table)->size)
+#define chash_size(Table) __atomic_load_n(&(Table)->size, __ATOMIC_RELAXED)
 
 /**
  * \brief Returns true if the hash is empty, false if it is not.
  */
-#define chash_isempty(Table) ((Table)->size == 0 ? 1 : 0)
+#define chash_isempty(Table) (chash_size(Table) == 0 ? 1 : 0)
+
+/**
+ * \brief Returns true if the hash is in the middle of an incremental rehash.
+ */
+#define chash_isrehashing(Table)					\
+  (__atomic_load_n(&(Table)->oldtable, __ATOMIC_RELAXED) != NULL ? 1 : 0)
 
 /******************************************************************************
  * TYPE DEFINITIONS
  ***/
 
+/**
+ * \brief The storage engines a CHash can be backed by.
+ *
+ * CHASH_ENGINE_CHAIN is the classic table of linked buckets. CHASH_ENGINE_OPEN
+ * stores the data pointers inline in one contiguous array, probed with a byte
+ * of control metadata per slot, which avoids chasing a pointer per element.
+ * CHASH_ENGINE_IMAGE serves a read-only image mapped by chash_load, and
+ * cannot be requested from chash_init_opts.
+ */
+typedef enum _CHashEngine_ {
+
+  CHASH_ENGINE_CHAIN = 0,
+  CHASH_ENGINE_OPEN,
+  CHASH_ENGINE_IMAGE
+
+} CHashEngine;
+
+/**
+ * \brief How a hash is reduced to a bucket index in the chained engine.
+ *
+ * CHASH_INDEX_MODULO takes the hash modulo the number of buckets, which costs
+ * an integer division. CHASH_INDEX_MASK and CHASH_INDEX_FIBONACCI round the
+ * number of buckets up to a power of two. MASK keeps the low bits of the hash,
+ * and so needs a hash function whose low bits are well mixed. FIBONACCI
+ * multiplies by 2^64/phi and keeps the high bits, which tolerates weaker hash
+ * functions at the cost of one multiplication.
+ */
+typedef enum _CHashIndex_ {
+
+  CHASH_INDEX_MODULO = 0,
+  CHASH_INDEX_MASK,
+  CHASH_INDEX_FIBONACCI
+
+} CHashIndex;
+
+/**
+ * \brief Whether, and how, a table protects itself from concurrent access.
+ *
+ * CHASH_CONCURRENCY_MUTEX and CHASH_CONCURRENCY_RWLOCK split the buckets into
+ * stripes, each guarded by its own lock, so operations on different stripes
+ * proceed in parallel. With RWLOCK, chash_lookup only takes its stripe for
+ * reading, so lookups never wait on each other.
+ *
+ * CHASH_CONCURRENCY_EPOCH uses mutex stripes for writers only: chash_lookup
+ * takes no lock at all. Removed elements and old bucket arrays are freed
+ * once every lookup that could still see them has returned, so the destroy
+ * function runs some time after chash_remove, possibly on another thread.
+ */
+typedef enum _CHashConcurrency_ {
+
+  CHASH_CONCURRENCY_NONE = 0,
+  CHASH_CONCURRENCY_MUTEX,
+  CHASH_CONCURRENCY_RWLOCK,
+  CHASH_CONCURRENCY_EPOCH
+
+} CHashConcurrency;
+
+/**
+ * \brief How a chained table reorders a bucket when a lookup finds an element.
+ *
+ * CHASH_REORDER_MTF moves the element to the head of its bucket, and
+ * CHASH_REORDER_TRANSPOSE swaps it with the element before it, so frequently
+ * found elements drift toward the front of their chains. Lookups only
+ * reorder when they hold their bucket exclusively, so tables using
+ * CHASH_CONCURRENCY_RWLOCK or CHASH_CONCURRENCY_EPOCH never reorder.
+ */
+typedef enum _CHashReorder_ {
+
+  CHASH_REORDER_NONE = 0,
+  CHASH_REORDER_MTF,
+  CHASH_REORDER_TRANSPOSE
+
+} CHashReorder;
+
+/**
+ * \brief When a chained table calls its destroy functions.
+ *
+ * CHASH_DEFER_NONE calls them as soon as the stripe is released, on the thread
+ * that removed, replaced, evicted or reaped the element. CHASH_DEFER_QUEUE
+ * appends the element to a queue instead, which chash_collect empties.
+ * CHASH_DEFER_THREAD also starts a collector thread, which empties the queue
+ * in batches, and to which chash_destroy hands the whole table.
+ */
+typedef enum _CHashDefer_ {
+
+  CHASH_DEFER_NONE = 0,
+  CHASH_DEFER_QUEUE,
+  CHASH_DEFER_THREAD
+
+} CHashDefer;
+
+/**
+ * \brief The lock stripes of a concurrent table.
+ */
+typedef struct _CHashLocks_ CHashLocks;
+
+/**
+ * \brief The per-thread operation counters of a table.
+ */
+typedef union _CHashCounters_ CHashCounters;
+
+/**
+ * \brief The membership filter of a chained table.
+ */
+typedef struct _CHashFilter_ CHashFilter;
+
+/**
+ * \brief The CLOCK rings of a cache table, one per lock stripe.
+ */
+typedef union _CHashClock_ CHashClock;
+
+/**
+ * \brief The timer wheels of an expiring table, one per lock stripe.
+ */
+typedef struct _CHashWheel_ CHashWheel;
+
+/**
+ * \brief The deferred free queue of a chained table.
+ */
+typedef struct _CHashDeferred_ CHashDeferred;
+
+/**
+ * \brief A point-in-time view of a chained table, from chash_snapshot.
+ */
+typedef struct _CHashSnapshot_ CHashSnapshot;
+
+/**
+ * \brief The live snapshots of a chained table, and what they hold.
+ */
+typedef struct _CHashSnapshots_ CHashSnapshots;
+
+/**
+ * \brief An element of a bucket in the chained engine.
+ *
+ * Every element keeps the full hash of its data, so that a probe can rule out
+ * an element without calling the match function, and so that rehashing never
+ * needs to call the hash function again.
+ */
+typedef struct _CHashElmt_ {
+
+  struct _CHashElmt_ * next;
+  uint64_t hash;
+  void * data;
+
+} CHashElmt;
+
+/**
+ * \brief The hook embedded in objects stored in an intrusive table.
+ *
+ * An intrusive table links its objects through a CHashHook inside each of
+ * them instead of allocating a CHashElmt per object. The hook's \c data
+ * points back at the object, so reading it stays on the object's own cache
+ * lines. The table owns the hook while the object is linked: an object can
+ * be in only one table per hook, and must stay alive until it is removed.
+ */
+typedef CHashElmt CHashHook;
+
+/**
+ * \brief A user-supplied allocator for the memory of a table.
+ *
+ * \c alloc and \c free receive \c ctx as their first argument. \c free also
+ * receives the size the block was allocated with. If \c alloc is \c NULL,
+ * malloc and free are used. If only \c free is \c NULL, memory is never
+ * returned, which suits arena allocators.
+ */
+typedef struct _CHashAllocator_ {
+
+  void * (*alloc)(void * ctx, size_t size);
+  void (*free)(void * ctx, void * ptr, size_t size);
+  void * ctx;
+
+} CHashAllocator;
+
+/**
+ * \brief A bump allocator which frees all of its memory at once.
+ */
+typedef struct _CHashArena_ CHashArena;
+
+/**
+ * \brief Tracing hooks for a table, see CHashOpts.trace.
+ *
+ * Every hook receives \c ctx first, and may be \c NULL. \c resize is called
+ * once a table has started resizing from \c from buckets (or slots) to \c to,
+ * with the nanoseconds the calling thread spent on it: the whole move for the
+ * open engine, and the allocation and swap of the bucket arrays for the
+ * chained one, which moves its elements incrementally. \c chain is called when
+ * a probe for \c hash examined more than \c longchain elements, or groups of
+ * the open engine (CHASH_TRACE_CHAIN if \c 0). \c destroy is called when the
+ * destroy function took more than \c slowdestroy nanoseconds on \c data
+ * (CHASH_TRACE_DESTROY if \c 0), just after it returns, so that \c data is
+ * only an address by then.
+ *
+ * The hooks run on the thread that caused the event, possibly with locks of
+ * the table held, so they must not use the table.
+ */
+struct _CHash_;
+typedef struct _CHashTrace_ {
+
+  void (*resize)(void * ctx, const struct _CHash_ * table, unsigned int from,
+		 unsigned int to, uint64_t ns);
+  void (*chain)(void * ctx, const struct _CHash_ * table, uint64_t hash,
+		unsigned int probes);
+  void (*destroy)(void * ctx, const struct _CHash_ * table,
+		  const void * data, uint64_t ns);
+  void * ctx;
+  unsigned int longchain;
+  uint64_t slowdestroy;
+
+} CHashTrace;
+
+/**
+ * \brief Options accepted by chash_init_opts.
+ *
+ * A zero-initialized struct describes the same table chash_init creates.
+ *
+ * \c allocator, if not \c NULL, is copied into the table and used for all of
+ * its memory. \c poolsize, if not zero, gives the chained engine a node pool:
+ * elements are allocated \c poolsize at a time and recycled through a free
+ * list owned by the table.
+ *
+ * \c index selects how hashes are reduced to buckets. The open-addressing
+ * engine always uses power-of-two sizes and ignores it. \c hash64, if not
+ * \c NULL, is used instead of the \c hash argument of chash_init_opts (which
+ * may then be \c NULL), giving the table a full 64-bit hash space.
+ *
+ * \c concurrency makes the table safe to share between threads, with
+ * \c stripes locks (rounded up to a power of two; \c 0 means
+ * CHASH_DEFAULT_STRIPES). Concurrent tables must use the chained engine, and
+ * always use a power-of-two index: CHASH_INDEX_MODULO is treated as
+ * CHASH_INDEX_FIBONACCI.
+ *
+ * \c intrusive makes a chained table link its data through the CHashHook
+ * found \c hook bytes into every object (see offsetof), so inserting never
+ * allocates. Intrusive tables cannot have a node pool or use
+ * CHASH_CONCURRENCY_EPOCH, whose lookups rely on copying elements.
+ *
+ * \c reorder makes lookups on a chained table promote the elements they find
+ * toward the head of their bucket.
+ *
+ * \c map makes the table associate a value with every element, which is then
+ * its key: see chash_put and chash_get. \c destroy_value, if not \c NULL, is
+ * called on a value when it is replaced or its key removed, as the destroy
+ * function of the table is on keys. The values are kept apart from the keys
+ * (in a parallel array for the open engine, after the chain element for the
+ * chained one), so a probe only reads key memory. Map tables cannot be
+ * intrusive.
+ *
+ * \c filter, if not \c 0, gives a chained table a counting Bloom filter of
+ * about \c filter four-bit counters per element, which inserts and removals
+ * keep up to date. A lookup, removal or insertion of a key the filter has
+ * never seen skips its bucket entirely. 10 gives about 1% false positives.
+ * The filter is rebuilt, in one pass, whenever the table grows past the size
+ * it was built for.
+ *
+ * \c capacity, if not \c 0, makes a chained table a cache holding at most
+ * about \c capacity elements. Its elements are threaded on CLOCK rings, and
+ * every lookup hit sets a reference bit. Inserting into a full table evicts,
+ * in constant time, the first element whose bit the hand finds clear (looking
+ * at no more than CHASH_CLOCK_SWEEP of them), and passes it to the destroy
+ * function. Concurrent tables keep one ring per stripe, each holding
+ * \c capacity divided by \c stripes elements, rounded up, so an eviction never
+ * leaves its stripe. Cache tables cannot be intrusive or use
+ * CHASH_CONCURRENCY_EPOCH.
+ *
+ * \c expiry gives every element of a chained table a deadline, after which
+ * lookups no longer find it and chash_reap removes it. Elements start out
+ * living \c ttl milliseconds, or forever if \c ttl is \c 0, and chash_expire
+ * changes the deadline of one of them. Time is read from \c now, in
+ * milliseconds, or from CLOCK_MONOTONIC if \c now is \c NULL. Expiring tables
+ * cannot be intrusive or use CHASH_CONCURRENCY_EPOCH.
+ *
+ * \c defer moves the destroy calls of a chained table off the threads using
+ * it (see CHashDefer). Deferred tables cannot be intrusive or use
+ * CHASH_CONCURRENCY_EPOCH, which already defers them by a grace period. The
+ * collector thread of CHASH_DEFER_THREAD frees elements while other threads
+ * allocate them, so without a concurrency mode, it needs the default
+ * allocator and no node pool.
+ *
+ * \c snapshots lets chash_snapshot take point-in-time views of a chained
+ * table. Tables with snapshots cannot be intrusive, maps, caches or
+ * expiring, or use CHASH_CONCURRENCY_EPOCH.
+ *
+ * \c inlinekey, if not \c 0, makes every element of a chained table keep a
+ * copy of the first \c inlinekey bytes of its key, and the length of the key,
+ * next to its hash, so that probes compare keys without leaving the chain.
+ * \c key points \c *bytes at the key of some data and returns its length, as
+ * the encode function of chash_save does. A probe calls it once, on the data
+ * it is looking for, and compares the lengths and then the stored bytes of
+ * every element of the same hash. Keys of up to \c inlinekey bytes are then
+ * equal or not without calling the match function, which must agree with
+ * comparing the bytes; longer ones call it once their first \c inlinekey bytes
+ * are equal. Tables with inline keys cannot be intrusive.
+ *
+ * \c trace, if not \c NULL, is copied into the table, which then reports
+ * resizes, long chains and slow destroy calls to its hooks (see CHashTrace).
+ * Only traced tables time their destroy calls.
+ */
+typedef struct _CHashOpts_ {
+
+  CHashEngine engine;
+  const CHashAllocator * allocator;
+  unsigned int poolsize;
+  CHashIndex index;
+  uint64_t (*hash64)(const void *);
+  CHashConcurrency concurrency;
+  unsigned int stripes;
+  int intrusive;
+  size_t hook;
+  CHashReorder reorder;
+  int map;
+  void (*destroy_value)(void *);
+  unsigned int filter;
+  unsigned int capacity;
+  int expiry;
+  uint64_t ttl;
+  uint64_t (*now)(void);
+  CHashDefer defer;
+  int snapshots;
+  unsigned int inlinekey;
+  size_t (*key)(const void * data, const void ** bytes);
+  const CHashTrace * trace;
+
+} CHashOpts;
+
 /**
  * \brief The CHash struct definition
  *
  * The CHash structure is the main type provided in this API. This structure
  * represents the Chained Hash table and all data held within it.
  *
+ * While the table is being resized, \c oldtable holds the previous bucket
+ * array. Buckets below \c rehashidx have already been migrated into \c table,
+ * and new elements are always inserted into \c table.
+ *
+ * Tables using CHASH_ENGINE_OPEN keep their slots in \c ctrl and \c slots
+ * instead, and \c buckets is the number of slots, with the values of a map
+ * table in \c values. Tables returned by
+ * chash_load keep the mapping of their image in \c image.
+ *
  * \warning The user should interface directly with the struct elements as
  * sparingly as possible.
  */
@@ -63,19 +515,138 @@ typedef struct _CHash_ {
   unsigned int size;
   unsigned int buckets;
   int (*hash)(const void *);
+  uint64_t (*hash64)(const void *);
+  CHashIndex index;
   int (*match)(const void *, const void *);
   void (*destroy)(void *);
-  list ** table;
+  CHashElmt ** table;
+
+  CHashElmt ** oldtable;
+  unsigned int oldbuckets;
+  unsigned int rehashidx;
+  unsigned int minbuckets;
+  float maxload;
+  float minload;
+
+  CHashEngine engine;
+  unsigned char * ctrl;
+  void ** slots;
+  void ** values;
+  unsigned int deleted;
+
+  const void * image;
+  size_t imagebytes;
+
+  CHashAllocator allocator;
+  CHashElmt * freelist;
+  void * slabs;
+  unsigned int slabsize;
+
+  unsigned int stripes;
+  CHashLocks * locks;
+
+  CHashCounters * counters;
+
+  int intrusive;
+  size_t hook;
+  CHashReorder reorder;
+
+  int map;
+  void (*destroy_value)(void *);
+
+  CHashFilter * filter;
+  unsigned int filterbits;
+
+  CHashClock * clock;
+  unsigned int capacity;
+
+  CHashWheel * wheels;
+  int expiry;
+  uint64_t ttl;
+  uint64_t (*now)(void);
+
+  CHashDeferred * deferred;
+
+  CHashSnapshots * snapshots;
+
+  unsigned int inlinekey;
+  size_t (*key)(const void *, const void **);
+
+  CHashTrace trace;
+  int traced;
 
 } CHash;
 
+/**
+ * \brief A table split into independent shards, from chash_shards_init.
+ *
+ * The high bits of the hash of an element pick its shard, \c tables[i]. Each
+ * shard is a complete CHash with its own bucket array, locks and memory, so
+ * threads working on different shards share nothing. \c nodes holds the NUMA
+ * node of each shard, if they were given one.
+ */
+typedef struct _CHashShards_ {
+
+  unsigned int count;
+  unsigned int bits;
+  CHash ** tables;
+  int * nodes;
+  CHashAllocator allocator;
+
+} CHashShards;
+
+/**
+ * \brief A snapshot of the shape and usage of a table, from chash_stats.
+ *
+ * For the chained engine, \c buckets counts both bucket arrays while the
+ * table is being rehashed, \c histogram[n] is the number of buckets holding
+ * n elements, and the chain lengths are taken over non-empty buckets only.
+ *
+ * For CHASH_ENGINE_OPEN, \c buckets is the number of slots and \c used the
+ * number of full ones. A chain is the probe sequence of an element:
+ * \c histogram[n] is the number of elements stored n groups past the group
+ * their hash selects, and the chain lengths count groups probed to find them.
+ *
+ * \c bytes covers the table, its arrays, elements and locks, but not the
+ * user's data. The operation counters are only maintained when the library
+ * is built with CONFIG_CHASH_STATS, and are zero otherwise. \c probes counts
+ * the elements, or groups, examined by lookups and removals. \c evictions
+ * counts the elements a cache table evicted to make room, and \c expired
+ * those chash_reap removed, or an insert replaced, after their deadline.
+ */
+typedef struct _CHashStats_ {
+
+  unsigned int size;
+  unsigned int buckets;
+  unsigned int used;
+  unsigned int empty;
+  unsigned int deleted;
+  float load;
+  unsigned int max_chain;
+  float mean_chain;
+  unsigned int histogram[CHASH_STATS_HISTOGRAM];
+  size_t bytes;
+  int rehashing;
+
+  unsigned long lookups;
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long probes;
+  unsigned long inserts;
+  unsigned long removes;
+  unsigned long evictions;
+  unsigned long expired;
+
+} CHashStats;
+
 /******************************************************************************
  * API FUNCTION PROTOTYPES
  ***/
 
 /**
  * \brief The initialization funtion.
- * \param size The number of containers to create in the hash.
+ * \param size The number of containers to create in the hash. The table will
+ * grow past this when the load factor is exceeded, but never shrinks below it.
  * \param hash The user-defined hash function.
  * \param match The user-defined function for comparing two data points.
  * \param destroy The user-defined function for freeing data points.
@@ -87,15 +658,120 @@ extern CHash * chash_init(int size,
 			  void (*destroy)(void *)
 			  );
 
+/**
+ * \brief Initializes a table with the given options.
+ * \param size The number of containers to create in the hash.
+ * \param hash The user-defined hash function. May be \c NULL if
+ * \codeopts->hash64\endcode is set.
+ * \param match The user-defined function for comparing two data points.
+ * \param destroy The user-defined function for freeing data points.
+ * \param opts The options for the table, or \c NULL for the defaults.
+ * \return CHash* Pointer to a created and initialized CHash struct.
+ */
+extern CHash * chash_init_opts(int size,
+			       int (*hash)(const void *),
+			       int (*match)(const void *, const void *),
+			       void (*destroy)(void *),
+			       const CHashOpts * opts
+			       );
+
 /**
  * \brief Function to free all data associated with the hash.
  * \param table The table to destroy.
  * \return void
  * \warning If \codetable->destroy\endcode is set to \c NULL, the data will not
  * be freed, and it is the responsibility of the programmer to manage this mem.
+ * \note With a node pool and no destroy function, the elements are not
+ * walked: the pool's slabs are released all at once, or not at all if the
+ * allocator has no free function. A CHASH_DEFER_THREAD table is handed to
+ * its collector thread, which destroys it after this returns. Every snapshot
+ * of the table must have been released.
  */
 extern void chash_destroy(CHash * table);
 
+/**
+ * \brief Destroys a table like chash_destroy, calling the destroy function of
+ * the table from several threads
+ * \param table The table to destroy.
+ * \param threads The number of threads, or \c 0 for one per online processor.
+ * \return void
+ * \note The destroy function must be safe to call from several threads. Map
+ * tables are destroyed on the calling thread.
+ */
+extern void chash_destroy_parallel(CHash * table, int threads);
+
+/**
+ * \brief Creates a table holding every element of an array
+ * \param data The elements to insert. None may be \c NULL.
+ * \param count The number of elements
+ * \param hash The user-defined hash function, as for chash_init_opts
+ * \param match The user-defined match function
+ * \param destroy The user-defined destroy function
+ * \param opts The options for the table, or \c NULL for the defaults
+ * \return CHash* The table, or \c NULL on error.
+ * \note Much faster than inserting the elements one at a time: the bucket
+ * array is sized for \c count up front, and the chained engine hashes every
+ * element once, sorts them by bucket, and takes all of its chain elements
+ * from one block of the node pool, so each chain is contiguous in memory. A
+ * table with no \c opts.poolsize gets a pool of CHASH_BUILD_POOLSIZE. If
+ * several elements match, only the first is inserted; the others are left to
+ * the caller.
+ */
+extern CHash * chash_build(void ** data, int count,
+			   int (*hash)(const void *),
+			   int (*match)(const void *, const void *),
+			   void (*destroy)(void *), const CHashOpts * opts);
+
+/**
+ * \brief Like chash_build, hashing the elements and linking the chains on
+ * several threads
+ * \param threads The number of threads, or \c 0 for one per online processor.
+ * \return CHash* The table, or \c NULL on error.
+ * \note The hash and match functions, and \c opts.key, must be safe to call
+ * from several threads. Only the chained engine without \c opts.intrusive builds in
+ * parallel. Neither function builds map, cache or expiring tables.
+ */
+extern CHash * chash_build_parallel(void ** data, int count,
+				    int (*hash)(const void *),
+				    int (*match)(const void *, const void *),
+				    void (*destroy)(void *),
+				    const CHashOpts * opts, int threads);
+
+/**
+ * \brief Writes an image of a table to a file, for chash_load
+ * \param table The table to save. It must not be modified meanwhile.
+ * \param path The file to write, which is replaced atomically.
+ * \param encode The user-defined function which points \c *bytes at the
+ * record to store for an element, and returns its length. The bytes only need
+ * to stay valid until the next call.
+ * \return int \c 0 on success, \c -1 on error.
+ * \note The image holds no pointers: the records are sorted by bucket, and
+ * found through offsets from the start of the file. Every record starts on a
+ * 16-byte boundary. The file is only readable on machines of the same byte
+ * order. Map tables cannot be saved.
+ */
+extern int chash_save(CHash * table, const char * path,
+		      size_t (*encode)(const void * data, const void ** bytes));
+
+/**
+ * \brief Maps an image written by chash_save as a read-only table
+ * \param path The file to map.
+ * \param hash The hash function of the saved table, which is applied to keys
+ * and must agree with the hashes it stored.
+ * \param match The user-defined function comparing a key to a record.
+ * \param opts The options, or \c NULL. Only \c hash64, which must be set if
+ * and only if the saved table had it set, and \c allocator are used.
+ * \return CHash* The table, or \c NULL on error.
+ * \note Loading reads nothing but the header, so it takes constant time, and
+ * the pages of the image are shared by every process mapping it. chash_lookup
+ * returns pointers to the records inside the mapping, which must not be
+ * written to and last until chash_destroy. Lookups take no lock and may run
+ * from any number of threads; inserts and removes fail.
+ */
+extern CHash * chash_load(const char * path, int (*hash)(const void *),
+			  int (*match)(const void *, const void *),
+			  const CHashOpts * opts);
+
 /**
  * \brief Inserts the value specified by \c data into the hash.
  * \param table The table to insert the value into.
@@ -105,32 +781,408 @@ extern void chash_destroy(CHash * table);
  */
 extern int chash_insert(CHash * table, const void * data);
 
+/**
+ * \brief Finds the element matching \c data, or inserts \c data
+ * \param table The table to operate on
+ * \param data Pointer to the data to insert. If a matching element is
+ * already in the table, receives it instead.
+ * \return int \c 0 if the data was inserted, \c 1 if a matching element was
+ * found, and \c -1 if there was an error.
+ * \note Equivalent to chash_lookup followed by chash_insert, but hashes the
+ * data and walks its bucket only once, and is atomic on concurrent tables.
+ */
+extern int chash_find_or_insert(CHash * table, void ** data);
+
+/**
+ * \brief Inserts \c data, replacing the element matching it if there is one
+ * \param table The table to operate on
+ * \param data The data to insert into the table.
+ * \return int \c 0 if the data was inserted, \c 1 if it replaced an element,
+ * and \c -1 if there was an error.
+ * \note The element replaced is passed to the destroy function, unless it is
+ * \c data itself. Map tables replace values instead, with chash_put, and
+ * return \c -1.
+ */
+extern int chash_upsert(CHash * table, const void * data);
+
+/**
+ * \brief Associates \c value with \c key in a map table
+ * \param table The map table to operate on
+ * \param key The key, which the table takes ownership of if it is inserted.
+ * \param value The value, which the table takes ownership of.
+ * \return int \c 0 if the key was inserted, \c 1 if the value of a matching
+ * key was replaced, and \c -1 if there was an error or the table is not a map.
+ * \note A replacement happens in place: the key already in the table stays
+ * there, and \c key remains the caller's. The old value is passed to the
+ * destroy_value function, unless it is \c value itself.
+ */
+extern int chash_put(CHash * table, const void * key, void * value);
+
+/**
+ * \brief Looks up the value associated with \c key in a map table
+ * \param table The map table to search
+ * \param key The key to search for
+ * \param value Receives the value if the key was found. May be \c NULL.
+ * \return int \c 1 if the key was found, \c 0 if it was not, and \c -1 if
+ * \c key is \c NULL or the table is not a map.
+ */
+extern int chash_get(CHash * table, const void * key, void ** value);
+
 /**
  * \brief Removes the element specified by data from the table
  * \param table The table to operate on
  * \param data Pointer to the data to remove. If set to \c NULL, removes the 
  * first element in the hash.
  * \return int \c 0 on success, \c -1 if there was an error.
+ * \note On a map table, the value of the element is destroyed in both cases.
  */
 extern int chash_remove(CHash * table, void ** data);
 
+/**
+ * \brief Sets the lifetime of an element of an expiring table
+ * \param table The table to operate on
+ * \param data The data whose element to change.
+ * \param ttl The number of milliseconds, from now, the element has left, or
+ * \c 0 for it to never expire.
+ * \return int \c 0 on success, \c -1 if no live element matches or the table
+ * does not expire its elements.
+ */
+extern int chash_expire(CHash * table, const void * data, uint64_t ttl);
+
+/**
+ * \brief Removes every element of an expiring table whose deadline has passed
+ * \param table The table to operate on
+ * \return unsigned int The number of elements removed.
+ * \note Each removed element is passed to the destroy function. Only the
+ * timer wheel slots that came due since the last call are visited, so
+ * removing k elements costs O(k), plus moving the later deadlines of those
+ * slots down a level. Until then, expired elements are only hidden from
+ * lookups: traversals, scans, and removals or lookups of \c NULL may still
+ * return them.
+ */
+extern unsigned int chash_reap(CHash * table);
+
+/**
+ * \brief Destroys elements a deferred table has queued for destruction
+ * \param table The table to operate on
+ * \param max The most elements to destroy, or \c 0 for all of them.
+ * \return unsigned int The number of elements destroyed.
+ * \note Oldest first. May be called while other threads use the table, and
+ * alongside its collector thread. Returns \c 0 if the table does not defer.
+ */
+extern unsigned int chash_collect(CHash * table, unsigned int max);
+
+/**
+ * \brief Takes a point-in-time view of a table created with snapshots
+ * \param table The table to operate on
+ * \return CHashSnapshot * The snapshot, or \c NULL on error.
+ * \note Takes constant time: nothing is copied until a writer changes a
+ * bucket, which then copies the chain of that one bucket first. The table
+ * does not resize while a snapshot is live, and the elements removed from it
+ * are only destroyed once no snapshot can still read them. The data returned
+ * by chash_remove with \c NULL belongs to the caller at once.
+ */
+extern CHashSnapshot * chash_snapshot(CHash * table);
+
+/**
+ * \brief Returns the number of elements in a table when it was snapshotted
+ * \param snapshot The snapshot
+ * \return unsigned int The size.
+ */
+extern unsigned int chash_snapshot_size(const CHashSnapshot * snapshot);
+
+/**
+ * \brief Searches a snapshot for an element
+ * \param snapshot The snapshot
+ * \param data The data in question. Receives the data found.
+ * \return int \c 1 if the table contained it when snapshotted, \c 0 if not.
+ */
+extern int chash_snapshot_lookup(CHashSnapshot * snapshot, void ** data);
+
+/**
+ * \brief Invokes \c callback on every element of a snapshot
+ * \param snapshot The snapshot
+ * \param callback The callback function to invoke on every element.
+ * \return void
+ * \note Holds one stripe at a time for reading, so writers keep going.
+ */
+extern void chash_snapshot_traverse(CHashSnapshot * snapshot,
+				    void (*callback)(void *));
+
+/**
+ * \brief Releases a snapshot
+ * \param snapshot The snapshot
+ * \return void
+ * \note Destroys the removed elements no other snapshot can read.
+ */
+extern void chash_snapshot_release(CHashSnapshot * snapshot);
+
 /**
  * \brief Invokes \c callback on every element in the hash
  * \param table The hash table to traverse
  * \param callback The callback function to invoke on every element.
  * \return void
+ * \note On a concurrent table, each stripe is locked while its elements are
+ * visited, so \c callback must not call back into the table.
  */
 extern void chash_traverse(CHash * table, void (*callback)(void *));
 
+/**
+ * \brief Calls \c callback on every element, from several threads at once
+ * \param table The table to traverse.
+ * \param callback The callback, which must be safe to call from several
+ * threads.
+ * \param threads The number of threads, or \c 0 for one per online processor.
+ * \return void
+ * \note The table is cut into many more chunks than there are threads, and
+ * each thread claims the next chunk when it finishes its last, so long chains
+ * and slow callbacks do not hold the others up. Concurrent tables are walked a
+ * stripe per chunk, under its read lock; other tables must not be modified
+ * meanwhile.
+ */
+extern void chash_traverse_parallel(CHash * table, void (*callback)(void *),
+				    int threads);
+
+/**
+ * \brief Visits the table one bucket at a time
+ * \param table The hash table to scan
+ * \param cursor \c 0 to start a scan, or the value returned by the previous
+ * call
+ * \param callback Invoked on every element of the bucket, with \c arg
+ * \param arg Passed through to \c callback
+ * \return uint64_t The cursor to pass to the next call, or \c 0 once the
+ * whole table has been visited.
+ * \note The table may be changed between two calls, and may grow or shrink
+ * during the scan. Every element that is in the table for the whole scan is
+ * visited at least once; elements may be visited more than once if the table
+ * shrinks. On the open engine, this only holds while the table does not
+ * resize. As with chash_traverse, \c callback must not call back into the
+ * table.
+ */
+extern uint64_t chash_scan(CHash * table, uint64_t cursor,
+			   void (*callback)(void *, void *), void * arg);
+
 /**
  * \brief Queries the hash for a specific data point
  * \param table The table to search
  * \param data The data to search for
  * \return int \c 1 if the data was found, \c 0 if it was not. 
  * If the data was found, data now contains the address of that data.
+ * \note If *data is \c NULL, any element of the table is returned, or \c 0
+ * if the table is empty.
  */
 extern int chash_lookup(CHash * table, void ** data);
 
+/**
+ * \brief Inserts several elements at once
+ * \param table The table to insert into
+ * \param data The elements to insert
+ * \param count The number of elements
+ * \return int The number of elements inserted. If this is less than
+ * \c count, data[return value] was already in the table or could not be
+ * inserted, and nothing after it was attempted.
+ * \note Behaves like calling chash_insert on each element, but hashes the
+ * whole batch and prefetches its buckets before linking anything in.
+ */
+extern int chash_insert_batch(CHash * table, const void ** data, int count);
+
+/**
+ * \brief Queries the hash for several data points at once
+ * \param table The table to search
+ * \param data The data to search for. Each element that is found is replaced
+ * by the address of the stored data, as with chash_lookup.
+ * \param count The number of elements of \c data
+ * \param results If not \c NULL, receives \c 1 or \c 0 for each element
+ * \return int The number of elements found.
+ * \note Unlike chash_lookup, a \c NULL element is never found.
+ * \note Hashes the whole batch and prefetches its buckets and their first
+ * elements before comparing anything, so the cache misses overlap. Tables
+ * using CHASH_ENGINE_OPEN, or a concurrency mode, look the elements up one by
+ * one.
+ */
+extern int chash_lookup_batch(CHash * table, void ** data, int count,
+			      int * results);
+
+/**
+ * \brief Sets the load factors which trigger growing and shrinking the table
+ * \param table The table to configure
+ * \param max The load factor above which the table doubles in size. \c 0
+ * disables growth.
+ * \param min The load factor below which the table halves in size. \c 0
+ * disables shrinking.
+ * \return int \c 0 on success, \c -1 if the factors are invalid.
+ * \note Resizing is incremental: a few buckets are migrated on each call to
+ * chash_insert, chash_lookup and chash_remove, so no single call pays for the
+ * whole rehash. \c min must be less than half of \c max, so that a shrink can
+ * never immediately trigger a grow. Tables using CHASH_ENGINE_OPEN ignore
+ * \c max, growing when 7/8ths of their slots are in use, and rehash in one
+ * call rather than incrementally.
+ */
+extern int chash_set_load_factor(CHash * table, float max, float min);
+
+/**
+ * \brief Reports the shape, memory footprint and counters of a table
+ * \param table The table to inspect
+ * \param stats Receives the statistics
+ * \return void
+ * \note Walks every bucket, so this costs as much as chash_traverse. On a
+ * concurrent table, each stripe is consistent but the stripes are read at
+ * different times.
+ */
+extern void chash_stats(CHash * table, CHashStats * stats);
+
+/**
+ * \brief Zeroes the operation counters of a table
+ * \param table The table
+ * \return void
+ */
+extern void chash_stats_reset(CHash * table);
+
+/**
+ * \brief Creates an arena allocating from chunks of \c chunksize bytes
+ * \param chunksize The size of each chunk requested from malloc
+ * \return CHashArena* The arena, or \c NULL on error.
+ */
+extern CHashArena * chash_arena_create(size_t chunksize);
+
+/**
+ * \brief Allocates from an arena. Matches the alloc member of CHashAllocator.
+ * \param arena The arena
+ * \param size The number of bytes
+ * \return void* The memory, or \c NULL on error.
+ */
+extern void * chash_arena_alloc(void * arena, size_t size);
+
+/**
+ * \brief Returns an allocator drawing from \c arena
+ * \param arena The arena
+ * \return CHashAllocator The allocator, for use in CHashOpts.
+ * \note Tables using this allocator never free memory. With a node pool and
+ * no destroy function, chash_destroy on such a table is O(1).
+ */
+extern CHashAllocator chash_arena_allocator(CHashArena * arena);
+
+/**
+ * \brief Frees all memory handed out by \c arena, and the arena itself.
+ * \param arena The arena
+ * \return void
+ */
+extern void chash_arena_destroy(CHashArena * arena);
+
+/**
+ * \brief Creates a table split into \c count shards
+ * \param size The number of containers, split between the shards.
+ * \param hash The user-defined hash function, as for chash_init_opts
+ * \param match The user-defined match function
+ * \param destroy The user-defined destroy function
+ * \param opts The options of every shard, or \c NULL for the defaults. A
+ * \c capacity is split between the shards, like \c size.
+ * \param count The number of shards, rounded up to a power of two.
+ * \param nodes The NUMA node of each shard, or \c NULL.
+ * \return CHashShards* The sharded table, or \c NULL on error.
+ * \note A shard given a node allocates from chash_numa_allocator, so \c nodes
+ * cannot be combined with \c opts.allocator. Its chained elements come from a
+ * node pool, of CHASH_SHARD_POOLSIZE unless \c opts.poolsize is set. If
+ * \c count is rounded up, the extra shards reuse \c nodes from the start.
+ */
+extern CHashShards * chash_shards_init(int size,
+				       int (*hash)(const void *),
+				       int (*match)(const void *, const void *),
+				       void (*destroy)(void *),
+				       const CHashOpts * opts,
+				       unsigned int count, const int * nodes);
+
+/**
+ * \brief Returns the index of the shard \c data belongs to
+ * \param shards The sharded table
+ * \param data The data in question
+ * \return unsigned int The shard, below \c shards->count.
+ */
+extern unsigned int chash_shards_index(CHashShards * shards,
+				       const void * data);
+
+/**
+ * \brief Returns the table of the shard \c data belongs to
+ * \param shards The sharded table
+ * \param data The data in question
+ * \return CHash* The table on which to insert, look up or remove \c data.
+ * \note The data is hashed once to pick the shard, and again by the
+ * operation done on the table.
+ */
+extern CHash * chash_shards_table(CHashShards * shards, const void * data);
+
+/**
+ * \brief Returns the number of elements of every shard together
+ * \param shards The sharded table
+ * \return size_t The total, only approximate while the shards change.
+ */
+extern size_t chash_shards_size(CHashShards * shards);
+
+/**
+ * \brief Invokes \c callback on every element of every shard
+ * \param shards The sharded table
+ * \param callback The callback function, as for chash_traverse.
+ * \return void
+ */
+extern void chash_shards_traverse(CHashShards * shards,
+				  void (*callback)(void *));
+
+/**
+ * \brief Fills in the statistics of every shard together
+ * \param shards The sharded table
+ * \param stats Receives the statistics. The counts are summed, \c max_chain
+ * is the longest chain of any shard, and \c bytes includes the shards array.
+ * \return void
+ */
+extern void chash_shards_stats(CHashShards * shards, CHashStats * stats);
+
+/**
+ * \brief Restricts the calling thread to the processors of the NUMA node of
+ * a shard
+ * \param shards The sharded table
+ * \param shard The shard
+ * \return int \c 0 on success, \c -1 if the shard has no node or the
+ * affinity could not be set.
+ * \note A thread bound to the node of the shards it works on reaches their
+ * memory without crossing sockets. Linux only.
+ */
+extern int chash_shards_bind(CHashShards * shards, unsigned int shard);
+
+/**
+ * \brief Destroys every shard, and the sharded table
+ * \param shards The sharded table
+ * \return void
+ */
+extern void chash_shards_destroy(CHashShards * shards);
+
+/**
+ * \brief Allocates on a NUMA node. Matches the alloc member of CHashAllocator.
+ * \param ctx The node, cast to a pointer
+ * \param size The number of bytes
+ * \return void* The memory, or \c NULL.
+ */
+extern void * chash_numa_alloc(void * ctx, size_t size);
+
+/**
+ * \brief Frees memory from chash_numa_alloc. Matches the free member of
+ * CHashAllocator.
+ * \param ctx The node, cast to a pointer
+ * \param ptr The memory
+ * \param size The size it was allocated with
+ * \return void
+ */
+extern void chash_numa_free(void * ctx, void * ptr, size_t size);
+
+/**
+ * \brief Returns an allocator placing memory on NUMA node \c node
+ * \param node The node
+ * \return CHashAllocator The allocator, for use in CHashOpts.
+ * \note Blocks of a page or more are mapped and bound to the node, preferring
+ * it rather than failing when it is full. Smaller ones come from malloc. On
+ * systems other than Linux, the node is ignored.
+ */
+extern CHashAllocator chash_numa_allocator(int node);
+
 #endif /* __ET_CHAIN_HASH_H__ */
 
 /*****************************************************************************/
@@ -0,0 +1,454 @@
+/******************************************************************************
+ * NAME:	    chash-alloc.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the allocators of the CHash API: the
+ *		    per-table node pool, and the arena allocator.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Memory management for the CHash API
+ *
+ * All memory of a table is requested through its CHashAllocator, which
+ * defaults to malloc/free. When the table has a node pool, chain elements are
+ * carved out of slabs of tbl->slabsize elements, and freed elements are kept
+ * on a per-table free list instead of being returned to the allocator. The
+ * slabs are only released when the table is destroyed. The elements of a map
+ * table are CHashMapElmts, so slabs are walked with a stride of
+ * chash_elmtsize() rather than indexed.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-internal.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct _CHashSlab_ {
+
+  struct _CHashSlab_ * next;
+  size_t bytes;
+  CHashElmt elmts[];
+
+} CHashSlab;
+
+typedef struct _CHashChunk_ {
+
+  struct _CHashChunk_ * next;
+  size_t used;
+  size_t bytes;
+  max_align_t data[];
+
+} CHashChunk;
+
+struct _CHashArena_ {
+
+  CHashChunk * chunks;
+  size_t chunksize;
+
+};
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    chash_arena_create
+ *
+ * DESCRIPTION:	    Creates an arena which hands out memory from large chunks
+ *		    and only frees it all at once, in chash_arena_destroy.
+ *
+ * ARGUMENTS:	    chunksize: (size_t) -- the size of each chunk requested from
+ *			malloc. Larger requests get a chunk of their own.
+ *
+ * RETURN:	    CHashArena * -- the arena, or NULL on error.
+ *
+ * NOTES:	    none.
+ ***/
+CHashArena * chash_arena_create(size_t chunksize)
+{
+  CHashArena * arena = malloc(sizeof(CHashArena));
+  if (arena == NULL)
+    return NULL;
+
+  arena->chunks = NULL;
+  arena->chunksize = chunksize;
+  return arena;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_arena_alloc
+ *
+ * DESCRIPTION:	    Allocates size bytes from the arena. Suitable as the alloc
+ *		    member of a CHashAllocator.
+ *
+ * ARGUMENTS:	    ctx: (void *) -- the arena.
+ *		    size: (size_t) -- number of bytes to allocate.
+ *
+ * RETURN:	    void * -- the memory, aligned for any type, or NULL.
+ *
+ * NOTES:	    none.
+ ***/
+void * chash_arena_alloc(void * ctx, size_t size)
+{
+  CHashArena * arena = (CHashArena *)ctx;
+  size = (size + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+
+  CHashChunk * chunk = arena->chunks;
+  if (chunk == NULL || chunk->bytes - chunk->used < size) {
+    size_t bytes = size > arena->chunksize ? size : arena->chunksize;
+    if ((chunk = malloc(sizeof(CHashChunk) + bytes)) == NULL)
+      return NULL;
+
+    chunk->used = 0;
+    chunk->bytes = bytes;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+  }
+
+  void * ptr = (char *)chunk->data + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_arena_allocator
+ *
+ * DESCRIPTION:	    Returns a CHashAllocator which draws from the arena.
+ *
+ * ARGUMENTS:	    arena: (CHashArena *) -- the arena.
+ *
+ * RETURN:	    CHashAllocator -- the allocator.
+ *
+ * NOTES:	    The allocator has no free function, so a table using it
+ *		    never returns its memory, and chash_destroy can skip doing
+ *		    so.
+ ***/
+CHashAllocator chash_arena_allocator(CHashArena * arena)
+{
+  return (CHashAllocator){.alloc = chash_arena_alloc,
+			  .free = NULL,
+			  .ctx = arena};
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_arena_destroy
+ *
+ * DESCRIPTION:	    Frees every chunk of the arena, and the arena.
+ *
+ * ARGUMENTS:	    arena: (CHashArena *) -- the arena.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Every table allocated from the arena must be destroyed
+ *		    first (or simply abandoned).
+ ***/
+void chash_arena_destroy(CHashArena * arena)
+{
+  while (arena->chunks != NULL) {
+    CHashChunk * next = arena->chunks->next;
+    free(arena->chunks);
+    arena->chunks = next;
+  }
+  free(arena);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_alloc
+ *
+ * DESCRIPTION:	    Allocates memory through a table's allocator.
+ *
+ * ARGUMENTS:	    allocator: (const CHashAllocator *) -- the allocator.
+ *		    size: (size_t) -- number of bytes to allocate.
+ *
+ * RETURN:	    void * -- the memory or NULL.
+ *
+ * NOTES:	    An allocator with no alloc function means malloc.
+ ***/
+void * cmem_alloc(const CHashAllocator * allocator, size_t size)
+{
+  if (allocator->alloc == NULL)
+    return malloc(size);
+  return allocator->alloc(allocator->ctx, size);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_calloc
+ *
+ * DESCRIPTION:	    Allocates zeroed memory through a table's allocator.
+ *
+ * ARGUMENTS:	    allocator: (const CHashAllocator *) -- the allocator.
+ *		    nmemb: (size_t) -- the number of members.
+ *		    size: (size_t) -- the size of each member.
+ *
+ * RETURN:	    void * -- the memory or NULL.
+ *
+ * NOTES:	    none.
+ ***/
+void * cmem_calloc(const CHashAllocator * allocator, size_t nmemb,
+		   size_t size)
+{
+  if (allocator->alloc == NULL)
+    return calloc(nmemb, size);
+
+  if (size != 0 && nmemb > SIZE_MAX / size)
+    return NULL;
+
+  void * ptr = allocator->alloc(allocator->ctx, nmemb * size);
+  if (ptr != NULL)
+    memset(ptr, 0, nmemb * size);
+  return ptr;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_free
+ *
+ * DESCRIPTION:	    Frees memory through a table's allocator.
+ *
+ * ARGUMENTS:	    allocator: (const CHashAllocator *) -- the allocator.
+ *		    ptr: (void *) -- the memory to free, may be NULL.
+ *		    size: (size_t) -- the size it was allocated with.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void cmem_free(const CHashAllocator * allocator, void * ptr, size_t size)
+{
+  if (ptr == NULL)
+    return;
+
+  if (allocator->alloc == NULL)
+    free(ptr);
+  else if (allocator->free != NULL)
+    allocator->free(allocator->ctx, ptr, size);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_node_alloc
+ *
+ * DESCRIPTION:	    Allocates a chain element for the table, from its free
+ *		    list if it has a node pool.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    CHashElmt * -- the element, or NULL.
+ *
+ * NOTES:	    When the free list is empty, a new slab of tbl->slabsize
+ *		    elements is allocated and threaded onto it. On concurrent
+ *		    tables the free list has a lock of its own.
+ ***/
+CHashElmt * cmem_node_alloc(CHash * tbl)
+{
+  size_t size = chash_elmtsize(tbl);
+  if (tbl->slabsize == 0)
+    return cmem_alloc(&(tbl->allocator), size);
+
+  cstripe_pool_lock(tbl);
+  if (tbl->freelist == NULL) {
+    size_t bytes = sizeof(CHashSlab) + tbl->slabsize * size;
+    CHashSlab * slab = cmem_alloc(&(tbl->allocator), bytes);
+    if (slab == NULL) {
+      cstripe_pool_unlock(tbl);
+      return NULL;
+    }
+
+    slab->bytes = bytes;
+    slab->next = tbl->slabs;
+    tbl->slabs = slab;
+    for (unsigned int i = 0; i < tbl->slabsize; i++) {
+      CHashElmt * elmt = (CHashElmt *)((char *)slab->elmts + i * size);
+      elmt->next = tbl->freelist;
+      tbl->freelist = elmt;
+    }
+  }
+
+  CHashElmt * elmt = tbl->freelist;
+  tbl->freelist = elmt->next;
+  cstripe_pool_unlock(tbl);
+  return elmt;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_node_block
+ *
+ * DESCRIPTION:	    Allocates count contiguous chain elements as one slab of
+ *		    the table's node pool.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, which must have a node pool.
+ *		    count: (size_t) -- the number of elements.
+ *
+ * RETURN:	    CHashElmt * -- the first element, or NULL.
+ *
+ * NOTES:	    The elements are not put on the free list. Each of them can
+ *		    later be freed with cmem_node_free like any other, and the
+ *		    slab is released with the rest. On a map table they are
+ *		    CHashMapElmts, and must be indexed as such.
+ ***/
+CHashElmt * cmem_node_block(CHash * tbl, size_t count)
+{
+  size_t size = chash_elmtsize(tbl);
+  if (count > (SIZE_MAX - sizeof(CHashSlab)) / size)
+    return NULL;
+
+  size_t bytes = sizeof(CHashSlab) + count * size;
+  CHashSlab * slab = cmem_alloc(&(tbl->allocator), bytes);
+  if (slab == NULL)
+    return NULL;
+
+  slab->bytes = bytes;
+  cstripe_pool_lock(tbl);
+  slab->next = tbl->slabs;
+  tbl->slabs = slab;
+  cstripe_pool_unlock(tbl);
+  return slab->elmts;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_node_free
+ *
+ * DESCRIPTION:	    Returns a chain element to the table's free list, or to
+ *		    its allocator if it has no node pool.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    elmt: (CHashElmt *) -- the element.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void cmem_node_free(CHash * tbl, CHashElmt * elmt)
+{
+  if (tbl->slabsize == 0) {
+    cmem_free(&(tbl->allocator), elmt, chash_elmtsize(tbl));
+    return;
+  }
+
+  cstripe_pool_lock(tbl);
+  elmt->next = tbl->freelist;
+  tbl->freelist = elmt;
+  cstripe_pool_unlock(tbl);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_elmt_get
+ *
+ * DESCRIPTION:	    Returns the element which links data into the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (const void *) -- the data to be linked.
+ *
+ * RETURN:	    CHashElmt * -- the element, with data set, or NULL.
+ *
+ * NOTES:	    For an intrusive table this is the hook inside data, and
+ *		    nothing is allocated. The value of an element of a map
+ *		    table starts out NULL, and the inline key of data is
+ *		    copied into the element.
+ ***/
+CHashElmt * cmem_elmt_get(CHash * tbl, const void * data)
+{
+  CHashElmt * elmt = tbl->intrusive
+    ? (CHashElmt *)((char *)data + tbl->hook) : cmem_node_alloc(tbl);
+  if (elmt == NULL)
+    return NULL;
+
+  elmt->data = (void *)data;
+  if (tbl->map)
+    *chash_valueof(elmt) = NULL;
+  chash_keyset(tbl, elmt, data);
+  return elmt;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_elmt_put
+ *
+ * DESCRIPTION:	    Releases an element unlinked from the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    elmt: (CHashElmt *) -- the element.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    A no-op for an intrusive table.
+ ***/
+void cmem_elmt_put(CHash * tbl, CHashElmt * elmt)
+{
+  if (!tbl->intrusive)
+    cmem_node_free(tbl, elmt);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_node_release
+ *
+ * DESCRIPTION:	    Frees every slab of the table's node pool at once,
+ *		    regardless of which elements are still linked.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    If the allocator has no free function, there is nothing to
+ *		    do and this returns immediately.
+ ***/
+void cmem_node_release(CHash * tbl)
+{
+  if (tbl->allocator.alloc != NULL && tbl->allocator.free == NULL) {
+    tbl->slabs = NULL;
+    tbl->freelist = NULL;
+    return;
+  }
+
+  CHashSlab * slab = tbl->slabs;
+  while (slab != NULL) {
+    CHashSlab * next = slab->next;
+    cmem_free(&(tbl->allocator), slab, slab->bytes);
+    slab = next;
+  }
+  tbl->slabs = NULL;
+  tbl->freelist = NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cmem_node_bytes
+ *
+ * DESCRIPTION:	    Returns the memory taken by the elements of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    size_t -- the size of every slab of the pool, including its
+ *		    free elements, or of the linked elements if there is none.
+ *
+ * NOTES:	    Zero for an intrusive table.
+ ***/
+size_t cmem_node_bytes(CHash * tbl)
+{
+  if (tbl->intrusive)
+    return 0; /* The hooks live in the user's objects. */
+  if (tbl->slabsize == 0)
+    return chash_size(tbl) * chash_elmtsize(tbl);
+
+  size_t bytes = 0;
+  cstripe_pool_lock(tbl);
+  for (CHashSlab * slab = tbl->slabs; slab != NULL; slab = slab->next)
+    bytes += slab->bytes;
+  cstripe_pool_unlock(tbl);
+  return bytes;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,46 @@
+/******************************************************************************
+ * NAME:	    chash-alloc.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for allocating the memory of a table:
+ *		    bucket arrays through the table's allocator, and chain
+ *		    elements through its node pool.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_CHASH_ALLOC_H__
+#define __ET_CHASH_ALLOC_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stddef.h>
+
+#include "chain-hash.h"
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern void * cmem_alloc(const CHashAllocator * allocator, size_t size);
+extern void * cmem_calloc(const CHashAllocator * allocator, size_t nmemb,
+			  size_t size);
+extern void cmem_free(const CHashAllocator * allocator, void * ptr,
+		      size_t size);
+
+extern CHashElmt * cmem_node_alloc(CHash * table);
+extern CHashElmt * cmem_node_block(CHash * table, size_t count);
+extern void cmem_node_free(CHash * table, CHashElmt * elmt);
+extern void cmem_node_release(CHash * table);
+extern size_t cmem_node_bytes(CHash * table);
+extern CHashElmt * cmem_elmt_get(CHash * table, const void * data);
+extern void cmem_elmt_put(CHash * table, CHashElmt * elmt);
+
+#endif /* __ET_CHASH_ALLOC_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,626 @@
+/******************************************************************************
+ * NAME:	    chash-bench.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Benchmark driver for the CHash API. Built by `make bench`.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Benchmark harness for the Chained-Hash table
+ *
+ * Every configuration fills a table with `size` keys, then runs each phase
+ * over it: lookups of present keys, lookups of absent keys, a mix of lookups
+ * and remove/insert pairs, and finally removal of every key. Keys are ints
+ * or strings, and the present keys of the lookup phases are drawn either
+ * uniformly or from a Zipfian distribution (s = 0.99) over a random
+ * permutation of the table.
+ *
+ * Each phase reports its mean cost per operation, and the 50th, 99th and
+ * 99.9th percentile latencies of one in every SAMPLE_EVERY operations, less
+ * the measured cost of reading the clock. The peak resident set size of the
+ * process is printed at the end.
+ *
+ * Without options the whole matrix of engines, key types, distributions,
+ * sizes and load factors is run. Each option restricts one axis:
+ *
+ *   -e chain|open|typed	Engine. "typed" is a CHASH_DEFINE table with int
+ *			keys stored inline, and only runs with int keys.
+ *   -k int|string|inline	Key type. "inline" is string keys stored inline
+ *			in the chain elements (chained engine only).
+ *   -d uniform|zipf	Distribution of lookups
+ *   -n size		Number of keys in the table
+ *   -l load		Maximum load factor (chained engine only)
+ *   -r ops		Operations per lookup and mixed phase
+ *   -s seed		Seed for the key and operation sequences
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chain-hash.h"
+#include "chash-typed.h"
+#include "hash-functions.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define SAMPLE_EVERY 16
+#define ZIPF_S 0.99
+#define KEY_LEN 24
+
+/* The typed table, benchmarked alongside the engines. */
+#define ENGINE_TYPED (CHASH_ENGINE_OPEN + 1)
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef enum { KEY_INT, KEY_STRING, KEY_INLINE } KeyType;
+typedef enum { DIST_UNIFORM, DIST_ZIPF } Dist;
+typedef enum { OP_HIT, OP_MISS, OP_REPLACE } OpKind;
+
+CHASH_DEFINE(IntMap, int, int, CHASH_TYPED_HASH_INT, CHASH_TYPED_EQ)
+
+typedef struct {
+
+  int engine;
+  KeyType keys;
+  Dist dist;
+  unsigned int size;
+  float load;
+  unsigned int ops;
+
+} Config;
+
+/* The keys of one configuration: size present keys, then size absent ones. */
+typedef struct {
+
+  unsigned int size;
+  int * ints;
+  char (* strings)[KEY_LEN];
+  void ** ptrs;
+
+} KeySet;
+
+/* Latency samples of one phase. */
+typedef struct {
+
+  double * ns;
+  unsigned int count;
+  unsigned int capacity;
+
+} Samples;
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static uint64_t next_random(void);
+static double now_ns(void);
+static void calibrate(void);
+static int match_int(const void *, const void *);
+static int match_string(const void *, const void *);
+static void keyset_init(KeySet *, const Config *);
+static void keyset_free(KeySet *);
+static unsigned int * draw_indices(const Config *, unsigned int);
+static void samples_add(Samples *, double);
+static double samples_percentile(Samples *, double);
+static int compare_double(const void *, const void *);
+static void report(const Config *, const char *, double, unsigned int,
+		   Samples *);
+static void run(const Config *);
+static void run_typed(const Config *);
+static void usage(const char *);
+
+/******************************************************************************
+ * LOCAL VARIABLES
+ ***/
+
+static uint64_t random_state = 0x2545f4914f6cdd1dULL;
+static double timer_overhead;
+
+/******************************************************************************
+ * MAIN
+ ***/
+
+int main(int argc, char * argv[])
+{
+  static const unsigned int all_sizes[] = {1000, 65536, 1048576};
+  static const float all_loads[] = {0.5f, 1.0f, 2.0f};
+
+  int engine = -1, keys = -1, dist = -1;
+  unsigned int size = 0, ops = 1000000;
+  float load = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "e:k:d:n:l:r:s:h")) != -1) {
+    switch (opt) {
+    case 'e':
+      engine = !strcmp(optarg, "open") ? CHASH_ENGINE_OPEN
+	: !strcmp(optarg, "typed") ? ENGINE_TYPED : CHASH_ENGINE_CHAIN;
+      break;
+    case 'k':
+      keys = !strcmp(optarg, "string") ? KEY_STRING
+	: !strcmp(optarg, "inline") ? KEY_INLINE : KEY_INT;
+      break;
+    case 'd': dist = !strcmp(optarg, "zipf") ? DIST_ZIPF : DIST_UNIFORM; break;
+    case 'n': size = strtoul(optarg, NULL, 0); break;
+    case 'l': load = strtof(optarg, NULL); break;
+    case 'r': ops = strtoul(optarg, NULL, 0); break;
+    case 's': random_state = strtoull(optarg, NULL, 0) | 1; break;
+    default: usage(argv[0]); return opt != 'h';
+    }
+  }
+
+  calibrate();
+  printf("timer overhead: %.0f ns\n", timer_overhead);
+  printf("%-6s %-6s %-7s %8s %5s %-8s %9s %9s %9s %9s\n", "engine", "keys",
+	 "dist", "size", "load", "phase", "ns/op", "p50", "p99", "p99.9");
+
+  for (int e = CHASH_ENGINE_CHAIN; e <= ENGINE_TYPED; e++) {
+    for (int k = KEY_INT; k <= KEY_INLINE; k++) {
+      for (int d = DIST_UNIFORM; d <= DIST_ZIPF; d++) {
+	for (int s = 0; s < 3; s++) {
+	  for (int l = 0; l < 3; l++) {
+	    if ((engine >= 0 && e != engine) || (keys >= 0 && k != keys)
+		|| (dist >= 0 && d != dist))
+	      continue;
+	    if ((size && s > 0) || (load > 0 && l > 0))
+	      continue;
+	    /* The open engine has a fixed load factor. */
+	    if (e != CHASH_ENGINE_CHAIN && l > 0)
+	      continue;
+	    if (e == ENGINE_TYPED && k != KEY_INT)
+	      continue;
+	    if (e != CHASH_ENGINE_CHAIN && k == KEY_INLINE)
+	      continue;
+
+	    Config config = {
+	      .engine = e, .keys = k, .dist = d,
+	      .size = size ? size : all_sizes[s],
+	      .load = load > 0 ? load : all_loads[l],
+	      .ops = ops
+	    };
+	    if (e == ENGINE_TYPED)
+	      run_typed(&config);
+	    else
+	      run(&config);
+	  }
+	}
+      }
+    }
+  }
+
+  struct rusage self;
+  getrusage(RUSAGE_SELF, &self);
+  printf("peak RSS: %ld KiB\n", self.ru_maxrss);
+  return 0;
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    run
+ *
+ * DESCRIPTION:	    Runs every phase of one configuration and reports on each.
+ *
+ * ARGUMENTS:	    config: (const Config *) -- the configuration.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The operation sequences are drawn before any timing starts.
+ ***/
+static void run(const Config * config)
+{
+  KeySet keys;
+  keyset_init(&keys, config);
+
+  CHashOpts opts = {.engine = config->engine};
+  if (config->keys == KEY_INLINE) {
+    opts.inlinekey = KEY_LEN;
+    opts.key = chash_key_string;
+  }
+  CHash * tbl = config->keys == KEY_INT
+    ? chash_init_opts(16, chash_hash_int, match_int, NULL, &opts)
+    : chash_init_opts(16, chash_hash_string, match_string, NULL, &opts);
+  if (tbl == NULL || chash_set_load_factor(tbl, config->load, 0)) {
+    fprintf(stderr, "chash-bench: could not create the table\n");
+    exit(1);
+  }
+
+  unsigned int * hits = draw_indices(config, config->ops);
+  unsigned int * kinds = malloc(config->ops * sizeof(unsigned int));
+  for (unsigned int i = 0; i < config->ops; i++) {
+    unsigned int roll = next_random() % 100;
+    kinds[i] = roll < 70 ? OP_HIT : roll < 80 ? OP_MISS : OP_REPLACE;
+  }
+
+  Samples samples = {0};
+  double start = now_ns();
+  for (unsigned int i = 0; i < config->size; i++) {
+    if (i % SAMPLE_EVERY) {
+      chash_insert(tbl, keys.ptrs[i]);
+      continue;
+    }
+    double op = now_ns();
+    chash_insert(tbl, keys.ptrs[i]);
+    samples_add(&samples, now_ns() - op);
+  }
+  report(config, "insert", now_ns() - start, config->size, &samples);
+
+  start = now_ns();
+  for (unsigned int i = 0; i < config->ops; i++) {
+    void * data = keys.ptrs[hits[i]];
+    if (i % SAMPLE_EVERY) {
+      chash_lookup(tbl, &data);
+      continue;
+    }
+    double op = now_ns();
+    chash_lookup(tbl, &data);
+    samples_add(&samples, now_ns() - op);
+  }
+  report(config, "hit", now_ns() - start, config->ops, &samples);
+
+  start = now_ns();
+  for (unsigned int i = 0; i < config->ops; i++) {
+    void * data = keys.ptrs[config->size + hits[i]];
+    if (i % SAMPLE_EVERY) {
+      chash_lookup(tbl, &data);
+      continue;
+    }
+    double op = now_ns();
+    chash_lookup(tbl, &data);
+    samples_add(&samples, now_ns() - op);
+  }
+  report(config, "miss", now_ns() - start, config->ops, &samples);
+
+  /* 70% hits, 10% misses and 20% removals of a key followed by its reinsert. */
+  start = now_ns();
+  for (unsigned int i = 0; i < config->ops; i++) {
+    void * data = keys.ptrs[(kinds[i] == OP_MISS ? config->size : 0)
+			     + hits[i]];
+    double op = i % SAMPLE_EVERY ? 0 : now_ns();
+    if (kinds[i] == OP_REPLACE) {
+      chash_remove(tbl, &data);
+      chash_insert(tbl, keys.ptrs[hits[i]]);
+    } else {
+      chash_lookup(tbl, &data);
+    }
+    if (!(i % SAMPLE_EVERY))
+      samples_add(&samples, now_ns() - op);
+  }
+  report(config, "mixed", now_ns() - start, config->ops, &samples);
+
+  start = now_ns();
+  for (unsigned int i = 0; i < config->size; i++) {
+    void * data = keys.ptrs[i];
+    if (i % SAMPLE_EVERY) {
+      chash_remove(tbl, &data);
+      continue;
+    }
+    double op = now_ns();
+    chash_remove(tbl, &data);
+    samples_add(&samples, now_ns() - op);
+  }
+  report(config, "remove", now_ns() - start, config->size, &samples);
+
+  chash_destroy(tbl);
+  free(samples.ns);
+  free(kinds);
+  free(hits);
+  keyset_free(&keys);
+}
+
+/******************************************************************************
+ * FUNCTION:	    run_typed
+ *
+ * DESCRIPTION:	    Runs every phase of one configuration on an IntMap.
+ *
+ * ARGUMENTS:	    config: (const Config *) -- the configuration, with int
+ *			keys.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Mirrors run(), with the keys passed by value.
+ ***/
+static void run_typed(const Config * config)
+{
+  KeySet keys;
+  keyset_init(&keys, config);
+
+  IntMap map;
+  if (IntMap_init(&map, 16)) {
+    fprintf(stderr, "chash-bench: could not create the table\n");
+    exit(1);
+  }
+
+  unsigned int * hits = draw_indices(config, config->ops);
+  unsigned int * kinds = malloc(config->ops * sizeof(unsigned int));
+  for (unsigned int i = 0; i < config->ops; i++) {
+    unsigned int roll = next_random() % 100;
+    kinds[i] = roll < 70 ? OP_HIT : roll < 80 ? OP_MISS : OP_REPLACE;
+  }
+
+  Samples samples = {0};
+  double start = now_ns();
+  for (unsigned int i = 0; i < config->size; i++) {
+    double op = i % SAMPLE_EVERY ? 0 : now_ns();
+    IntMap_put(&map, keys.ints[i], i);
+    if (!(i % SAMPLE_EVERY))
+      samples_add(&samples, now_ns() - op);
+  }
+  report(config, "insert", now_ns() - start, config->size, &samples);
+
+  volatile int sink = 0;
+  for (int miss = 0; miss < 2; miss++) {
+    start = now_ns();
+    for (unsigned int i = 0; i < config->ops; i++) {
+      double op = i % SAMPLE_EVERY ? 0 : now_ns();
+      int * value = IntMap_get(&map, keys.ints[miss * config->size + hits[i]]);
+      if (value != NULL)
+	sink = *value;
+      if (!(i % SAMPLE_EVERY))
+	samples_add(&samples, now_ns() - op);
+    }
+    report(config, miss ? "miss" : "hit", now_ns() - start, config->ops,
+	   &samples);
+  }
+
+  start = now_ns();
+  for (unsigned int i = 0; i < config->ops; i++) {
+    int key = keys.ints[(kinds[i] == OP_MISS ? config->size : 0) + hits[i]];
+    double op = i % SAMPLE_EVERY ? 0 : now_ns();
+    if (kinds[i] == OP_REPLACE) {
+      IntMap_remove(&map, key, NULL);
+      IntMap_put(&map, key, hits[i]);
+    } else {
+      int * value = IntMap_get(&map, key);
+      if (value != NULL)
+	sink = *value;
+    }
+    if (!(i % SAMPLE_EVERY))
+      samples_add(&samples, now_ns() - op);
+  }
+  report(config, "mixed", now_ns() - start, config->ops, &samples);
+  (void)sink;
+
+  start = now_ns();
+  for (unsigned int i = 0; i < config->size; i++) {
+    double op = i % SAMPLE_EVERY ? 0 : now_ns();
+    IntMap_remove(&map, keys.ints[i], NULL);
+    if (!(i % SAMPLE_EVERY))
+      samples_add(&samples, now_ns() - op);
+  }
+  report(config, "remove", now_ns() - start, config->size, &samples);
+
+  IntMap_destroy(&map);
+  free(samples.ns);
+  free(kinds);
+  free(hits);
+  keyset_free(&keys);
+}
+
+/******************************************************************************
+ * FUNCTION:	    report
+ *
+ * DESCRIPTION:	    Prints one line of results, and empties the samples.
+ *
+ * ARGUMENTS:	    config: (const Config *) -- the configuration.
+ *		    phase: (const char *) -- the name of the phase.
+ *		    elapsed: (double) -- the duration of the phase, in ns.
+ *		    ops: (unsigned int) -- the operations in the phase.
+ *		    samples: (Samples *) -- the sampled latencies.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void report(const Config * config, const char * phase, double elapsed,
+		   unsigned int ops, Samples * samples)
+{
+  printf("%-6s %-6s %-7s %8u %5.2f %-8s %9.1f %9.0f %9.0f %9.0f\n",
+	 config->engine == ENGINE_TYPED ? "typed"
+	 : config->engine == CHASH_ENGINE_OPEN ? "open" : "chain",
+	 config->keys == KEY_INT ? "int"
+	 : config->keys == KEY_INLINE ? "inline" : "string",
+	 config->dist == DIST_ZIPF ? "zipf" : "uniform", config->size,
+	 config->engine != CHASH_ENGINE_CHAIN ? 0.875 : config->load, phase,
+	 elapsed / ops, samples_percentile(samples, 0.5),
+	 samples_percentile(samples, 0.99), samples_percentile(samples, 0.999));
+  fflush(stdout);
+  samples->count = 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    keyset_init
+ *
+ * DESCRIPTION:	    Generates 2 * config->size distinct keys, of which the
+ *		    first half are inserted and the second half never are.
+ *
+ * ARGUMENTS:	    keys: (KeySet *) -- the key set to fill.
+ *		    config: (const Config *) -- the configuration.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Int keys are random odd numbers for present keys and random
+ *		    even numbers for absent ones, so the two halves never meet.
+ ***/
+static void keyset_init(KeySet * keys, const Config * config)
+{
+  unsigned int count = 2 * config->size;
+  keys->size = config->size;
+  keys->ints = NULL;
+  keys->strings = NULL;
+  keys->ptrs = malloc(count * sizeof(void *));
+
+  if (config->keys == KEY_INT) {
+    keys->ints = malloc(count * sizeof(int));
+    /* A multiplicative permutation keeps the keys distinct but scattered. */
+    for (unsigned int i = 0; i < count; i++) {
+      keys->ints[i] = (int)(((i % config->size) * 2654435761u) * 2
+			    + (i < config->size));
+      keys->ptrs[i] = &(keys->ints[i]);
+    }
+  } else {
+    keys->strings = malloc(count * KEY_LEN);
+    for (unsigned int i = 0; i < count; i++) {
+      snprintf(keys->strings[i], KEY_LEN, "%s:%016llx",
+	       i < config->size ? "hit" : "miss",
+	       (unsigned long long)next_random());
+      keys->ptrs[i] = keys->strings[i];
+    }
+  }
+}
+
+static void keyset_free(KeySet * keys)
+{
+  free(keys->ptrs);
+  free(keys->ints);
+  free(keys->strings);
+}
+
+/******************************************************************************
+ * FUNCTION:	    draw_indices
+ *
+ * DESCRIPTION:	    Draws a sequence of key indices in [0, config->size).
+ *
+ * ARGUMENTS:	    config: (const Config *) -- the configuration.
+ *		    count: (unsigned int) -- the length of the sequence.
+ *
+ * RETURN:	    unsigned int * -- the sequence, to be freed by the caller.
+ *
+ * NOTES:	    The Zipfian ranks are mapped through a random permutation,
+ *		    so the popular keys are spread over the whole table.
+ ***/
+static unsigned int * draw_indices(const Config * config, unsigned int count)
+{
+  unsigned int * indices = malloc(count * sizeof(unsigned int));
+  if (config->dist == DIST_UNIFORM) {
+    for (unsigned int i = 0; i < count; i++)
+      indices[i] = next_random() % config->size;
+    return indices;
+  }
+
+  unsigned int n = config->size;
+  double * cdf = malloc(n * sizeof(double));
+  unsigned int * perm = malloc(n * sizeof(unsigned int));
+  double sum = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    sum += 1.0 / pow(i + 1, ZIPF_S);
+    cdf[i] = sum;
+    perm[i] = i;
+  }
+  for (unsigned int i = n - 1; i > 0; i--) {
+    unsigned int j = next_random() % (i + 1), tmp = perm[i];
+    perm[i] = perm[j];
+    perm[j] = tmp;
+  }
+
+  for (unsigned int i = 0; i < count; i++) {
+    double u = (next_random() >> 11) * (1.0 / 9007199254740992.0) * sum;
+    unsigned int lo = 0, hi = n - 1;
+    while (lo < hi) {
+      unsigned int mid = lo + (hi - lo) / 2;
+      if (cdf[mid] < u)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+    indices[i] = perm[lo];
+  }
+
+  free(perm);
+  free(cdf);
+  return indices;
+}
+
+static void samples_add(Samples * samples, double ns)
+{
+  ns = ns > timer_overhead ? ns - timer_overhead : 0;
+  if (samples->count == samples->capacity) {
+    samples->capacity = samples->capacity ? samples->capacity * 2 : 4096;
+    samples->ns = realloc(samples->ns, samples->capacity * sizeof(double));
+  }
+  samples->ns[samples->count++] = ns;
+}
+
+static double samples_percentile(Samples * samples, double p)
+{
+  if (samples->count == 0)
+    return 0;
+
+  /* Sorting is idempotent, so later percentiles reuse the sorted array. */
+  qsort(samples->ns, samples->count, sizeof(double), compare_double);
+  return samples->ns[(unsigned int)(p * (samples->count - 1))];
+}
+
+static int compare_double(const void * a, const void * b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* xorshift64*, so that runs are reproducible from the seed. */
+static uint64_t next_random(void)
+{
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+  return random_state * 0x2545f4914f6cdd1dULL;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* The median cost of an empty timed region. */
+static void calibrate(void)
+{
+  Samples samples = {0};
+  for (int i = 0; i < 10001; i++) {
+    double op = now_ns();
+    samples_add(&samples, now_ns() - op);
+  }
+  timer_overhead = samples_percentile(&samples, 0.5);
+  free(samples.ns);
+}
+
+static int match_int(const void * a, const void * b)
+{
+  return *(const int *)a == *(const int *)b;
+}
+
+static int match_string(const void * a, const void * b)
+{
+  return !strcmp(a, b);
+}
+
+static void usage(const char * name)
+{
+  fprintf(stderr, "Usage: %s [-e chain|open|typed] [-k int|string|inline]"
+	  "\n\t[-d uniform|zipf] [-n size] [-l load] [-r ops] [-s seed]\n",
+	  name);
+}
+
+/*****************************************************************************/
@@ -0,0 +1,139 @@
+/******************************************************************************
+ * NAME:	    chash-bitmap.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the occupancy bitmaps of the bucket
+ *		    arrays of chained tables.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Occupied-bucket tracking for the chained engine
+ *
+ * Every bucket array is followed, in the same allocation, by a bitmap with
+ * one bit per bucket, set exactly when the bucket is not empty. Anything that
+ * walks the whole table can then skip 64 empty buckets at a time. A bit only
+ * changes while the stripe covering its bucket is held for writing, but one
+ * word may cover buckets of several stripes, so concurrent tables change the
+ * bits with atomic operations.
+ */
+
+#ifndef __ET_CHASH_BITMAP_H__
+#define __ET_CHASH_BITMAP_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+
+#include "chain-hash.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The number of words in the bitmap of an array of the given size. */
+#define CBITS_WORDS(Buckets) (((size_t)(Buckets) + 63) / 64)
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* The bitmap of an array, which starts on the first 8-byte boundary after it. */
+static inline uint64_t * cbits_of(CHashElmt ** table, unsigned int buckets)
+{
+  return (uint64_t *)(table + ((size_t)buckets + 1) / 2 * 2);
+}
+
+/* The size of an array of the given size and its bitmap, in bytes. */
+static inline size_t cbits_table_bytes(unsigned int buckets)
+{
+  return ((size_t)buckets + 1) / 2 * 2 * sizeof(CHashElmt *)
+    + CBITS_WORDS(buckets) * sizeof(uint64_t);
+}
+
+static inline void cbits_set(const CHash * tbl, uint64_t * bits,
+			     unsigned int bucket)
+{
+  if (tbl->locks != NULL)
+    __atomic_fetch_or(&(bits[bucket / 64]), 1ULL << (bucket % 64),
+		      __ATOMIC_RELAXED);
+  else
+    bits[bucket / 64] |= 1ULL << (bucket % 64);
+}
+
+static inline void cbits_clear(const CHash * tbl, uint64_t * bits,
+			       unsigned int bucket)
+{
+  if (tbl->locks != NULL)
+    __atomic_fetch_and(&(bits[bucket / 64]), ~(1ULL << (bucket % 64)),
+		       __ATOMIC_RELAXED);
+  else
+    bits[bucket / 64] &= ~(1ULL << (bucket % 64));
+}
+
+/* The first set bit in [from, end), or end if there is none. */
+static inline unsigned int cbits_scan(const uint64_t * bits, unsigned int from,
+				      unsigned int end)
+{
+  for (unsigned int word = from / 64; from < end; word++, from = word * 64) {
+    uint64_t set = __atomic_load_n(&(bits[word]), __ATOMIC_RELAXED)
+      & (~0ULL << (from % 64));
+    if (set != 0) {
+      unsigned int bucket = word * 64 + __builtin_ctzll(set);
+      return bucket < end ? bucket : end;
+    }
+  }
+  return end;
+}
+
+/*
+ * The occupied bucket after bucket covered by the same stripe, or buckets if
+ * none. Interleaved stripes have no run of buckets to scan, so their bits are
+ * tested one at a time.
+ */
+static inline unsigned int cbits_next(const CHash * tbl, const uint64_t * bits,
+				      unsigned int buckets, unsigned int bucket)
+{
+  if (tbl->stripes == 1)
+    return cbits_scan(bits, bucket + 1, buckets);
+
+  if (tbl->index == CHASH_INDEX_FIBONACCI) {
+    unsigned int span = buckets / tbl->stripes;
+    unsigned int end = (bucket / span + 1) * span;
+    unsigned int next = cbits_scan(bits, bucket + 1, end);
+    return next < end ? next : buckets;
+  }
+
+  while ((bucket = cstripe_next(tbl, bucket, buckets)) < buckets) {
+    if (__atomic_load_n(&(bits[bucket / 64]), __ATOMIC_RELAXED)
+	& (1ULL << (bucket % 64)))
+      break;
+  }
+  return bucket;
+}
+
+/* The first occupied bucket covered by stripe, or buckets if none. */
+static inline unsigned int cbits_first(const CHash * tbl,
+				       const uint64_t * bits,
+				       unsigned int buckets,
+				       unsigned int stripe)
+{
+  unsigned int bucket = cstripe_first(tbl, stripe, buckets);
+  if (bucket >= buckets)
+    return buckets;
+  if (__atomic_load_n(&(bits[bucket / 64]), __ATOMIC_RELAXED)
+      & (1ULL << (bucket % 64)))
+    return bucket;
+  return cbits_next(tbl, bits, buckets, bucket);
+}
+
+#endif /* __ET_CHASH_BITMAP_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,380 @@
+/******************************************************************************
+ * NAME:	    chash-build.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for chash_build and chash_build_parallel,
+ *		    which create a table from an array of elements in bulk.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Bulk construction for the CHash API
+ *
+ * The chained engine builds the table with a counting sort: one pass hashes
+ * every element and counts the elements per bucket, the prefix sums of the
+ * counts give each bucket its run of a single block of chain elements, and a
+ * second pass fills the runs in. Every chain then lies in order in one run,
+ * and nothing is allocated per element. The hashing and the linking of the
+ * chains touch nothing shared, and may run on several threads.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <limits.h>
+#include <stdint.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-bitmap.h"
+#include "chash-filter.h"
+#include "chash-internal.h"
+#include "chash-parallel.h"
+#include "chash-stats.h"
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct _CBuild_ {
+
+  CHash * tbl;
+  void ** data;
+  unsigned int count;
+  uint64_t * hashes;
+  unsigned int * starts;
+  CHashElmt * block;
+  unsigned int size;
+  int invalid;
+
+} CBuild;
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static int build_sorted(CHash *, void **, unsigned int, int);
+static void hash_chunk(void *, uint64_t);
+static void link_chunk(void *, uint64_t);
+static int build_hooks(CHash *, void **, unsigned int);
+static CHashElmt * find_chain(CHash *, CHashElmt *, const void *, uint64_t);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    chash_build
+ *
+ * DESCRIPTION:	    Creates a table holding every element of an array.
+ *
+ * ARGUMENTS:	    data: (void **) -- the elements, none of them NULL.
+ *		    count: (int) -- the number of elements.
+ *		    hash: (int (*)(const void *)) -- user-defined hash function
+ *		    match: (int (*)(const void *, const void *) -- user defined
+ *			function to compare two keys.
+ *		    destroy: (void (*)(void *)) -- user-defined function to
+ *			free allocated memory.
+ *		    opts: (const CHashOpts *) -- the options, or NULL.
+ *
+ * RETURN:	    CHash * -- the table, or NULL on error.
+ *
+ * NOTES:	    Same as chash_build_parallel on one thread.
+ ***/
+CHash * chash_build(void ** data, int count,
+		    int (*hash)(const void *),
+		    int (*match)(const void *, const void *),
+		    void (*destroy)(void *), const CHashOpts * opts)
+{
+  return chash_build_parallel(data, count, hash, match, destroy, opts, 1);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_build_parallel
+ *
+ * DESCRIPTION:	    Creates a table holding every element of an array, hashing
+ *		    the elements and linking the chains on several threads.
+ *
+ * ARGUMENTS:	    data, count, hash, match, destroy, opts: as for
+ *			chash_build.
+ *		    threads: (int) -- the number of threads, or 0 or less for
+ *			one per online processor.
+ *
+ * RETURN:	    CHash * -- the table, or NULL on error.
+ *
+ * NOTES:	    The table is sized so that count elements stay under the
+ *		    default maximum load factor. The open engine and intrusive
+ *		    tables simply insert the elements on the calling thread. On
+ *		    error, no element has been passed to destroy. hash, match
+ *		    and opts->key must be safe to call from several threads.
+ *		    Map tables are not built this way, since the elements have
+ *		    no values to go with them, and neither are cache tables,
+ *		    which would have to evict part of the array, or expiring
+ *		    ones, whose elements must be put on timer wheels.
+ ***/
+CHash * chash_build_parallel(void ** data, int count,
+			     int (*hash)(const void *),
+			     int (*match)(const void *, const void *),
+			     void (*destroy)(void *), const CHashOpts * opts,
+			     int threads)
+{
+  if (count < 0
+      || (opts != NULL && (opts->map || opts->capacity || opts->expiry)))
+    return NULL;
+
+  CHashOpts options = opts != NULL ? *opts : (CHashOpts){0};
+  double size = count / CHASH_DEFAULT_MAX_LOAD;
+  if (options.engine == CHASH_ENGINE_OPEN)
+    size = (double)count * 8 / 7;
+  else if (!options.intrusive && options.poolsize == 0)
+    options.poolsize = CHASH_BUILD_POOLSIZE;
+
+  CHash * tbl = chash_init_opts(size < 1 ? 1 : size < INT_MAX ? size + 1
+				: INT_MAX, hash, match, destroy, &options);
+  if (tbl == NULL)
+    return NULL;
+
+  int result = 0;
+  if (tbl->engine == CHASH_ENGINE_OPEN) {
+    for (int i = 0; i < count && result >= 0; i++)
+      result = chash_insert(tbl, data[i]);
+  } else if (tbl->intrusive) {
+    result = build_hooks(tbl, data, count);
+  } else {
+    result = build_sorted(tbl, data, count, threads);
+  }
+
+  /* The chains were linked directly, so the filter has yet to see them. */
+  if (result >= 0 && tbl->filter != NULL)
+    result = cfilter_rebuild(tbl, chash_size(tbl));
+  if (result < 0) {
+    tbl->destroy = NULL; /* The elements still belong to the caller. */
+    chash_destroy(tbl);
+    return NULL;
+  }
+  return tbl;
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    build_sorted
+ *
+ * DESCRIPTION:	    Fills an empty chained table from an array, sorting the
+ *		    elements into one block of chain elements by bucket.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with a node pool.
+ *		    data: (void **) -- the elements.
+ *		    count: (unsigned int) -- the number of elements.
+ *		    threads: (int) -- as for chash_build_parallel.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    The sort is stable, so each chain keeps the order of the
+ *		    array, and the first of several matching elements is the
+ *		    one kept. The element of a duplicate goes to the free list.
+ *		    starts[b] holds the start of bucket b, and then the end of
+ *		    it once the elements have been placed. Only the placement
+ *		    runs on the calling thread alone.
+ ***/
+static int build_sorted(CHash * tbl, void ** data, unsigned int count,
+			int threads)
+{
+  if (count == 0)
+    return 0;
+
+  CBuild build = {
+    .tbl = tbl,
+    .data = data,
+    .count = count,
+    .hashes = cmem_calloc(&(tbl->allocator), count, sizeof(uint64_t)),
+    .starts = cmem_calloc(&(tbl->allocator), tbl->buckets + 1,
+			  sizeof(unsigned int)),
+    .block = cmem_node_block(tbl, count),
+    .size = 0,
+    .invalid = 0
+  };
+  int result = -1;
+  if (build.hashes == NULL || build.starts == NULL || build.block == NULL)
+    goto out;
+
+  cpar_run(threads, (count + CPAR_ELEMENTS - 1) / CPAR_ELEMENTS, hash_chunk,
+	   &build);
+  if (build.invalid)
+    goto out;
+
+  unsigned int * starts = build.starts;
+  for (unsigned int i = 0; i < count; i++)
+    starts[chash_indexof(tbl, build.hashes[i], tbl->buckets) + 1]++;
+  for (unsigned int b = 0; b < tbl->buckets; b++)
+    starts[b + 1] += starts[b];
+
+  for (unsigned int i = 0; i < count; i++) {
+    CHashElmt * elmt = chash_elmtat(tbl, build.block,
+				    starts[chash_indexof(tbl, build.hashes[i],
+							 tbl->buckets)]++);
+    elmt->hash = build.hashes[i];
+    elmt->data = data[i];
+  }
+
+  cpar_run(threads, (tbl->buckets + CPAR_BUCKETS - 1) / CPAR_BUCKETS,
+	   link_chunk, &build);
+  for (unsigned int i = 0; build.size < count && i < count; i++) {
+    CHashElmt * elmt = chash_elmtat(tbl, build.block, i);
+    if (elmt->data == NULL)
+      cmem_node_free(tbl, elmt);
+  }
+
+  tbl->size = build.size;
+  cstats_count(tbl, inserts, build.size);
+  result = 0;
+
+ out:
+  cmem_free(&(tbl->allocator), build.hashes, count * sizeof(uint64_t));
+  cmem_free(&(tbl->allocator), build.starts,
+	    (tbl->buckets + 1) * sizeof(unsigned int));
+  return result;
+}
+
+/******************************************************************************
+ * FUNCTION:	    hash_chunk
+ *
+ * DESCRIPTION:	    Hashes CPAR_ELEMENTS elements of a build.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the CBuild.
+ *		    chunk: (uint64_t) -- the chunk of the array.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Sets invalid if an element is NULL.
+ ***/
+static void hash_chunk(void * arg, uint64_t chunk)
+{
+  CBuild * build = arg;
+  unsigned int end = (chunk + 1) * CPAR_ELEMENTS < build->count
+    ? (chunk + 1) * CPAR_ELEMENTS : build->count;
+  for (unsigned int i = chunk * CPAR_ELEMENTS; i < end; i++) {
+    if (build->data[i] == NULL) {
+      __atomic_store_n(&(build->invalid), 1, __ATOMIC_RELAXED);
+      return;
+    }
+    build->hashes[i] = chash_hashof(build->tbl, build->data[i]);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    link_chunk
+ *
+ * DESCRIPTION:	    Links the chains of CPAR_BUCKETS buckets of a build.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the CBuild.
+ *		    chunk: (uint64_t) -- the range of buckets.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The elements of bucket b lie between starts[b - 1] and
+ *		    starts[b]. Each takes its inline key, if any, before its
+ *		    chain is searched. A duplicate has its data cleared, to be
+ *		    put on the free list afterwards, since the pool has no
+ *		    lock. The ranges cover whole words of the bitmap.
+ ***/
+static void link_chunk(void * arg, uint64_t chunk)
+{
+  CBuild * build = arg;
+  CHash * tbl = build->tbl;
+  uint64_t * bits = cbits_of(tbl->table, tbl->buckets);
+  unsigned int end = (chunk + 1) * CPAR_BUCKETS < tbl->buckets
+    ? (chunk + 1) * CPAR_BUCKETS : tbl->buckets;
+  unsigned int size = 0;
+  for (unsigned int b = chunk * CPAR_BUCKETS; b < end; b++) {
+    CHashElmt ** tail = &(tbl->table[b]);
+    for (unsigned int i = b > 0 ? build->starts[b - 1] : 0;
+	 i < build->starts[b]; i++) {
+      CHashElmt * elmt = chash_elmtat(tbl, build->block, i);
+      chash_keyset(tbl, elmt, elmt->data);
+      if (find_chain(tbl, tbl->table[b], elmt->data, elmt->hash) != NULL) {
+	elmt->data = NULL;
+	continue;
+      }
+      elmt->next = NULL;
+      *tail = elmt;
+      tail = &(elmt->next);
+      size++;
+    }
+    if (tbl->table[b] != NULL)
+      cbits_set(tbl, bits, b);
+  }
+  __atomic_fetch_add(&(build->size), size, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * FUNCTION:	    build_hooks
+ *
+ * DESCRIPTION:	    Fills an empty intrusive table from an array.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    data: (void **) -- the elements.
+ *		    count: (unsigned int) -- the number of elements.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    The hooks live in the elements, so there is nothing to lay
+ *		    out, and each element is pushed onto its bucket directly.
+ ***/
+static int build_hooks(CHash * tbl, void ** data, unsigned int count)
+{
+  uint64_t * bits = cbits_of(tbl->table, tbl->buckets);
+  for (unsigned int i = 0; i < count; i++) {
+    if (data[i] == NULL)
+      return -1;
+
+    uint64_t hash = chash_hashof(tbl, data[i]);
+    unsigned int bucket = chash_indexof(tbl, hash, tbl->buckets);
+    if (find_chain(tbl, tbl->table[bucket], data[i], hash) != NULL)
+      continue;
+
+    CHashElmt * elmt = cmem_elmt_get(tbl, data[i]);
+    elmt->hash = hash;
+    elmt->next = tbl->table[bucket];
+    tbl->table[bucket] = elmt;
+    cbits_set(tbl, bits, bucket);
+    tbl->size++;
+  }
+
+  cstats_count(tbl, inserts, tbl->size);
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    find_chain
+ *
+ * DESCRIPTION:	    Searches one chain for an element matching data.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    elmt: (CHashElmt *) -- the head of the chain.
+ *		    data: (const void *) -- the data to search for.
+ *		    hash: (uint64_t) -- the hash of data.
+ *
+ * RETURN:	    CHashElmt * -- the matching element, or NULL.
+ *
+ * NOTES:	    none.
+ ***/
+static CHashElmt * find_chain(CHash * tbl, CHashElmt * elmt, const void * data,
+			      uint64_t hash)
+{
+  CHashKey key = {NULL, 0};
+  for (; elmt != NULL; elmt = elmt->next) {
+    if (chash_matches(tbl, &key, data, hash, elmt))
+      return elmt;
+  }
+  return NULL;
+}
+
+/*****************************************************************************/
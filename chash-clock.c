@@ -0,0 +1,71 @@
+/******************************************************************************
+ * NAME:	    chash-clock.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the CLOCK rings of cache tables.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-clock.h"
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    cclock_init
+ *
+ * DESCRIPTION:	    Allocates an empty ring for every stripe of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with its stripes set up.
+ *		    capacity: (unsigned int) -- the most elements the table
+ *			holds, split evenly between the rings.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    Every ring holds at least one element.
+ ***/
+int cclock_init(CHash * tbl, unsigned int capacity)
+{
+  tbl->clock = cmem_calloc(&(tbl->allocator), tbl->stripes,
+			   sizeof(CHashClock));
+  if (tbl->clock == NULL)
+    return -1;
+
+  unsigned int per = capacity / tbl->stripes
+    + (capacity % tbl->stripes != 0);
+  for (unsigned int i = 0; i < tbl->stripes; i++)
+    tbl->clock[i].capacity = per;
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cclock_destroy
+ *
+ * DESCRIPTION:	    Frees the rings of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The elements are freed with the chains they are on.
+ ***/
+void cclock_destroy(CHash * tbl)
+{
+  if (tbl->clock != NULL)
+    cmem_free(&(tbl->allocator), tbl->clock,
+	      tbl->stripes * sizeof(CHashClock));
+  tbl->clock = NULL;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,147 @@
+/******************************************************************************
+ * NAME:	    chash-clock.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the CLOCK rings of cache tables.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Capacity-bounded cache mode for the chained engine
+ *
+ * Every element of a cache table carries a CHashClockLink, which threads it
+ * on the circular list, or ring, of its lock stripe. New elements are linked
+ * just behind the hand, so they are the last the hand reaches. A lookup hit
+ * sets the reference bit of the element. To evict, the hand clears the bits
+ * of referenced elements as it passes them and stops at the first one whose
+ * bit was already clear, or after CHASH_CLOCK_SWEEP elements.
+ *
+ * A ring only holds elements of its own stripe, and only changes while the
+ * stripe is held for writing, so eviction needs no lock beyond the one its
+ * insert already holds. Lookups on read-locked stripes may set bits
+ * concurrently, so the bits are stored atomically.
+ */
+
+#ifndef __ET_CHASH_CLOCK_H__
+#define __ET_CHASH_CLOCK_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include "chain-hash.h"
+#include "chash-internal.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One ring, padded to a cache line so neighbouring stripes don't share. */
+union _CHashClock_ {
+
+  struct {
+    CHashElmt * hand;
+    unsigned int size;
+    unsigned int capacity;
+  };
+  char pad[64];
+
+};
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int cclock_init(CHash * table, unsigned int capacity);
+extern void cclock_destroy(CHash * table);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* Marks an element found by a lookup. Only writes if the bit is clear. */
+static inline void cclock_touch(const CHash * tbl, CHashElmt * elmt)
+{
+  if (tbl->clock == NULL)
+    return;
+
+  unsigned int * referenced = &(chash_clockof(tbl, elmt)->referenced);
+  if (!__atomic_load_n(referenced, __ATOMIC_RELAXED))
+    __atomic_store_n(referenced, 1, __ATOMIC_RELAXED);
+}
+
+/* Links a new element behind the hand of the ring of its stripe. */
+static inline void cclock_link(CHash * tbl, unsigned int stripe,
+			       CHashElmt * elmt)
+{
+  if (tbl->clock == NULL)
+    return;
+
+  CHashClock * clock = &(tbl->clock[stripe]);
+  CHashClockLink * link = chash_clockof(tbl, elmt);
+  link->referenced = 0;
+  if (clock->hand == NULL) {
+    link->prev = link->next = elmt;
+    clock->hand = elmt;
+  } else {
+    CHashClockLink * hand = chash_clockof(tbl, clock->hand);
+    link->next = clock->hand;
+    link->prev = hand->prev;
+    chash_clockof(tbl, hand->prev)->next = elmt;
+    hand->prev = elmt;
+  }
+  clock->size++;
+}
+
+/* Unlinks an element from its ring, moving the hand past it if need be. */
+static inline void cclock_unlink(CHash * tbl, CHashElmt * elmt)
+{
+  if (tbl->clock == NULL)
+    return;
+
+  CHashClock * clock = &(tbl->clock[cstripe_of_hash(tbl, elmt->hash)]);
+  CHashClockLink * link = chash_clockof(tbl, elmt);
+  if (link->next == elmt) {
+    clock->hand = NULL;
+  } else {
+    chash_clockof(tbl, link->prev)->next = link->next;
+    chash_clockof(tbl, link->next)->prev = link->prev;
+    if (clock->hand == elmt)
+      clock->hand = link->next;
+  }
+  clock->size--;
+}
+
+/*
+ * Picks the element to evict from the ring of a stripe held for writing, or
+ * returns NULL if the ring is not full. The victim is still linked.
+ */
+static inline CHashElmt * cclock_victim(CHash * tbl, unsigned int stripe)
+{
+  if (tbl->clock == NULL)
+    return NULL;
+
+  CHashClock * clock = &(tbl->clock[stripe]);
+  if (clock->size < clock->capacity)
+    return NULL;
+
+  CHashElmt * elmt = clock->hand;
+  for (unsigned int i = 1; i < CHASH_CLOCK_SWEEP; i++) {
+    CHashClockLink * link = chash_clockof(tbl, elmt);
+    if (!__atomic_load_n(&(link->referenced), __ATOMIC_RELAXED))
+      break;
+    __atomic_store_n(&(link->referenced), 0, __ATOMIC_RELAXED);
+    elmt = link->next;
+  }
+  clock->hand = elmt;
+  return elmt;
+}
+
+#endif /* __ET_CHASH_CLOCK_H__ */
+
+/*****************************************************************************/
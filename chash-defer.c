@@ -0,0 +1,332 @@
+/******************************************************************************
+ * NAME:	    chash-defer.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the deferred free queues of tables created
+ *		    with CHashOpts.defer, and for chash_collect.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-defer.h"
+#include "chash-internal.h"
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static CHashElmt * take(CHashDeferred *, unsigned int);
+static unsigned int release(CHash *, CHashElmt *);
+static void * collector(void *);
+static void free_queue(CHash *);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    cdefer_init
+ *
+ * DESCRIPTION:	    Gives the table an empty deferred free queue, and starts its
+ *		    collector thread if it has one.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, otherwise set up.
+ *		    mode: (CHashDefer) -- CHASH_DEFER_QUEUE or
+ *			CHASH_DEFER_THREAD.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    The thread waits on CLOCK_MONOTONIC, like the timer wheels.
+ ***/
+int cdefer_init(CHash * tbl, CHashDefer mode)
+{
+  CHashDeferred * queue = cmem_alloc(&(tbl->allocator),
+				     sizeof(CHashDeferred));
+  if (queue == NULL)
+    return -1;
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_mutex_init(&(queue->lock), NULL);
+  pthread_cond_init(&(queue->wake), &attr);
+  pthread_condattr_destroy(&attr);
+  queue->head = NULL;
+  queue->tail = &(queue->head);
+  queue->pending = 0;
+  queue->threaded = mode == CHASH_DEFER_THREAD;
+  queue->closing = 0;
+  tbl->deferred = queue;
+
+  if (queue->threaded
+      && pthread_create(&(queue->collector), NULL, collector, tbl)) {
+    free_queue(tbl);
+    return -1;
+  }
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cdefer_close
+ *
+ * DESCRIPTION:	    Empties the queue of a table being destroyed, or hands the
+ *		    table to its collector thread.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, which no thread is using.
+ *
+ * RETURN:	    int -- 1 if the collector thread now owns the table and will
+ *		    destroy it, 0 if the queue was emptied and freed, after
+ *		    which the caller destroys the table itself.
+ *
+ * NOTES:	    The thread is detached before it is told to close, since it
+ *		    frees the queue, and then the table, as soon as it is.
+ ***/
+int cdefer_close(CHash * tbl)
+{
+  CHashDeferred * queue = tbl->deferred;
+  if (queue->threaded) {
+    pthread_detach(queue->collector);
+    pthread_mutex_lock(&(queue->lock));
+    queue->closing = 1;
+    pthread_cond_signal(&(queue->wake));
+    pthread_mutex_unlock(&(queue->lock));
+    return 1;
+  }
+
+  chash_collect(tbl, 0);
+  free_queue(tbl);
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cdefer_push
+ *
+ * DESCRIPTION:	    Appends an element unlinked from the table to its queue.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with no stripe held.
+ *		    elmt: (CHashElmt *) -- the element, whose data and value
+ *			are destroyed with it.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Wakes the collector thread when the queue stops being
+ *		    empty, and again once a batch is waiting.
+ ***/
+void cdefer_push(CHash * tbl, CHashElmt * elmt)
+{
+  CHashDeferred * queue = tbl->deferred;
+  elmt->next = NULL;
+  pthread_mutex_lock(&(queue->lock));
+  *queue->tail = elmt;
+  queue->tail = &(elmt->next);
+  queue->pending++;
+  if (queue->threaded && (queue->pending == 1
+			  || queue->pending == CHASH_DEFER_BATCH))
+    pthread_cond_signal(&(queue->wake));
+  pthread_mutex_unlock(&(queue->lock));
+}
+
+/******************************************************************************
+ * FUNCTION:	    cdefer_data
+ *
+ * DESCRIPTION:	    Queues data, a value or both which the table no longer
+ *		    holds, but whose element stays linked.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with no stripe held.
+ *		    data: (void *) -- passed to tbl->destroy, or NULL.
+ *		    value: (void *) -- passed to tbl->destroy_value, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    They travel in a spare element. If none can be allocated,
+ *		    they are destroyed at once instead.
+ ***/
+void cdefer_data(CHash * tbl, void * data, void * value)
+{
+  CHashElmt * elmt = cmem_node_alloc(tbl);
+  if (elmt == NULL) {
+    chash_drop_data(tbl, data);
+    chash_drop_value(tbl, value);
+    return;
+  }
+
+  elmt->data = data;
+  if (tbl->map)
+    *chash_valueof(elmt) = value;
+  cdefer_push(tbl, elmt);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_collect
+ *
+ * DESCRIPTION:	    Destroys elements waiting on the queue of a deferred table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    max: (unsigned int) -- the most elements to destroy, or 0
+ *			for all of them.
+ *
+ * RETURN:	    unsigned int -- the number of elements destroyed, always 0
+ *		    if the table does not defer its destroy calls.
+ *
+ * NOTES:	    The oldest elements go first. Safe to call while other
+ *		    threads use the table, and alongside a collector thread.
+ ***/
+unsigned int chash_collect(CHash * tbl, unsigned int max)
+{
+  CHashDeferred * queue = tbl->deferred;
+  if (queue == NULL)
+    return 0;
+
+  pthread_mutex_lock(&(queue->lock));
+  CHashElmt * batch = take(queue, max);
+  pthread_mutex_unlock(&(queue->lock));
+  return release(tbl, batch);
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    take
+ *
+ * DESCRIPTION:	    Unlinks the oldest elements of a queue.
+ *
+ * ARGUMENTS:	    queue: (CHashDeferred *) -- held locked by the caller.
+ *		    max: (unsigned int) -- the most elements to take, or 0 for
+ *			all of them.
+ *
+ * RETURN:	    CHashElmt * -- the elements, still linked in order, or NULL.
+ *
+ * NOTES:	    Taking everything never walks the queue.
+ ***/
+static CHashElmt * take(CHashDeferred * queue, unsigned int max)
+{
+  CHashElmt * batch = queue->head;
+  if (max == 0 || max >= queue->pending) {
+    queue->head = NULL;
+    queue->tail = &(queue->head);
+    queue->pending = 0;
+    return batch;
+  }
+
+  CHashElmt ** link = &(queue->head);
+  for (unsigned int i = 0; i < max; i++)
+    link = &((*link)->next);
+  queue->head = *link;
+  *link = NULL;
+  queue->pending -= max;
+  return batch;
+}
+
+/******************************************************************************
+ * FUNCTION:	    release
+ *
+ * DESCRIPTION:	    Destroys a list of elements taken off a queue.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    elmt: (CHashElmt *) -- the first element of the list.
+ *
+ * RETURN:	    unsigned int -- the number of elements destroyed.
+ *
+ * NOTES:	    Called without the queue lock, since tbl->destroy may be
+ *		    slow.
+ ***/
+static unsigned int release(CHash * tbl, CHashElmt * elmt)
+{
+  unsigned int count = 0;
+  while (elmt != NULL) {
+    CHashElmt * next = elmt->next;
+    chash_drop_data(tbl, elmt->data);
+    if (tbl->map)
+      chash_drop_value(tbl, *chash_valueof(elmt));
+    cmem_node_free(tbl, elmt);
+    count++;
+    elmt = next;
+  }
+  return count;
+}
+
+/******************************************************************************
+ * FUNCTION:	    collector
+ *
+ * DESCRIPTION:	    The collector thread of a CHASH_DEFER_THREAD table.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the table.
+ *
+ * RETURN:	    void * -- NULL.
+ *
+ * NOTES:	    Sleeps while the queue is empty. Then takes the whole queue
+ *		    at once, when a batch is waiting or the interval has passed
+ *		    since the first element arrived. Once
+ *		    closing and empty, frees the queue and destroys the table,
+ *		    which then has no queue left to defer to.
+ ***/
+static void * collector(void * arg)
+{
+  CHash * tbl = arg;
+  CHashDeferred * queue = tbl->deferred;
+  pthread_mutex_lock(&(queue->lock));
+  for (;;) {
+    while (!queue->closing && queue->pending == 0)
+      pthread_cond_wait(&(queue->wake), &(queue->lock));
+
+    /* Give a batch the interval to fill up, from its first element. */
+    struct timespec until;
+    clock_gettime(CLOCK_MONOTONIC, &until);
+    until.tv_nsec += CHASH_DEFER_INTERVAL * 1000000L;
+    until.tv_sec += until.tv_nsec / 1000000000L;
+    until.tv_nsec %= 1000000000L;
+    while (!queue->closing && queue->pending < CHASH_DEFER_BATCH
+	   && pthread_cond_timedwait(&(queue->wake), &(queue->lock), &until)
+	   != ETIMEDOUT)
+      ;
+    if (queue->closing && queue->pending == 0)
+      break;
+
+    CHashElmt * batch = take(queue, 0);
+    pthread_mutex_unlock(&(queue->lock));
+    release(tbl, batch);
+    pthread_mutex_lock(&(queue->lock));
+  }
+  pthread_mutex_unlock(&(queue->lock));
+
+  free_queue(tbl);
+  chash_destroy(tbl);
+  return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    free_queue
+ *
+ * DESCRIPTION:	    Frees the empty queue of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Leaves tbl->deferred NULL.
+ ***/
+static void free_queue(CHash * tbl)
+{
+  CHashDeferred * queue = tbl->deferred;
+  pthread_cond_destroy(&(queue->wake));
+  pthread_mutex_destroy(&(queue->lock));
+  cmem_free(&(tbl->allocator), queue, sizeof(CHashDeferred));
+  tbl->deferred = NULL;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,80 @@
+/******************************************************************************
+ * NAME:	    chash-defer.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the deferred free queues of tables
+ *		    created with CHashOpts.defer.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Deferred destruction for the chained engine
+ *
+ * A deferred table never calls its destroy functions on the thread that
+ * removed an element. The element is appended, whole, to the first-in
+ * first-out queue of the table, linked through its own next pointer, so
+ * queueing allocates nothing. Data or values that a table replaces without
+ * unlinking their element travel in a spare element of their own instead.
+ *
+ * chash_collect, or the collector thread of a CHASH_DEFER_THREAD table, takes
+ * elements off the queue under its mutex and destroys them after releasing
+ * it. The thread is woken once CHASH_DEFER_BATCH elements are waiting, and
+ * otherwise collects whatever has accumulated every CHASH_DEFER_INTERVAL
+ * milliseconds. Destroying a table with a thread hands the whole table to
+ * it: the thread empties the queue, frees the chains and exits.
+ */
+
+#ifndef __ET_CHASH_DEFER_H__
+#define __ET_CHASH_DEFER_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <pthread.h>
+
+#include "chain-hash.h"
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+struct _CHashDeferred_ {
+
+  pthread_mutex_t lock; /* Guards everything below. */
+  pthread_cond_t wake;
+  CHashElmt * head;
+  CHashElmt ** tail;
+  unsigned int pending;
+  int threaded;
+  int closing; /* Set once chash_destroy has handed the table over. */
+  pthread_t collector;
+
+};
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int cdefer_init(CHash * table, CHashDefer mode);
+extern int cdefer_close(CHash * table);
+extern void cdefer_push(CHash * table, CHashElmt * elmt);
+extern void cdefer_data(CHash * table, void * data, void * value);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* Whether the table's elements are destroyed by a thread of its own. */
+static inline int cdefer_threaded(const CHash * tbl)
+{
+  return tbl->deferred != NULL && tbl->deferred->threaded;
+}
+
+#endif /* __ET_CHASH_DEFER_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,332 @@
+/******************************************************************************
+ * NAME:	    chash-epoch.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the epoch-based reclamation of elements
+ *		    and bucket arrays unlinked from a CHASH_CONCURRENCY_EPOCH
+ *		    table.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Epoch-based reclamation for the CHash API
+ *
+ * Lookups on an epoch table take no lock. A reader instead counts itself in
+ * the counter of the current epoch for its slot, and uncounts itself when it
+ * is done. An object unlinked by a writer is stamped with the epoch current
+ * at the time. The epoch only advances from e to e + 1 once no reader is
+ * left in e - 1, so when the epoch reaches stamp + 2, no reader can still
+ * hold a reference and the object is freed.
+ *
+ * Writers still serialize against each other with the stripe mutexes. They
+ * publish new chain links with release stores, and never change the next
+ * pointer of an element that a reader may be standing on.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-epoch.h"
+#include "chash-internal.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static CHashRetired * advance(CHashEpoch *);
+static void reclaim(CHash *, CHashRetired *);
+static void release(CHash *, CHashRetireKind, void *, size_t);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    cepoch_init
+ *
+ * DESCRIPTION:	    Allocates the epoch state of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with tbl->allocator set.
+ *
+ * RETURN:	    CHashEpoch * -- the epoch state, or NULL on error.
+ *
+ * NOTES:	    none.
+ ***/
+CHashEpoch * cepoch_init(CHash * tbl)
+{
+  CHashEpoch * epoch = cmem_alloc(&(tbl->allocator), sizeof(CHashEpoch));
+  if (epoch == NULL)
+    return NULL;
+
+  epoch->epoch = 0;
+  epoch->seq = 0;
+  pthread_mutex_init(&(epoch->lock), NULL);
+  epoch->retired = NULL;
+  epoch->pending = 0;
+  for (int i = 0; i < CHASH_EPOCH_SLOTS; i++)
+    epoch->readers[i].count[0] = epoch->readers[i].count[1] = 0;
+  return epoch;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cepoch_destroy
+ *
+ * DESCRIPTION:	    Frees everything still waiting for a grace period, then
+ *		    the epoch state itself.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    epoch: (CHashEpoch *) -- its epoch state.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    No thread may be inside a lookup on the table.
+ ***/
+void cepoch_destroy(CHash * tbl, CHashEpoch * epoch)
+{
+  if (epoch == NULL)
+    return;
+
+  cepoch_flush(tbl, epoch);
+  pthread_mutex_destroy(&(epoch->lock));
+  cmem_free(&(tbl->allocator), epoch, sizeof(CHashEpoch));
+}
+
+/******************************************************************************
+ * FUNCTION:	    cepoch_flush
+ *
+ * DESCRIPTION:	    Frees everything still waiting for a grace period.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    epoch: (CHashEpoch *) -- its epoch state, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    No thread may be using the table.
+ ***/
+void cepoch_flush(CHash * tbl, CHashEpoch * epoch)
+{
+  if (epoch == NULL)
+    return;
+
+  reclaim(tbl, epoch->retired);
+  epoch->retired = NULL;
+  epoch->pending = 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cepoch_enter
+ *
+ * DESCRIPTION:	    Marks the calling thread as reading the table, so nothing
+ *		    it can reach is freed until cepoch_exit.
+ *
+ * ARGUMENTS:	    epoch: (CHashEpoch *) -- the epoch state of the table.
+ *
+ * RETURN:	    unsigned int -- a ticket to pass to cepoch_exit.
+ *
+ * NOTES:	    Only retries if the epoch advances between reading it and
+ *		    counting the reader, which a writer does at most once per
+ *		    CHASH_EPOCH_BATCH removals.
+ ***/
+unsigned int cepoch_enter(CHashEpoch * epoch)
+{
+  unsigned int slot = cstripe_thread_slot() % CHASH_EPOCH_SLOTS;
+  for (;;) {
+    unsigned long e = __atomic_load_n(&(epoch->epoch), __ATOMIC_SEQ_CST);
+    unsigned long * count = &(epoch->readers[slot].count[e & 1]);
+    __atomic_add_fetch(count, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&(epoch->epoch), __ATOMIC_SEQ_CST) == e)
+      return slot * 2 + (e & 1);
+    __atomic_sub_fetch(count, 1, __ATOMIC_RELEASE);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    cepoch_exit
+ *
+ * DESCRIPTION:	    Ends a read section started by cepoch_enter.
+ *
+ * ARGUMENTS:	    epoch: (CHashEpoch *) -- the epoch state of the table.
+ *		    ticket: (unsigned int) -- the value cepoch_enter returned.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void cepoch_exit(CHashEpoch * epoch, unsigned int ticket)
+{
+  __atomic_sub_fetch(&(epoch->readers[ticket / 2].count[ticket & 1]), 1,
+		     __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cepoch_retire
+ *
+ * DESCRIPTION:	    Defers freeing an object unlinked from the table until no
+ *		    reader can still reach it.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    epoch: (CHashEpoch *) -- its epoch state.
+ *		    kind: (CHashRetireKind) -- what ptr points to.
+ *		    ptr: (void *) -- the object, already unlinked.
+ *		    size: (size_t) -- the size of a CEPOCH_ARRAY, in bytes.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    If no record can be allocated, waits for a grace period and
+ *		    frees the object directly. Must not be called from inside a
+ *		    read section.
+ ***/
+void cepoch_retire(CHash * tbl, CHashEpoch * epoch, CHashRetireKind kind,
+		   void * ptr, size_t size)
+{
+  CHashRetired * retired = cmem_alloc(&(tbl->allocator),
+				      sizeof(CHashRetired));
+  pthread_mutex_lock(&(epoch->lock));
+  unsigned long stamp = __atomic_load_n(&(epoch->epoch), __ATOMIC_SEQ_CST);
+
+  if (retired == NULL) {
+    while (__atomic_load_n(&(epoch->epoch), __ATOMIC_RELAXED) < stamp + 2) {
+      CHashRetired * ready = advance(epoch);
+      pthread_mutex_unlock(&(epoch->lock));
+      reclaim(tbl, ready);
+      sched_yield();
+      pthread_mutex_lock(&(epoch->lock));
+    }
+    pthread_mutex_unlock(&(epoch->lock));
+    release(tbl, kind, ptr, size);
+    return;
+  }
+
+  *retired = (CHashRetired){.next = epoch->retired, .epoch = stamp,
+			    .kind = kind, .ptr = ptr, .size = size};
+  epoch->retired = retired;
+
+  CHashRetired * ready = NULL;
+  if (++epoch->pending >= CHASH_EPOCH_BATCH)
+    ready = advance(epoch);
+  pthread_mutex_unlock(&(epoch->lock));
+  reclaim(tbl, ready);
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    advance
+ *
+ * DESCRIPTION:	    Advances the epoch if no reader is left in the previous
+ *		    one, and unlinks every record whose grace period is over.
+ *
+ * ARGUMENTS:	    epoch: (CHashEpoch *) -- held locked by the caller.
+ *
+ * RETURN:	    CHashRetired * -- the records that may now be freed.
+ *
+ * NOTES:	    The previous epoch shares its counters with the next one,
+ *		    so once they are zero they can be reused.
+ ***/
+static CHashRetired * advance(CHashEpoch * epoch)
+{
+  unsigned long e = epoch->epoch;
+  for (int i = 0; i < CHASH_EPOCH_SLOTS; i++) {
+    if (__atomic_load_n(&(epoch->readers[i].count[(e + 1) & 1]),
+			__ATOMIC_ACQUIRE) != 0)
+      return NULL;
+  }
+  __atomic_store_n(&(epoch->epoch), ++e, __ATOMIC_SEQ_CST);
+
+  CHashRetired * ready = NULL, ** link = &(epoch->retired);
+  while (*link != NULL) {
+    CHashRetired * retired = *link;
+    if (retired->epoch + 2 <= e) {
+      *link = retired->next;
+      retired->next = ready;
+      ready = retired;
+      epoch->pending--;
+    } else {
+      link = &(retired->next);
+    }
+  }
+  return ready;
+}
+
+/******************************************************************************
+ * FUNCTION:	    reclaim
+ *
+ * DESCRIPTION:	    Frees a list of retired records and what they point to.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    retired: (CHashRetired *) -- the list.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Called without the epoch lock, since tbl->destroy may be
+ *		    slow.
+ ***/
+static void reclaim(CHash * tbl, CHashRetired * retired)
+{
+  while (retired != NULL) {
+    CHashRetired * next = retired->next;
+    release(tbl, retired->kind, retired->ptr, retired->size);
+    cmem_free(&(tbl->allocator), retired, sizeof(CHashRetired));
+    retired = next;
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    release
+ *
+ * DESCRIPTION:	    Frees one object whose grace period is over.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    kind: (CHashRetireKind) -- what ptr points to.
+ *		    ptr: (void *) -- the object.
+ *		    size: (size_t) -- the size of a CEPOCH_ARRAY, in bytes.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The value of a single element of a map table goes with it,
+ *		    while the copies retired as a chain never own theirs.
+ ***/
+static void release(CHash * tbl, CHashRetireKind kind, void * ptr,
+		    size_t size)
+{
+  CHashElmt * elmt = ptr;
+  switch (kind) {
+  case CEPOCH_ELEMENT:
+    chash_drop_data(tbl, elmt->data);
+    /* fallthrough */
+  case CEPOCH_NODE:
+    if (tbl->map)
+      chash_drop_value(tbl, *chash_valueof(elmt));
+    cmem_node_free(tbl, elmt);
+    break;
+  case CEPOCH_CHAIN:
+    while (elmt != NULL) {
+      CHashElmt * next = elmt->next;
+      cmem_node_free(tbl, elmt);
+      elmt = next;
+    }
+    break;
+  case CEPOCH_ARRAY:
+    cmem_free(&(tbl->allocator), ptr, size);
+    break;
+  case CEPOCH_VALUE:
+    chash_drop_value(tbl, ptr);
+    break;
+  }
+}
+
+/*****************************************************************************/
@@ -0,0 +1,113 @@
+/******************************************************************************
+ * NAME:	    chash-epoch.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the epoch-based reclamation used by
+ *		    tables created with CHASH_CONCURRENCY_EPOCH.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_CHASH_EPOCH_H__
+#define __ET_CHASH_EPOCH_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "chain-hash.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Reader counters per table. Threads beyond this share counters. */
+#define CHASH_EPOCH_SLOTS 64
+
+/* Retired objects accumulated before trying to advance the epoch. */
+#define CHASH_EPOCH_BATCH 64
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef enum _CHashRetireKind_ {
+
+  CEPOCH_NODE,	  /* A single element, whose data belongs to the caller. */
+  CEPOCH_ELEMENT, /* A single element, whose data is passed to tbl->destroy. */
+  CEPOCH_CHAIN,	  /* A whole chain of elements, linked through next. */
+  CEPOCH_ARRAY,	  /* A bucket array of the given size in bytes. */
+  CEPOCH_VALUE	  /* A value of a map table, passed to tbl->destroy_value. */
+
+} CHashRetireKind;
+
+typedef struct _CHashRetired_ {
+
+  struct _CHashRetired_ * next;
+  unsigned long epoch;
+  CHashRetireKind kind;
+  void * ptr;
+  size_t size;
+
+} CHashRetired;
+
+/* Readers active in each of the two most recent epochs, per cache line. */
+typedef union _CHashReaders_ {
+
+  unsigned long count[2];
+  char pad[64];
+
+} CHashReaders;
+
+typedef struct _CHashEpoch_ {
+
+  unsigned long epoch;
+  unsigned int seq; /* Odd while the bucket arrays are being replaced. */
+  pthread_mutex_t lock; /* Guards retired, pending, and advancing epoch. */
+  CHashRetired * retired;
+  unsigned int pending;
+  CHashReaders readers[CHASH_EPOCH_SLOTS];
+
+} CHashEpoch;
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern CHashEpoch * cepoch_init(CHash * table);
+extern void cepoch_destroy(CHash * table, CHashEpoch * epoch);
+extern void cepoch_flush(CHash * table, CHashEpoch * epoch);
+extern unsigned int cepoch_enter(CHashEpoch * epoch);
+extern void cepoch_exit(CHashEpoch * epoch, unsigned int ticket);
+extern void cepoch_retire(CHash * table, CHashEpoch * epoch,
+			  CHashRetireKind kind, void * ptr, size_t size);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* Brackets a change of the bucket arrays, for readers holding no lock. */
+static inline void cepoch_swap_begin(CHashEpoch * epoch)
+{
+  if (epoch == NULL)
+    return;
+
+  __atomic_store_n(&(epoch->seq), epoch->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void cepoch_swap_end(CHashEpoch * epoch)
+{
+  if (epoch != NULL)
+    __atomic_store_n(&(epoch->seq), epoch->seq + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* __ET_CHASH_EPOCH_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,200 @@
+/******************************************************************************
+ * NAME:	    chash-filter.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the membership filter of chained tables.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-bitmap.h"
+#include "chash-epoch.h"
+#include "chash-filter.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The most counters an element sets: seven bits each of a 64-bit hash. */
+#define CFILTER_MAX_HASHES 8
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void fill(CHash *, CHashFilter *, CHashElmt **, unsigned int);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    cfilter_create
+ *
+ * DESCRIPTION:	    Allocates an empty filter for capacity elements.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, for its allocator and
+ *			tbl->filterbits.
+ *		    capacity: (unsigned int) -- the number of elements.
+ *
+ * RETURN:	    CHashFilter * -- the filter, or NULL.
+ *
+ * NOTES:	    The number of blocks is rounded up to a power of two, and
+ *		    capacity up with it. Each element sets filterbits * ln 2
+ *		    counters, which minimizes false positives for filterbits
+ *		    counters per element.
+ ***/
+CHashFilter * cfilter_create(CHash * tbl, unsigned int capacity)
+{
+  unsigned int bits = 0;
+  while (bits < 32 && ((uint64_t)CFILTER_COUNTERS << bits)
+	 < (uint64_t)capacity * tbl->filterbits)
+    bits++;
+
+  size_t blockbytes = (size_t)CFILTER_BLOCK << bits;
+  size_t bytes = sizeof(CHashFilter) + CFILTER_BLOCK - 1 + blockbytes;
+  CHashFilter * filter = cmem_calloc(&(tbl->allocator), 1, bytes);
+  if (filter == NULL)
+    return NULL;
+
+  unsigned int hashes = (tbl->filterbits * 69 + 50) / 100;
+  uint64_t fits = ((uint64_t)CFILTER_COUNTERS << bits) / tbl->filterbits;
+  uintptr_t blocks = (uintptr_t)(filter + 1);
+  *filter = (CHashFilter){
+    .bits = bits,
+    .hashes = hashes < 1 ? 1
+      : hashes > CFILTER_MAX_HASHES ? CFILTER_MAX_HASHES : hashes,
+    .capacity = fits < UINT32_MAX ? fits : UINT32_MAX,
+    .bytes = bytes,
+    .counters = (unsigned char *)((blocks + CFILTER_BLOCK - 1)
+				  / CFILTER_BLOCK * CFILTER_BLOCK)
+  };
+  return filter;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cfilter_free
+ *
+ * DESCRIPTION:	    Frees a filter.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table the filter was allocated for.
+ *		    filter: (CHashFilter *) -- the filter, may be NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void cfilter_free(CHash * tbl, CHashFilter * filter)
+{
+  if (filter != NULL)
+    cmem_free(&(tbl->allocator), filter, filter->bytes);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cfilter_rebuild
+ *
+ * DESCRIPTION:	    Replaces the filter of the table by one for capacity
+ *		    elements, counting every element of both bucket arrays.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with every stripe held.
+ *		    capacity: (unsigned int) -- the number of elements.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the new filter could not be
+ *		    allocated, in which case the old one is kept.
+ *
+ * NOTES:	    Counts the stored hashes, so tbl->hash is not called. An
+ *		    epoch table may have lookups testing the old filter, which
+ *		    is retired rather than freed.
+ ***/
+int cfilter_rebuild(CHash * tbl, unsigned int capacity)
+{
+  CHashFilter * filter = cfilter_create(tbl, capacity);
+  if (filter == NULL)
+    return -1;
+
+  fill(tbl, filter, tbl->oldtable, tbl->oldbuckets);
+  fill(tbl, filter, tbl->table, tbl->buckets);
+
+  CHashFilter * old = tbl->filter;
+  __atomic_store_n(&(tbl->filter), filter, __ATOMIC_RELEASE);
+  CHashEpoch * epoch = cstripe_epoch(tbl);
+  if (epoch != NULL && old != NULL)
+    cepoch_retire(tbl, epoch, CEPOCH_ARRAY, old, old->bytes);
+  else
+    cfilter_free(tbl, old);
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cfilter_grow
+ *
+ * DESCRIPTION:	    Rebuilds the filter of the table twice as large as its
+ *		    size, if the table has outgrown it.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with no stripe held.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Takes the rehash lock, so only one thread rebuilds, and then
+ *		    every stripe. Unlike the bucket arrays, the filter is
+ *		    rebuilt in one pass. If that fails, the old filter stays,
+ *		    and only answers "maybe" more often.
+ ***/
+void cfilter_grow(CHash * tbl)
+{
+  if (!cstripe_rehash_trylock(tbl))
+    return;
+
+  cstripe_write_all(tbl);
+  unsigned int size = chash_size(tbl);
+  if (tbl->filter != NULL && size >= tbl->filter->capacity)
+    cfilter_rebuild(tbl, size < UINT32_MAX / 2 ? size * 2 : UINT32_MAX);
+  cstripe_unlock_all(tbl);
+  cstripe_rehash_unlock(tbl);
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    fill
+ *
+ * DESCRIPTION:	    Counts every element of a bucket array into a filter.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    filter: (CHashFilter *) -- the filter, not yet published.
+ *		    table: (CHashElmt **) -- the bucket array, may be NULL.
+ *		    buckets: (unsigned int) -- the size of the bucket array.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void fill(CHash * tbl, CHashFilter * filter, CHashElmt ** table,
+		 unsigned int buckets)
+{
+  if (table == NULL)
+    return;
+
+  const uint64_t * bits = cbits_of(table, buckets);
+  for (unsigned int i = cbits_scan(bits, 0, buckets); i < buckets;
+       i = cbits_scan(bits, i + 1, buckets)) {
+    for (CHashElmt * elmt = table[i]; elmt != NULL; elmt = elmt->next)
+      cfilter_count(tbl, filter, elmt->hash, 1);
+  }
+}
+
+/*****************************************************************************/
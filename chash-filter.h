@@ -0,0 +1,166 @@
+/******************************************************************************
+ * NAME:	    chash-filter.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the membership filter of chained
+ *		    tables: a counting, blocked Bloom filter.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Membership filter for the chained engine
+ *
+ * The filter is an array of 64-byte blocks, each holding 128 four-bit
+ * counters. An element selects one block with the high bits of its hash, and
+ * tbl->filter->hashes counters within it with seven bits each from the low
+ * bits, so a test reads a single cache line. Inserting an element increments
+ * its counters and removing it decrements them, and a lookup whose counters
+ * are not all nonzero is a miss without ever reading the bucket. A counter
+ * that reaches CFILTER_MAX stays there, since it can no longer tell how many
+ * elements share it.
+ *
+ * Counters only change while the stripe of the element is held for writing.
+ * One byte holds two counters, possibly of different stripes, so concurrent
+ * tables change them with compare-and-swap. The filter is sized for a number
+ * of elements, and is rebuilt twice as large, from the stored hashes, with
+ * every stripe held, when the table outgrows it.
+ */
+
+#ifndef __ET_CHASH_FILTER_H__
+#define __ET_CHASH_FILTER_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chain-hash.h"
+#include "chash-internal.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Bytes per block: one cache line. */
+#define CFILTER_BLOCK 64
+
+/* Four-bit counters per block, each selected by seven bits of the hash. */
+#define CFILTER_COUNTERS (2 * CFILTER_BLOCK)
+
+/* The value at which a counter sticks. */
+#define CFILTER_MAX 15
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+struct _CHashFilter_ {
+
+  unsigned int bits; /* log2 of the number of blocks. */
+  unsigned int hashes;
+  unsigned int capacity;
+  size_t bytes;
+  unsigned char * counters; /* The blocks, aligned to CFILTER_BLOCK. */
+
+};
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern CHashFilter * cfilter_create(CHash * table, unsigned int capacity);
+extern void cfilter_free(CHash * table, CHashFilter * filter);
+extern int cfilter_rebuild(CHash * table, unsigned int capacity);
+extern void cfilter_grow(CHash * table);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* Finalizes a stored hash, so that an identity hash fills the whole filter. */
+static inline uint64_t cfilter_mix(uint64_t hash)
+{
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/* The block of a finalized hash. The counters are taken from the low bits. */
+static inline unsigned char * cfilter_block(const CHashFilter * filter,
+					    uint64_t mixed)
+{
+  /* Shifting in two steps keeps a single block from shifting by 64. */
+  uint64_t block = ((mixed * CHASH_FIBONACCI) >> (63 - filter->bits)) >> 1;
+  return filter->counters + block * CFILTER_BLOCK;
+}
+
+/* Whether an element of this hash may be in the table. */
+static inline int cfilter_test(const CHashFilter * filter, uint64_t hash)
+{
+  uint64_t mixed = cfilter_mix(hash);
+  const unsigned char * block = cfilter_block(filter, mixed);
+  for (unsigned int i = 0; i < filter->hashes; i++, mixed >>= 7) {
+    unsigned int counter = mixed % CFILTER_COUNTERS;
+    unsigned char byte = __atomic_load_n(&(block[counter / 2]),
+					 __ATOMIC_RELAXED);
+    if (((byte >> (counter % 2 * 4)) & 0xf) == 0)
+      return 0;
+  }
+  return 1;
+}
+
+/* Adds delta, 1 or -1, to the counters of a hash, unless they are stuck. */
+static inline void cfilter_count(const CHash * tbl, CHashFilter * filter,
+				 uint64_t hash, int delta)
+{
+  uint64_t mixed = cfilter_mix(hash);
+  unsigned char * block = cfilter_block(filter, mixed);
+  for (unsigned int i = 0; i < filter->hashes; i++, mixed >>= 7) {
+    unsigned int counter = mixed % CFILTER_COUNTERS, shift = counter % 2 * 4;
+    unsigned char * cell = &(block[counter / 2]);
+    unsigned char byte = __atomic_load_n(cell, __ATOMIC_RELAXED), next;
+    do {
+      unsigned int value = (byte >> shift) & 0xf;
+      if (value == CFILTER_MAX || (delta < 0 && value == 0))
+	break;
+      next = (byte & ~(0xf << shift)) | ((value + delta) << shift);
+      if (tbl->locks == NULL) {
+	*cell = next;
+	break;
+      }
+    } while (!__atomic_compare_exchange_n(cell, &byte, next, 1,
+					  __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+}
+
+/*
+ * Records an element about to be linked in, with its stripe held. Returns
+ * whether the filter should grow, once the stripe has been released.
+ */
+static inline int cfilter_add(CHash * tbl, uint64_t hash)
+{
+  if (tbl->filter == NULL)
+    return 0;
+  cfilter_count(tbl, tbl->filter, hash, 1);
+  return chash_size(tbl) >= tbl->filter->capacity;
+}
+
+/* Forgets an element being unlinked, with its stripe held. */
+static inline void cfilter_remove(CHash * tbl, uint64_t hash)
+{
+  if (tbl->filter != NULL)
+    cfilter_count(tbl, tbl->filter, hash, -1);
+}
+
+#endif /* __ET_CHASH_FILTER_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,539 @@
+/******************************************************************************
+ * NAME:	    chash-image.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for table images: chash_save writes a table to
+ *		    a file, and chash_load maps the file back as a read-only
+ *		    table.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Persistent, memory-mapped images for the CHash API
+ *
+ * An image stores the table the way chash_build lays it out: the entries are
+ * sorted by bucket, and each bucket is a run of them, so no pointer is ever
+ * written to the file. A loaded table serves lookups straight from the
+ * mapping, which costs nothing to set up and shares its pages with every
+ * other process mapping the same file.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-image.h"
+#include "chash-internal.h"
+#include "chash-stats.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define ALIGN_UP(N) (((N) + CIMAGE_ALIGN - 1) & ~(uint64_t)(CIMAGE_ALIGN - 1))
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct _SaveList_ {
+
+  void ** data;
+  unsigned int count;
+  unsigned int capacity;
+
+} SaveList;
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void collect(void *, void *);
+static int write_image(FILE *, CHashImageHeader *, const uint64_t *,
+		       CHashImageEntry *, void **,
+		       size_t (*)(const void *, const void **));
+static int valid_image(const unsigned char *, size_t);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    chash_save
+ *
+ * DESCRIPTION:	    Writes an image of the table to a file.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table to save.
+ *		    path: (const char *) -- the file to write.
+ *		    encode: (size_t (*)(const void *, const void **)) --
+ *			user-defined function which points its second argument
+ *			at the bytes to store for an element, and returns how
+ *			many there are.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    The image is written to path.tmp and renamed over path, so
+ *		    a process mapping the old file keeps its view of it. The
+ *		    bytes returned by encode only need to stay valid until the
+ *		    next call. The table must not be modified while it is being
+ *		    saved. An image holds no values, so map tables cannot be
+ *		    saved.
+ ***/
+int chash_save(CHash * tbl, const char * path,
+	       size_t (*encode)(const void *, const void **))
+{
+  if (path == NULL || encode == NULL || tbl->map)
+    return -1;
+
+  const CHashAllocator * allocator = &(tbl->allocator);
+  unsigned int capacity = chash_size(tbl);
+  SaveList list = {.data = cmem_calloc(allocator, capacity + 1,
+				       sizeof(void *)),
+		   .count = 0,
+		   .capacity = capacity};
+  if (list.data == NULL)
+    return -1;
+
+  uint64_t cursor = 0;
+  do {
+    cursor = chash_scan(tbl, cursor, collect, &list);
+  } while (cursor != 0);
+
+  unsigned int count = list.count;
+  uint64_t buckets = 1;
+  while (buckets < count)
+    buckets *= 2;
+
+  const CHash shape = {.index = CHASH_INDEX_FIBONACCI};
+  uint64_t * starts = cmem_calloc(allocator, buckets + 1, sizeof(uint64_t));
+  uint64_t * hashes = cmem_calloc(allocator, capacity + 1, sizeof(uint64_t));
+  void ** sorted = cmem_calloc(allocator, capacity + 1, sizeof(void *));
+  CHashImageEntry * entries = cmem_calloc(allocator, capacity + 1,
+					  sizeof(CHashImageEntry));
+  size_t length = strlen(path) + sizeof(".tmp");
+  char * temp = cmem_alloc(allocator, length);
+  int result = -1;
+  if (starts == NULL || hashes == NULL || sorted == NULL || entries == NULL
+      || temp == NULL)
+    goto out;
+
+  /* Sort the elements by bucket, as chash_build does. */
+  for (unsigned int i = 0; i < count; i++) {
+    hashes[i] = chash_hashof(tbl, list.data[i]);
+    starts[chash_indexof(&shape, hashes[i], buckets) + 1]++;
+  }
+  for (uint64_t b = 0; b < buckets; b++)
+    starts[b + 1] += starts[b];
+  for (unsigned int i = 0; i < count; i++) {
+    uint64_t position = starts[chash_indexof(&shape, hashes[i], buckets)]++;
+    entries[position].hash = hashes[i];
+    sorted[position] = list.data[i];
+  }
+  for (uint64_t b = buckets; b > 0; b--)
+    starts[b] = starts[b - 1];
+  starts[0] = 0;
+
+  CHashImageHeader header = {.version = CIMAGE_VERSION,
+			     .byteorder = CIMAGE_BYTEORDER,
+			     .flags = tbl->hash64 != NULL ? CIMAGE_HASH64 : 0,
+			     .index = CHASH_INDEX_FIBONACCI,
+			     .buckets = buckets,
+			     .count = count,
+			     .starts = sizeof(CHashImageHeader)
+  };
+  memcpy(header.magic, CIMAGE_MAGIC, sizeof(header.magic));
+  header.entries = header.starts + (buckets + 1) * sizeof(uint64_t);
+
+  snprintf(temp, length, "%s.tmp", path);
+  FILE * file = fopen(temp, "wb");
+  if (file == NULL)
+    goto out;
+  result = write_image(file, &header, starts, entries, sorted, encode);
+  if (fclose(file) != 0)
+    result = -1;
+  if (result == 0 && rename(temp, path) != 0)
+    result = -1;
+  if (result != 0)
+    remove(temp);
+
+ out:
+  cmem_free(allocator, list.data, (capacity + 1) * sizeof(void *));
+  cmem_free(allocator, starts, (buckets + 1) * sizeof(uint64_t));
+  cmem_free(allocator, hashes, (capacity + 1) * sizeof(uint64_t));
+  cmem_free(allocator, sorted, (capacity + 1) * sizeof(void *));
+  cmem_free(allocator, entries, (capacity + 1) * sizeof(CHashImageEntry));
+  cmem_free(allocator, temp, length);
+  return result;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_load
+ *
+ * DESCRIPTION:	    Maps an image written by chash_save as a read-only table.
+ *
+ * ARGUMENTS:	    path: (const char *) -- the file to map.
+ *		    hash: (int (*)(const void *)) -- user-defined hash function,
+ *			the one the saved table used.
+ *		    match: (int (*)(const void *, const void *) -- user defined
+ *			function comparing a key to a stored record.
+ *		    opts: (const CHashOpts *) -- the options, or NULL. Only
+ *			hash64 and allocator are used.
+ *
+ * RETURN:	    CHash * -- the table, or NULL on error.
+ *
+ * NOTES:	    Only the header is read, so this takes the same time for an
+ *		    image of any size. An image saved with a 64-bit hash must be
+ *		    loaded with one, and the other way around.
+ ***/
+CHash * chash_load(const char * path, int (*hash)(const void *),
+		   int (*match)(const void *, const void *),
+		   const CHashOpts * opts)
+{
+  static const CHashOpts defaults = {0};
+  if (opts == NULL)
+    opts = &defaults;
+  if (path == NULL || (hash == NULL && opts->hash64 == NULL) || match == NULL)
+    return NULL;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  void * image = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(CHashImageHeader))
+    image = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED)
+    return NULL;
+
+  const CHashImageHeader * header = image;
+  const CHashAllocator libc = {0};
+  const CHashAllocator * allocator = opts->allocator != NULL
+    ? opts->allocator : &libc;
+  CHash * tbl = NULL;
+  if (valid_image(image, st.st_size)
+      && (header->flags & CIMAGE_HASH64) == (opts->hash64 != NULL
+					     ? CIMAGE_HASH64 : 0))
+    tbl = cmem_alloc(allocator, sizeof(CHash));
+  if (tbl == NULL) {
+    munmap(image, st.st_size);
+    return NULL;
+  }
+
+  *tbl = (CHash){.buckets = header->buckets,
+		 .hash = hash,
+		 .hash64 = opts->hash64,
+		 .index = header->index,
+		 .match = match,
+		 .size = header->count,
+		 .minbuckets = header->buckets,
+		 .engine = CHASH_ENGINE_IMAGE,
+		 .image = image,
+		 .imagebytes = st.st_size,
+		 .allocator = *allocator,
+		 .stripes = 1
+  };
+
+  if (cstats_init(tbl, 1)) {
+    cmem_free(allocator, tbl, sizeof(CHash));
+    munmap(image, st.st_size);
+    return NULL;
+  }
+  return tbl;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cimage_lookup
+ *
+ * DESCRIPTION:	    Searches a mapped image for *data.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (void **) -- the key. Receives the record found.
+ *
+ * RETURN:	    int -- 1 if the record is found, 0 otherwise.
+ *
+ * NOTES:	    The entries of a bucket are contiguous, so the hashes are
+ *		    compared in one sequential sweep, and only the records whose
+ *		    hash agrees are touched. When *data is NULL, returns the
+ *		    first record.
+ ***/
+int cimage_lookup(CHash * tbl, void ** data)
+{
+  const unsigned char * image = tbl->image;
+  const CHashImageHeader * header = tbl->image;
+  const CHashImageEntry * entries
+    = (const CHashImageEntry *)(image + header->entries);
+
+  if (*data == NULL) {
+    if (tbl->size == 0)
+      return 0;
+    *data = (void *)(image + entries[0].offset);
+    return 1;
+  }
+
+  const uint64_t * starts = (const uint64_t *)(image + header->starts);
+  uint64_t hash = chash_hashof(tbl, *data);
+  unsigned int bucket = chash_indexof(tbl, hash, tbl->buckets);
+  int found = 0;
+  for (uint64_t i = starts[bucket]; i < starts[bucket + 1]; i++) {
+    if (entries[i].hash == hash
+	&& tbl->match(*data, image + entries[i].offset)) {
+      *data = (void *)(image + entries[i].offset);
+      cstats_count(tbl, probes, i - starts[bucket] + 1);
+      found = 1;
+      break;
+    }
+  }
+
+  cstats_lookup(tbl, found);
+  return found;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cimage_traverse
+ *
+ * DESCRIPTION:	    Calls callback() on every record of the image.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    callback: (void (*)(void *)) -- the callback.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The records are visited in the order they are stored.
+ ***/
+void cimage_traverse(CHash * tbl, void (*callback)(void *))
+{
+  const unsigned char * image = tbl->image;
+  const CHashImageHeader * header = tbl->image;
+  const CHashImageEntry * entries
+    = (const CHashImageEntry *)(image + header->entries);
+  for (unsigned int i = 0; i < tbl->size; i++)
+    callback((void *)(image + entries[i].offset));
+}
+
+/******************************************************************************
+ * FUNCTION:	    cimage_scan
+ *
+ * DESCRIPTION:	    Calls callback() on every record of one bucket.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    cursor: (uint64_t) -- the bucket to visit.
+ *		    callback: (void (*)(void *, void *)) -- the callback.
+ *		    arg: (void *) -- passed through to callback.
+ *
+ * RETURN:	    uint64_t -- the next bucket, or 0 after the last one.
+ *
+ * NOTES:	    An image never changes, so the cursor is the bucket index.
+ ***/
+uint64_t cimage_scan(CHash * tbl, uint64_t cursor,
+		     void (*callback)(void *, void *), void * arg)
+{
+  if (cursor >= tbl->buckets)
+    return 0;
+
+  const unsigned char * image = tbl->image;
+  const CHashImageHeader * header = tbl->image;
+  const uint64_t * starts = (const uint64_t *)(image + header->starts);
+  const CHashImageEntry * entries
+    = (const CHashImageEntry *)(image + header->entries);
+  for (uint64_t i = starts[cursor]; i < starts[cursor + 1]; i++)
+    callback((void *)(image + entries[i].offset), arg);
+  return cursor + 1 < tbl->buckets ? cursor + 1 : 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cimage_destroy
+ *
+ * DESCRIPTION:	    Unmaps the image of a table. Does not free tbl itself.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The records belong to the mapping, so none is destroyed.
+ ***/
+void cimage_destroy(CHash * tbl)
+{
+  munmap((void *)tbl->image, tbl->imagebytes);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cimage_stats
+ *
+ * DESCRIPTION:	    Fills in the shape of a mapped image.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    stats: (CHashStats *) -- zeroed by the caller.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Reads the bucket starts, so touches every page of them.
+ ***/
+void cimage_stats(CHash * tbl, CHashStats * stats)
+{
+  const unsigned char * image = tbl->image;
+  const CHashImageHeader * header = tbl->image;
+  const uint64_t * starts = (const uint64_t *)(image + header->starts);
+
+  stats->buckets = tbl->buckets;
+  for (unsigned int b = 0; b < tbl->buckets; b++) {
+    uint64_t length = starts[b + 1] - starts[b];
+    stats->histogram[length < CHASH_STATS_HISTOGRAM
+		     ? length : CHASH_STATS_HISTOGRAM - 1]++;
+    if (length == 0) {
+      stats->empty++;
+      continue;
+    }
+
+    stats->used++;
+    if (length > stats->max_chain)
+      stats->max_chain = length;
+  }
+
+  if (stats->used > 0)
+    stats->mean_chain = (float)tbl->size / stats->used;
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    collect
+ *
+ * DESCRIPTION:	    chash_scan callback appending an element to a SaveList.
+ *
+ * ARGUMENTS:	    data: (void *) -- the element.
+ *		    arg: (void *) -- the SaveList.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Elements past the capacity of the list are dropped.
+ ***/
+static void collect(void * data, void * arg)
+{
+  SaveList * list = arg;
+  if (list->count < list->capacity)
+    list->data[list->count++] = data;
+}
+
+/******************************************************************************
+ * FUNCTION:	    write_image
+ *
+ * DESCRIPTION:	    Writes the records of an image, then its header, bucket
+ *		    starts and entries.
+ *
+ * ARGUMENTS:	    file: (FILE *) -- the file, open for writing.
+ *		    header: (CHashImageHeader *) -- the header. Receives the
+ *			size of the file.
+ *		    starts: (const uint64_t *) -- the bucket starts.
+ *		    entries: (CHashImageEntry *) -- the entries, with their
+ *			hashes set. Receive the positions of their records.
+ *		    sorted: (void **) -- the elements, in the order of entries.
+ *		    encode: (size_t (*)(const void *, const void **)) -- as
+ *			passed to chash_save.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    The records come first so that each element is encoded
+ *		    once: the position of its record is only known after the
+ *		    records before it have been written.
+ ***/
+static int write_image(FILE * file, CHashImageHeader * header,
+		       const uint64_t * starts, CHashImageEntry * entries,
+		       void ** sorted,
+		       size_t (*encode)(const void *, const void **))
+{
+  static const unsigned char zeroes[CIMAGE_ALIGN] = {0};
+  uint64_t offset = ALIGN_UP(header->entries
+			     + header->count * sizeof(CHashImageEntry));
+  if (fseek(file, offset, SEEK_SET) != 0)
+    return -1;
+
+  for (uint64_t i = 0; i < header->count; i++) {
+    const void * bytes = NULL;
+    size_t length = encode(sorted[i], &bytes);
+    if (length > 0 && fwrite(bytes, 1, length, file) != length)
+      return -1;
+
+    entries[i].offset = offset;
+    entries[i].length = length;
+    offset += length;
+    size_t padding = ALIGN_UP(offset) - offset;
+    if (fwrite(zeroes, 1, padding, file) != padding)
+      return -1;
+    offset += padding;
+  }
+
+  header->bytes = offset;
+  if (fseek(file, 0, SEEK_SET) != 0
+      || fwrite(header, sizeof(CHashImageHeader), 1, file) != 1
+      || fwrite(starts, sizeof(uint64_t), header->buckets + 1, file)
+      != header->buckets + 1
+      || (header->count > 0
+	  && fwrite(entries, sizeof(CHashImageEntry), header->count, file)
+	  != header->count))
+    return -1;
+  if (fflush(file) != 0 || fsync(fileno(file)) != 0)
+    return -1;
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    valid_image
+ *
+ * DESCRIPTION:	    Checks that a mapped file holds an image this build can
+ *		    serve.
+ *
+ * ARGUMENTS:	    image: (const unsigned char *) -- the mapping.
+ *		    bytes: (size_t) -- its size.
+ *
+ * RETURN:	    int -- 1 if the image is usable, 0 otherwise.
+ *
+ * NOTES:	    Only the header and the last bucket start are checked, in
+ *		    constant time. That catches a file of another format, byte
+ *		    order or version, and one cut short, but the records of an
+ *		    image are trusted like the memory of any other table.
+ ***/
+static int valid_image(const unsigned char * image, size_t bytes)
+{
+  const CHashImageHeader * header = (const CHashImageHeader *)image;
+  if (memcmp(header->magic, CIMAGE_MAGIC, sizeof(header->magic))
+      || header->version != CIMAGE_VERSION
+      || header->byteorder != CIMAGE_BYTEORDER
+      || header->bytes != bytes)
+    return 0;
+
+  if (header->index > CHASH_INDEX_FIBONACCI || header->buckets == 0
+      || header->buckets > (1u << 31) || header->count > UINT32_MAX
+      || (header->index != CHASH_INDEX_MODULO
+	  && (header->buckets & (header->buckets - 1)) != 0))
+    return 0;
+
+  if (header->starts < sizeof(CHashImageHeader)
+      || header->starts % sizeof(uint64_t) != 0
+      || header->starts + (header->buckets + 1) * sizeof(uint64_t) > bytes
+      || header->entries % sizeof(uint64_t) != 0
+      || header->entries < header->starts
+      || header->entries + header->count * sizeof(CHashImageEntry) > bytes)
+    return 0;
+
+  const uint64_t * starts = (const uint64_t *)(image + header->starts);
+  return starts[header->buckets] == header->count;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,88 @@
+/******************************************************************************
+ * NAME:	    chash-image.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    On-disk format of a table image, and the internal interface
+ *		    of the read-only engine serving a mapped image. These
+ *		    functions are called by the CHash API when a table was
+ *		    created with chash_load, and are not meant to be called
+ *		    directly.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_CHASH_IMAGE_H__
+#define __ET_CHASH_IMAGE_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+
+#include "chain-hash.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define CIMAGE_MAGIC	 "CHASHIMG"
+#define CIMAGE_VERSION	 1
+#define CIMAGE_BYTEORDER 0x01020304u
+
+/* Set in the flags of an image saved from a table with a 64-bit hash. */
+#define CIMAGE_HASH64	 0x1u
+
+/* Every record starts on a multiple of this many bytes. */
+#define CIMAGE_ALIGN	 16
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/*
+ * An image is laid out as the header, the array of bucket starts, the array of
+ * entries and then the records. Every position is a byte offset from the start
+ * of the file, so the image can be mapped at any address. The entries of
+ * bucket b are entries[starts[b]] up to entries[starts[b + 1]].
+ */
+typedef struct _CHashImageHeader_ {
+
+  char magic[8];
+  uint32_t version;
+  uint32_t byteorder;
+  uint32_t flags;
+  uint32_t index;
+  uint64_t buckets;
+  uint64_t count;
+  uint64_t starts;
+  uint64_t entries;
+  uint64_t bytes;
+
+} CHashImageHeader;
+
+typedef struct _CHashImageEntry_ {
+
+  uint64_t hash;
+  uint64_t offset;
+  uint64_t length;
+
+} CHashImageEntry;
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int cimage_lookup(CHash * table, void ** data);
+extern void cimage_traverse(CHash * table, void (*callback)(void *));
+extern uint64_t cimage_scan(CHash * table, uint64_t cursor,
+			    void (*callback)(void *, void *), void * arg);
+extern void cimage_destroy(CHash * table);
+extern void cimage_stats(CHash * table, CHashStats * stats);
+
+#endif /* __ET_CHASH_IMAGE_H__ */
+
+/*****************************************************************************/
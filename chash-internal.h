@@ -0,0 +1,254 @@
+/******************************************************************************
+ * NAME:	    chash-internal.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Helpers shared by the source files of the CHash API. Not
+ *		    part of the public interface.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_CHASH_INTERNAL_H__
+#define __ET_CHASH_INTERNAL_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "chain-hash.h"
+#include "chash-trace.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* 2^64 / phi, the multiplier for Fibonacci hashing. */
+#define CHASH_FIBONACCI 11400714819323198485ULL
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* The chain element of a map table, whose value follows the element. */
+typedef struct _CHashMapElmt_ {
+
+  CHashElmt elmt;
+  void * value;
+
+} CHashMapElmt;
+
+/*
+ * The CLOCK links of an element of a cache table, which follow the element
+ * (and its value, on a map table).
+ */
+typedef struct _CHashClockLink_ {
+
+  CHashElmt * prev;
+  CHashElmt * next;
+  unsigned int referenced;
+
+} CHashClockLink;
+
+/*
+ * The timer links of an element of an expiring table, which follow its CLOCK
+ * links, if any. A deadline of 0 means the element never expires.
+ */
+typedef struct _CHashTimerLink_ {
+
+  CHashElmt * next;
+  CHashElmt ** pprev; /* NULL while the element is on no wheel. */
+  uint64_t deadline;
+
+} CHashTimerLink;
+
+/*
+ * The key of an element of a table with inline keys, which follows its timer
+ * links, if any. A key longer than tbl->inlinekey keeps only its first
+ * tbl->inlinekey bytes here.
+ */
+typedef struct _CHashInlineKey_ {
+
+  uint32_t length; /* Saturates at UINT32_MAX. */
+  unsigned char bytes[];
+
+} CHashInlineKey;
+
+/* The key of the data a probe looks for, from tbl->key, once it is needed. */
+typedef struct _CHashKey_ {
+
+  const void * bytes;
+  size_t length;
+
+} CHashKey;
+
+/* What the put functions do with an element matching the one inserted. */
+typedef enum _CHashPutMode_ {
+
+  CHASH_PUT_FIND = 0, /* Return it. */
+  CHASH_PUT_REPLACE,  /* Replace it, and destroy it. */
+  CHASH_PUT_VALUE     /* Replace its value, and destroy the old value. */
+
+} CHashPutMode;
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* Returns the value slot of an element of a map table. */
+static inline void ** chash_valueof(CHashElmt * elmt)
+{
+  return &(((CHashMapElmt *)elmt)->value);
+}
+
+/* Destroys data replaced in or removed from a table, timing traced tables. */
+static inline void chash_drop_data(const CHash * tbl, void * data)
+{
+  if (data == NULL || tbl->destroy == NULL)
+    return;
+  if (tbl->traced)
+    ctrace_destroy(tbl, data);
+  else
+    tbl->destroy(data);
+}
+
+/* Destroys a value replaced in or removed from a map table. */
+static inline void chash_drop_value(const CHash * tbl, void * value)
+{
+  if (value != NULL && tbl->destroy_value != NULL)
+    tbl->destroy_value(value);
+}
+
+/* Returns the CLOCK links of an element of a cache table. */
+static inline CHashClockLink * chash_clockof(const CHash * tbl,
+					     CHashElmt * elmt)
+{
+  return (CHashClockLink *)((char *)elmt + (tbl->map ? sizeof(CHashMapElmt)
+					    : sizeof(CHashElmt)));
+}
+
+/* Returns the timer links of an element of an expiring table. */
+static inline CHashTimerLink * chash_timerof(const CHash * tbl,
+					     CHashElmt * elmt)
+{
+  return (CHashTimerLink *)((char *)chash_clockof(tbl, elmt)
+			    + (tbl->capacity != 0 ? sizeof(CHashClockLink)
+			       : 0));
+}
+
+/* Returns the inline key of an element of a table with inline keys. */
+static inline CHashInlineKey * chash_inlineof(const CHash * tbl,
+					      const CHashElmt * elmt)
+{
+  return (CHashInlineKey *)((char *)chash_timerof(tbl, (CHashElmt *)elmt)
+			    + (tbl->expiry ? sizeof(CHashTimerLink) : 0));
+}
+
+/* Returns the size of the inline keys of a table, padded to eight bytes. */
+static inline size_t chash_inlinesize(const CHash * tbl)
+{
+  if (tbl->inlinekey == 0)
+    return 0;
+  return (sizeof(CHashInlineKey) + tbl->inlinekey + 7) & ~(size_t)7;
+}
+
+/* Returns the size of the chain elements of a table. */
+static inline size_t chash_elmtsize(const CHash * tbl)
+{
+  return (tbl->map ? sizeof(CHashMapElmt) : sizeof(CHashElmt))
+    + (tbl->capacity != 0 ? sizeof(CHashClockLink) : 0)
+    + (tbl->expiry ? sizeof(CHashTimerLink) : 0)
+    + chash_inlinesize(tbl);
+}
+
+/* Returns element i of a block of contiguous chain elements. */
+static inline CHashElmt * chash_elmtat(const CHash * tbl, CHashElmt * block,
+				       size_t i)
+{
+  return (CHashElmt *)((char *)block + i * chash_elmtsize(tbl));
+}
+
+/* Stores the key of data in a new element of a table with inline keys. */
+static inline void chash_keyset(const CHash * tbl, CHashElmt * elmt,
+				const void * data)
+{
+  if (tbl->inlinekey == 0)
+    return;
+
+  const void * bytes;
+  size_t length = tbl->key(data, &bytes);
+  CHashInlineKey * stored = chash_inlineof(tbl, elmt);
+  stored->length = length < UINT32_MAX ? length : UINT32_MAX;
+  memcpy(stored->bytes, bytes,
+	 length < tbl->inlinekey ? length : tbl->inlinekey);
+}
+
+/*
+ * Whether an element matches the data of a probe, whose hash is hash. With
+ * inline keys, the key of data is taken into key, which starts out zeroed, at
+ * the first element of equal hash, and the lengths and stored bytes are
+ * compared before tbl->match, which is only called on keys longer than
+ * tbl->inlinekey.
+ */
+static inline int chash_matches(const CHash * tbl, CHashKey * key,
+				const void * data, uint64_t hash,
+				const CHashElmt * elmt)
+{
+  if (elmt->hash != hash)
+    return 0;
+
+  if (tbl->inlinekey != 0) {
+    if (key->bytes == NULL)
+      key->length = tbl->key(data, &(key->bytes));
+
+    const CHashInlineKey * stored = chash_inlineof(tbl, elmt);
+    if (stored->length != (key->length < UINT32_MAX ? key->length
+			   : UINT32_MAX))
+      return 0;
+    if (key->length <= tbl->inlinekey)
+      return !memcmp(stored->bytes, key->bytes, key->length);
+    if (memcmp(stored->bytes, key->bytes, tbl->inlinekey))
+      return 0;
+  }
+  return tbl->match(data, elmt->data);
+}
+
+/*
+ * Returns the hash of data from whichever hash function the table has. The
+ * result of a 32-bit hash is zero-extended, so negative hashes never
+ * sign-extend into the high bits.
+ */
+static inline uint64_t chash_hashof(const CHash * tbl, const void * data)
+{
+  if (tbl->hash64 != NULL)
+    return tbl->hash64(data);
+  return (uint32_t)tbl->hash(data);
+}
+
+/*
+ * Reduces a hash to a bucket index in an array of the given size, according
+ * to tbl->index. Buckets must be a power of two unless the index is
+ * CHASH_INDEX_MODULO.
+ */
+static inline unsigned int chash_indexof(const CHash * tbl, uint64_t hash,
+					 unsigned int buckets)
+{
+  switch (tbl->index) {
+  case CHASH_INDEX_MASK:
+    return hash & (buckets - 1);
+  case CHASH_INDEX_FIBONACCI:
+    /* Shifting in two steps keeps buckets == 1 from shifting by 64. */
+    return ((hash * CHASH_FIBONACCI) >> (63 - __builtin_ctz(buckets))) >> 1;
+  default:
+    return hash % buckets;
+  }
+}
+
+#endif /* __ET_CHASH_INTERNAL_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,154 @@
+/******************************************************************************
+ * NAME:	    chash-lock.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for creating and destroying the lock stripes
+ *		    of a concurrent table.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Lock striping for the CHash API
+ *
+ * A concurrent table has tbl->stripes locks, a power of two no larger than
+ * its smallest bucket array. The stripe of an element is computed from its
+ * hash in the same way as its bucket, so each bucket of both tbl->table and
+ * tbl->oldtable is covered by exactly one stripe, and migrating a bucket
+ * during a resize only takes that one stripe. Replacing the bucket arrays
+ * takes every stripe, in ascending order, while holding the rehash mutex.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-epoch.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * LOCAL VARIABLES
+ ***/
+
+static unsigned int next_slot;
+static _Thread_local unsigned int thread_slot = UINT_MAX;
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    cstripe_init
+ *
+ * DESCRIPTION:	    Allocates and initializes the locks of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with tbl->index set.
+ *		    mode: (CHashConcurrency) -- mutex or reader/writer stripes,
+ *			or mutex stripes with unlocked lookups.
+ *		    stripes: (unsigned int) -- the number of stripes, a power of
+ *			two.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    For CHASH_CONCURRENCY_NONE, leaves tbl->locks NULL and
+ *		    tbl->stripes at 1.
+ ***/
+int cstripe_init(CHash * tbl, CHashConcurrency mode, unsigned int stripes)
+{
+  tbl->locks = NULL;
+  tbl->stripes = 1;
+  if (mode == CHASH_CONCURRENCY_NONE)
+    return 0;
+
+  CHashLocks * locks = cmem_alloc(&(tbl->allocator), sizeof(CHashLocks)
+				  + stripes * sizeof(CHashStripe));
+  if (locks == NULL)
+    return -1;
+
+  locks->epoch = NULL;
+  if (mode == CHASH_CONCURRENCY_EPOCH
+      && (locks->epoch = cepoch_init(tbl)) == NULL) {
+    cmem_free(&(tbl->allocator), locks, sizeof(CHashLocks)
+	      + stripes * sizeof(CHashStripe));
+    return -1;
+  }
+
+  locks->mode = mode;
+  pthread_mutex_init(&(locks->rehash), NULL);
+  pthread_mutex_init(&(locks->pool), NULL);
+  for (unsigned int i = 0; i < stripes; i++) {
+    if (mode == CHASH_CONCURRENCY_RWLOCK)
+      pthread_rwlock_init(&(locks->stripes[i].rwlock), NULL);
+    else
+      pthread_mutex_init(&(locks->stripes[i].mutex), NULL);
+  }
+
+  tbl->locks = locks;
+  tbl->stripes = stripes;
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cstripe_destroy
+ *
+ * DESCRIPTION:	    Destroys and frees the locks of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    No thread may hold or wait on any of the locks. Anything
+ *		    still waiting for a grace period is freed first, so this
+ *		    must come before the node pool is released.
+ ***/
+void cstripe_destroy(CHash * tbl)
+{
+  CHashLocks * locks = tbl->locks;
+  if (locks == NULL)
+    return;
+
+  cepoch_destroy(tbl, locks->epoch);
+  for (unsigned int i = 0; i < tbl->stripes; i++) {
+    if (locks->mode == CHASH_CONCURRENCY_RWLOCK)
+      pthread_rwlock_destroy(&(locks->stripes[i].rwlock));
+    else
+      pthread_mutex_destroy(&(locks->stripes[i].mutex));
+  }
+  pthread_mutex_destroy(&(locks->rehash));
+  pthread_mutex_destroy(&(locks->pool));
+  cmem_free(&(tbl->allocator), locks, sizeof(CHashLocks)
+	    + tbl->stripes * sizeof(CHashStripe));
+  tbl->locks = NULL;
+  tbl->stripes = 1;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cstripe_thread_slot
+ *
+ * DESCRIPTION:	    Returns a number identifying the calling thread, used to
+ *		    spread per-thread state over a fixed number of slots.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    unsigned int -- the same value on every call from a thread.
+ *
+ * NOTES:	    Threads are numbered in the order they first call this.
+ *		    Callers reduce the number modulo their own slot count.
+ ***/
+unsigned int cstripe_thread_slot(void)
+{
+  if (thread_slot == UINT_MAX)
+    thread_slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED);
+  return thread_slot;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,191 @@
+/******************************************************************************
+ * NAME:	    chash-lock.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the lock stripes of concurrent
+ *		    tables. Every function here is a no-op on a table created
+ *		    without CHashOpts.concurrency.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_CHASH_LOCK_H__
+#define __ET_CHASH_LOCK_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <pthread.h>
+
+#include "chain-hash.h"
+#include "chash-epoch.h"
+#include "chash-internal.h"
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One stripe, padded to a cache line so neighbouring stripes don't share. */
+typedef union _CHashStripe_ {
+
+  pthread_mutex_t mutex;
+  pthread_rwlock_t rwlock;
+  char pad[64];
+
+} CHashStripe;
+
+struct _CHashLocks_ {
+
+  CHashConcurrency mode;
+  pthread_mutex_t rehash;
+  pthread_mutex_t pool;
+  CHashEpoch * epoch; /* Only for CHASH_CONCURRENCY_EPOCH. */
+  CHashStripe stripes[];
+
+};
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int cstripe_init(CHash * table, CHashConcurrency mode,
+			unsigned int stripes);
+extern void cstripe_destroy(CHash * table);
+extern unsigned int cstripe_thread_slot(void);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* The stripe covering every bucket that hash can map to, at any size. */
+static inline unsigned int cstripe_of_hash(const CHash * tbl, uint64_t hash)
+{
+  return chash_indexof(tbl, hash, tbl->stripes);
+}
+
+/* The stripe covering bucket in an array of the given size. */
+static inline unsigned int cstripe_of_bucket(const CHash * tbl,
+					     unsigned int bucket,
+					     unsigned int buckets)
+{
+  if (tbl->index == CHASH_INDEX_FIBONACCI)
+    return bucket >> (__builtin_ctz(buckets) - __builtin_ctz(tbl->stripes));
+  return bucket & (tbl->stripes - 1);
+}
+
+/* The first bucket of an array covered by stripe. */
+static inline unsigned int cstripe_first(const CHash * tbl,
+					 unsigned int stripe,
+					 unsigned int buckets)
+{
+  if (tbl->index == CHASH_INDEX_FIBONACCI)
+    return stripe * (buckets / tbl->stripes);
+  return stripe;
+}
+
+/* The bucket after bucket covered by the same stripe, or buckets if none. */
+static inline unsigned int cstripe_next(const CHash * tbl,
+					unsigned int bucket,
+					unsigned int buckets)
+{
+  if (tbl->index == CHASH_INDEX_FIBONACCI) {
+    unsigned int span = buckets / tbl->stripes;
+    return (bucket + 1) % span == 0 ? buckets : bucket + 1;
+  }
+  return bucket + tbl->stripes;
+}
+
+static inline void cstripe_read(CHash * tbl, unsigned int stripe)
+{
+  if (tbl->locks == NULL)
+    return;
+
+  if (tbl->locks->mode == CHASH_CONCURRENCY_RWLOCK)
+    pthread_rwlock_rdlock(&(tbl->locks->stripes[stripe].rwlock));
+  else
+    pthread_mutex_lock(&(tbl->locks->stripes[stripe].mutex));
+}
+
+static inline void cstripe_write(CHash * tbl, unsigned int stripe)
+{
+  if (tbl->locks == NULL)
+    return;
+
+  if (tbl->locks->mode == CHASH_CONCURRENCY_RWLOCK)
+    pthread_rwlock_wrlock(&(tbl->locks->stripes[stripe].rwlock));
+  else
+    pthread_mutex_lock(&(tbl->locks->stripes[stripe].mutex));
+}
+
+static inline void cstripe_unlock(CHash * tbl, unsigned int stripe)
+{
+  if (tbl->locks == NULL)
+    return;
+
+  if (tbl->locks->mode == CHASH_CONCURRENCY_RWLOCK)
+    pthread_rwlock_unlock(&(tbl->locks->stripes[stripe].rwlock));
+  else
+    pthread_mutex_unlock(&(tbl->locks->stripes[stripe].mutex));
+}
+
+/* Always taken in ascending order, so two callers cannot deadlock. */
+static inline void cstripe_write_all(CHash * tbl)
+{
+  for (unsigned int i = 0; tbl->locks != NULL && i < tbl->stripes; i++)
+    cstripe_write(tbl, i);
+}
+
+static inline void cstripe_unlock_all(CHash * tbl)
+{
+  for (unsigned int i = 0; tbl->locks != NULL && i < tbl->stripes; i++)
+    cstripe_unlock(tbl, i);
+}
+
+/*
+ * Only one thread at a time drives a resize. Others simply skip their share
+ * of the work instead of waiting, so this never blocks.
+ */
+static inline int cstripe_rehash_trylock(CHash * tbl)
+{
+  if (tbl->locks == NULL)
+    return 1;
+  return !pthread_mutex_trylock(&(tbl->locks->rehash));
+}
+
+static inline void cstripe_rehash_unlock(CHash * tbl)
+{
+  if (tbl->locks != NULL)
+    pthread_mutex_unlock(&(tbl->locks->rehash));
+}
+
+/* Whether cstripe_read excludes every other thread from the stripe. */
+static inline int cstripe_exclusive(const CHash * tbl)
+{
+  return tbl->locks == NULL || tbl->locks->mode == CHASH_CONCURRENCY_MUTEX;
+}
+
+/* The epoch state of the table, or NULL if its lookups take locks. */
+static inline CHashEpoch * cstripe_epoch(const CHash * tbl)
+{
+  return tbl->locks != NULL ? tbl->locks->epoch : NULL;
+}
+
+static inline void cstripe_pool_lock(CHash * tbl)
+{
+  if (tbl->locks != NULL)
+    pthread_mutex_lock(&(tbl->locks->pool));
+}
+
+static inline void cstripe_pool_unlock(CHash * tbl)
+{
+  if (tbl->locks != NULL)
+    pthread_mutex_unlock(&(tbl->locks->pool));
+}
+
+#endif /* __ET_CHASH_LOCK_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,333 @@
+/******************************************************************************
+ * NAME:	    chash-parallel.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the parallel bulk operations: traversal and
+ *		    destruction spread over several threads.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Parallel bulk operations for the CHash API
+ *
+ * The work is cut into many more chunks than there are threads, and every
+ * thread claims the next chunk from a shared cursor as soon as it finishes
+ * the last one. A thread held up by a long chain or a slow callback simply
+ * claims fewer chunks, so the threads finish together without a chunk ever
+ * having to be split or handed over.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "chain-hash.h"
+#include "chash-bitmap.h"
+#include "chash-defer.h"
+#include "chash-epoch.h"
+#include "chash-lock.h"
+#include "chash-parallel.h"
+#include "open-hash.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The most threads cpar_run starts. */
+#define CPAR_MAX_THREADS 256
+
+/* Groups of OHASH_GROUP slots per chunk of the open engine. */
+#define CPAR_GROUPS 64
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct _CParJob_ {
+
+  void (*task)(void *, uint64_t);
+  void * arg;
+  uint64_t chunks;
+  uint64_t next;
+
+} CParJob;
+
+typedef struct _CParWalk_ {
+
+  CHash * tbl;
+  void (*callback)(void *);
+  uint64_t oldchunks;
+
+} CParWalk;
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void * work(void *);
+static void walk_stripe(void *, uint64_t);
+static void walk_range(void *, uint64_t);
+static void walk_scan(void *, uint64_t);
+static void call(void *, void *);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    chash_traverse_parallel
+ *
+ * DESCRIPTION:	    Calls callback() on every element of the table, from
+ *		    several threads at once.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the hash table in question.
+ *		    callback: (void (*)(void *)) -- the callback, which must be
+ *			safe to call from several threads.
+ *		    threads: (int) -- the number of threads, or 0 or less for
+ *			one per online processor.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Tables with a concurrency mode are walked a stripe per
+ *		    chunk, holding its read lock as chash_traverse does. Other
+ *		    tables must not be modified during the walk, and are cut
+ *		    into chunks of CPAR_BUCKETS buckets.
+ ***/
+void chash_traverse_parallel(CHash * tbl, void (*callback)(void *),
+			     int threads)
+{
+  CParWalk walk = {.tbl = tbl, .callback = callback, .oldchunks = 0};
+  if (tbl->engine == CHASH_ENGINE_OPEN) {
+    cpar_run(threads, (tbl->buckets / OHASH_GROUP + CPAR_GROUPS - 1)
+	     / CPAR_GROUPS, walk_scan, &walk);
+  } else if (tbl->engine == CHASH_ENGINE_IMAGE) {
+    cpar_run(threads, (tbl->buckets + CPAR_BUCKETS - 1) / CPAR_BUCKETS,
+	     walk_scan, &walk);
+  } else if (tbl->locks != NULL) {
+    cpar_run(threads, tbl->stripes, walk_stripe, &walk);
+  } else {
+    walk.oldchunks = tbl->oldtable != NULL
+      ? (tbl->oldbuckets + CPAR_BUCKETS - 1) / CPAR_BUCKETS : 0;
+    cpar_run(threads, walk.oldchunks + (tbl->buckets + CPAR_BUCKETS - 1)
+	     / CPAR_BUCKETS, walk_range, &walk);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_destroy_parallel
+ *
+ * DESCRIPTION:	    Destroys a table like chash_destroy, calling tbl->destroy
+ *		    from several threads at once.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    threads: (int) -- as for chash_traverse_parallel.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    tbl->destroy must be safe to call from several threads.
+ *		    Elements waiting for a grace period on an epoch table, or
+ *		    queued by a deferred one, are destroyed first, on the
+ *		    calling thread. The table itself is then freed by
+ *		    chash_destroy. The values of a map table are not visited
+ *		    by a traversal, so a map table is destroyed on the calling
+ *		    thread alone, and one with a collector thread is handed to
+ *		    it by chash_destroy.
+ ***/
+void chash_destroy_parallel(CHash * tbl, int threads)
+{
+  if (tbl->destroy != NULL && tbl->engine != CHASH_ENGINE_IMAGE
+      && !tbl->map && !cdefer_threaded(tbl)) {
+    cepoch_flush(tbl, cstripe_epoch(tbl));
+    chash_collect(tbl, 0);
+    chash_traverse_parallel(tbl, tbl->destroy, threads);
+    tbl->destroy = NULL;
+  }
+  chash_destroy(tbl);
+}
+
+/******************************************************************************
+ * FUNCTION:	    cpar_run
+ *
+ * DESCRIPTION:	    Calls task() once for every chunk, from several threads.
+ *
+ * ARGUMENTS:	    threads: (int) -- the number of threads, or 0 or less for
+ *			one per online processor.
+ *		    chunks: (uint64_t) -- the number of chunks.
+ *		    task: (void (*)(void *, uint64_t)) -- the work for one
+ *			chunk.
+ *		    arg: (void *) -- passed through to task.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The calling thread works too, so every chunk is done even
+ *		    if no thread can be started. Returns once all are done, and
+ *		    everything written by task() is then visible.
+ ***/
+void cpar_run(int threads, uint64_t chunks,
+	      void (*task)(void *, uint64_t), void * arg)
+{
+  if (threads <= 0)
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads > CPAR_MAX_THREADS)
+    threads = CPAR_MAX_THREADS;
+  if ((uint64_t)threads > chunks)
+    threads = chunks;
+
+  CParJob job = {.task = task, .arg = arg, .chunks = chunks, .next = 0};
+  pthread_t workers[CPAR_MAX_THREADS];
+  int started = 0;
+  while (started < threads - 1
+	 && !pthread_create(&(workers[started]), NULL, work, &job))
+    started++;
+
+  work(&job);
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i], NULL);
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    work
+ *
+ * DESCRIPTION:	    Runs the chunks of a job until none is left.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the CParJob.
+ *
+ * RETURN:	    void * -- NULL.
+ *
+ * NOTES:	    none.
+ ***/
+static void * work(void * arg)
+{
+  CParJob * job = arg;
+  uint64_t chunk;
+  while ((chunk = __atomic_fetch_add(&(job->next), 1, __ATOMIC_RELAXED))
+	 < job->chunks)
+    job->task(job->arg, chunk);
+  return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    walk_stripe
+ *
+ * DESCRIPTION:	    Visits the buckets of one stripe, in both bucket arrays.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the CParWalk.
+ *		    stripe: (uint64_t) -- the stripe.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void walk_stripe(void * arg, uint64_t stripe)
+{
+  CParWalk * walk = arg;
+  CHash * tbl = walk->tbl;
+  cstripe_read(tbl, stripe);
+  for (int a = 0; a < 2; a++) {
+    CHashElmt ** table = a == 0 ? tbl->oldtable : tbl->table;
+    unsigned int buckets = a == 0 ? tbl->oldbuckets : tbl->buckets;
+    if (table == NULL)
+      continue;
+
+    const uint64_t * bits = cbits_of(table, buckets);
+    for (unsigned int i = cbits_first(tbl, bits, buckets, stripe);
+	 i < buckets; i = cbits_next(tbl, bits, buckets, i)) {
+      for (CHashElmt * elmt = table[i]; elmt != NULL; elmt = elmt->next)
+	walk->callback(elmt->data);
+    }
+  }
+  cstripe_unlock(tbl, stripe);
+}
+
+/******************************************************************************
+ * FUNCTION:	    walk_range
+ *
+ * DESCRIPTION:	    Visits one range of CPAR_BUCKETS buckets of a table with no
+ *		    locks.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the CParWalk.
+ *		    chunk: (uint64_t) -- the range. The first oldchunks ranges
+ *			are in tbl->oldtable.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void walk_range(void * arg, uint64_t chunk)
+{
+  CParWalk * walk = arg;
+  CHash * tbl = walk->tbl;
+  CHashElmt ** table = tbl->table;
+  unsigned int buckets = tbl->buckets;
+  if (chunk < walk->oldchunks) {
+    table = tbl->oldtable;
+    buckets = tbl->oldbuckets;
+  } else {
+    chunk -= walk->oldchunks;
+  }
+
+  unsigned int end = (chunk + 1) * CPAR_BUCKETS < buckets
+    ? (chunk + 1) * CPAR_BUCKETS : buckets;
+  const uint64_t * bits = cbits_of(table, buckets);
+  for (unsigned int i = cbits_scan(bits, chunk * CPAR_BUCKETS, end); i < end;
+       i = cbits_scan(bits, i + 1, end)) {
+    for (CHashElmt * elmt = table[i]; elmt != NULL; elmt = elmt->next)
+      walk->callback(elmt->data);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    walk_scan
+ *
+ * DESCRIPTION:	    Visits one chunk of an open or image table, through the
+ *		    scan cursor of its engine.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the CParWalk.
+ *		    chunk: (uint64_t) -- the chunk.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The cursors of both engines are plain indexes: a group of
+ *		    slots, or a bucket.
+ ***/
+static void walk_scan(void * arg, uint64_t chunk)
+{
+  CParWalk * walk = arg;
+  CHash * tbl = walk->tbl;
+  uint64_t per = tbl->engine == CHASH_ENGINE_OPEN ? CPAR_GROUPS : CPAR_BUCKETS;
+  for (uint64_t cursor = chunk * per; cursor < (chunk + 1) * per; cursor++) {
+    if (chash_scan(tbl, cursor, call, walk) == 0)
+      break;
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    call
+ *
+ * DESCRIPTION:	    chash_scan callback forwarding an element to the callback
+ *		    of a CParWalk.
+ *
+ * ARGUMENTS:	    data: (void *) -- the element.
+ *		    arg: (void *) -- the CParWalk.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void call(void * data, void * arg)
+{
+  ((CParWalk *)arg)->callback(data);
+}
+
+/*****************************************************************************/
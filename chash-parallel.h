@@ -0,0 +1,43 @@
+/******************************************************************************
+ * NAME:	    chash-parallel.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for spreading the work of a bulk
+ *		    operation over several threads.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_CHASH_PARALLEL_H__
+#define __ET_CHASH_PARALLEL_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Buckets per chunk of a parallel walk. A multiple of 64, so that no two
+ * chunks share a word of the occupancy bitmap. */
+#define CPAR_BUCKETS 256
+
+/* Elements per chunk of a parallel pass over an array. */
+#define CPAR_ELEMENTS 4096
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern void cpar_run(int threads, uint64_t chunks,
+		     void (*task)(void * arg, uint64_t chunk), void * arg);
+
+#endif /* __ET_CHASH_PARALLEL_H__ */
+
+/*****************************************************************************/
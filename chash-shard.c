@@ -0,0 +1,534 @@
+/******************************************************************************
+ * NAME:	    chash-shard.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for sharded tables, which split the key space
+ *		    over independent tables, and for the NUMA allocator that
+ *		    places each of them on a node of its own.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Sharded tables for the CHash API
+ *
+ * The shard of an element is taken from the high bits of its hash, after a
+ * finalizer of its own. The tables of the shards reduce the hash to a bucket
+ * with its low bits, or with a different multiplier, and the open engine
+ * takes its control bytes from a different finalizer, so the elements of one
+ * shard still spread over all of its buckets.
+ *
+ * A shard given a NUMA node draws its memory from chash_numa_allocator.
+ * Blocks of at least CHASH_NUMA_MINBYTES are mapped with mmap and bound to
+ * the node with mbind, and smaller ones come from malloc, so the bucket
+ * arrays, slots and node pool slabs are on the node the shard was given.
+ * Outside of Linux the node is ignored.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-internal.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The most shards a sharded table has. */
+#define CHASH_SHARDS_MAX 4096
+
+/* Blocks smaller than this come from malloc, wherever it puts them. */
+#define CHASH_NUMA_MINBYTES 4096
+
+/* The number of nodes a node mask given to mbind covers. */
+#define CHASH_NUMA_NODES 1024
+
+/* MPOL_PREFERRED from <linux/mempolicy.h>: take another node when it is full,
+ * rather than failing. */
+#define CHASH_MPOL_PREFERRED 1
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static uint64_t shard_mix(uint64_t);
+static void stats_add(CHashStats *, const CHashStats *);
+#ifdef __linux__
+static int node_cpus(int, cpu_set_t *);
+#endif
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_init
+ *
+ * DESCRIPTION:	    Creates a sharded table of count independent tables.
+ *
+ * ARGUMENTS:	    size, hash, match, destroy: as for chash_init, with size
+ *			split between the shards.
+ *		    opts: (const CHashOpts *) -- the options of every shard, or
+ *			NULL.
+ *		    count: (unsigned int) -- the number of shards, rounded up
+ *			to a power of two.
+ *		    nodes: (const int *) -- the NUMA node of each of the count
+ *			shards, or NULL.
+ *
+ * RETURN:	    CHashShards * -- the sharded table, or NULL on error.
+ *
+ * NOTES:	    A shard with a node gets chash_numa_allocator(node), so
+ *		    nodes cannot be combined with opts->allocator. Its chained
+ *		    elements then come from a node pool of CHASH_SHARD_POOLSIZE
+ *		    unless opts->poolsize is set, so that they live in slabs
+ *		    large enough to be bound to the node. Shards past the end
+ *		    of nodes, when count is rounded up, use the nodes again
+ *		    from the start. Like size, opts->capacity is split between
+ *		    the shards.
+ ***/
+CHashShards * chash_shards_init(int size,
+				int (*hash)(const void *),
+				int (*match)(const void *, const void *),
+				void (*destroy)(void *),
+				const CHashOpts * opts,
+				unsigned int count, const int * nodes)
+{
+  CHashOpts options = opts != NULL ? *opts : (CHashOpts){0};
+  if (size <= 0 || count == 0 || count > CHASH_SHARDS_MAX
+      || (nodes != NULL && options.allocator != NULL))
+    return NULL;
+
+  unsigned int bits = 0;
+  while ((1u << bits) < count)
+    bits++;
+
+  const CHashAllocator libc = {0};
+  const CHashAllocator * allocator = options.allocator != NULL
+    ? options.allocator : &libc;
+  CHashShards * shards = cmem_alloc(allocator, sizeof(CHashShards));
+  if (shards == NULL)
+    return NULL;
+
+  *shards = (CHashShards){.count = 1u << bits,
+			  .bits = bits,
+			  .tables = cmem_calloc(allocator, 1u << bits,
+						sizeof(CHash *)),
+			  .nodes = NULL,
+			  .allocator = *allocator};
+  if (shards->tables == NULL)
+    goto fail;
+
+  if (nodes != NULL) {
+    shards->nodes = cmem_alloc(allocator, shards->count * sizeof(int));
+    if (shards->nodes == NULL)
+      goto fail;
+    for (unsigned int i = 0; i < shards->count; i++)
+      shards->nodes[i] = nodes[i % count];
+    if (options.engine == CHASH_ENGINE_CHAIN && !options.intrusive
+	&& options.poolsize == 0)
+      options.poolsize = CHASH_SHARD_POOLSIZE;
+  }
+
+  int per = (size + shards->count - 1) / shards->count;
+  options.capacity = options.capacity / shards->count
+    + (options.capacity % shards->count != 0);
+  for (unsigned int i = 0; i < shards->count; i++) {
+    CHashAllocator numa;
+    if (shards->nodes != NULL) {
+      numa = chash_numa_allocator(shards->nodes[i]);
+      options.allocator = &numa;
+    }
+
+    shards->tables[i] = chash_init_opts(per, hash, match, destroy, &options);
+    if (shards->tables[i] == NULL)
+      goto fail;
+  }
+  return shards;
+
+ fail:
+  chash_shards_destroy(shards);
+  return NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_index
+ *
+ * DESCRIPTION:	    Returns the shard data belongs to.
+ *
+ * ARGUMENTS:	    shards: (CHashShards *) -- the sharded table.
+ *		    data: (const void *) -- the data in question.
+ *
+ * RETURN:	    unsigned int -- the index of its shard.
+ *
+ * NOTES:	    Hashes data once. The table of the shard hashes it again
+ *		    when it is inserted or looked up.
+ ***/
+unsigned int chash_shards_index(CHashShards * shards, const void * data)
+{
+  if (shards->bits == 0)
+    return 0; /* Shifting a uint64_t by 64 is undefined. */
+  return shard_mix(chash_hashof(shards->tables[0], data))
+    >> (64 - shards->bits);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_table
+ *
+ * DESCRIPTION:	    Returns the table of the shard data belongs to, on which
+ *		    every operation involving data is then done.
+ *
+ * ARGUMENTS:	    shards: (CHashShards *) -- the sharded table.
+ *		    data: (const void *) -- the data in question.
+ *
+ * RETURN:	    CHash * -- the table of its shard.
+ *
+ * NOTES:	    none.
+ ***/
+CHash * chash_shards_table(CHashShards * shards, const void * data)
+{
+  return shards->tables[chash_shards_index(shards, data)];
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_size
+ *
+ * DESCRIPTION:	    Returns the number of elements in every shard together.
+ *
+ * ARGUMENTS:	    shards: (CHashShards *) -- the sharded table.
+ *
+ * RETURN:	    size_t -- the total.
+ *
+ * NOTES:	    The sizes are read one after the other, so the total of a
+ *		    table being changed is only approximate.
+ ***/
+size_t chash_shards_size(CHashShards * shards)
+{
+  size_t size = 0;
+  for (unsigned int i = 0; i < shards->count; i++)
+    size += chash_size(shards->tables[i]);
+  return size;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_traverse
+ *
+ * DESCRIPTION:	    Calls callback() on every element of every shard.
+ *
+ * ARGUMENTS:	    shards: (CHashShards *) -- the sharded table.
+ *		    callback: (void (*)(void *)) -- the callback.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    One shard after the other, with chash_traverse.
+ ***/
+void chash_shards_traverse(CHashShards * shards, void (*callback)(void *))
+{
+  for (unsigned int i = 0; i < shards->count; i++)
+    chash_traverse(shards->tables[i], callback);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_stats
+ *
+ * DESCRIPTION:	    Fills in the statistics of every shard together.
+ *
+ * ARGUMENTS:	    shards: (CHashShards *) -- the sharded table.
+ *		    stats: (CHashStats *) -- receives the statistics.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Counts are summed, max_chain is the longest chain of any
+ *		    shard and mean_chain is weighted by the used buckets of
+ *		    each. bytes includes the sharded table itself.
+ ***/
+void chash_shards_stats(CHashShards * shards, CHashStats * stats)
+{
+  memset(stats, 0, sizeof(CHashStats));
+  for (unsigned int i = 0; i < shards->count; i++) {
+    CHashStats shard;
+    chash_stats(shards->tables[i], &shard);
+    stats_add(stats, &shard);
+  }
+
+  if (stats->used > 0)
+    stats->mean_chain /= stats->used;
+  if (stats->buckets > 0)
+    stats->load = (float)stats->size / stats->buckets;
+  stats->bytes += sizeof(CHashShards) + shards->count * sizeof(CHash *)
+    + (shards->nodes != NULL ? shards->count * sizeof(int) : 0);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_bind
+ *
+ * DESCRIPTION:	    Restricts the calling thread to the processors of the NUMA
+ *		    node of a shard.
+ *
+ * ARGUMENTS:	    shards: (CHashShards *) -- the sharded table.
+ *		    shard: (unsigned int) -- the shard.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the shard has no node, or the
+ *		    affinity could not be set.
+ *
+ * NOTES:	    The processors of a node are read from sysfs. Only does
+ *		    anything on Linux.
+ ***/
+int chash_shards_bind(CHashShards * shards, unsigned int shard)
+{
+  if (shards->nodes == NULL || shard >= shards->count)
+    return -1;
+
+#ifdef __linux__
+  cpu_set_t cpus;
+  if (node_cpus(shards->nodes[shard], &cpus))
+    return -1;
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) ? -1 : 0;
+#else
+  return -1;
+#endif
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_shards_destroy
+ *
+ * DESCRIPTION:	    Destroys every shard, and the sharded table.
+ *
+ * ARGUMENTS:	    shards: (CHashShards *) -- the sharded table.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Also frees a partly initialized sharded table.
+ ***/
+void chash_shards_destroy(CHashShards * shards)
+{
+  if (shards == NULL)
+    return;
+
+  CHashAllocator allocator = shards->allocator;
+  if (shards->tables != NULL) {
+    for (unsigned int i = 0; i < shards->count; i++) {
+      if (shards->tables[i] != NULL)
+	chash_destroy(shards->tables[i]);
+    }
+  }
+  cmem_free(&allocator, shards->tables, shards->count * sizeof(CHash *));
+  cmem_free(&allocator, shards->nodes, shards->count * sizeof(int));
+  cmem_free(&allocator, shards, sizeof(CHashShards));
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_numa_alloc
+ *
+ * DESCRIPTION:	    Allocates size bytes on a NUMA node. Suitable as the alloc
+ *		    member of a CHashAllocator.
+ *
+ * ARGUMENTS:	    ctx: (void *) -- the node, cast to a pointer.
+ *		    size: (size_t) -- number of bytes to allocate.
+ *
+ * RETURN:	    void * -- the memory, or NULL.
+ *
+ * NOTES:	    Blocks of CHASH_NUMA_MINBYTES or more are mapped and bound
+ *		    to the node with MPOL_PREFERRED. Smaller ones come from
+ *		    malloc, as does everything off Linux.
+ ***/
+void * chash_numa_alloc(void * ctx, size_t size)
+{
+#ifdef __linux__
+  if (size >= CHASH_NUMA_MINBYTES) {
+    void * ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+      return NULL;
+
+    /* A node the kernel does not know only loses the placement. */
+    uintptr_t node = (uintptr_t)ctx;
+    unsigned long mask[CHASH_NUMA_NODES / (8 * sizeof(unsigned long))] = {0};
+    if (node < CHASH_NUMA_NODES) {
+      mask[node / (8 * sizeof(unsigned long))]
+	|= 1UL << (node % (8 * sizeof(unsigned long)));
+      syscall(SYS_mbind, ptr, size, CHASH_MPOL_PREFERRED, mask,
+	      CHASH_NUMA_NODES + 1, 0);
+    }
+    return ptr;
+  }
+#endif
+  (void)ctx;
+  return malloc(size);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_numa_free
+ *
+ * DESCRIPTION:	    Frees memory from chash_numa_alloc. Suitable as the free
+ *		    member of a CHashAllocator.
+ *
+ * ARGUMENTS:	    ctx: (void *) -- the node, unused.
+ *		    ptr: (void *) -- the memory.
+ *		    size: (size_t) -- the size it was allocated with.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void chash_numa_free(void * ctx, void * ptr, size_t size)
+{
+  (void)ctx;
+#ifdef __linux__
+  if (size >= CHASH_NUMA_MINBYTES) {
+    munmap(ptr, size);
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_numa_allocator
+ *
+ * DESCRIPTION:	    Returns a CHashAllocator placing memory on a NUMA node.
+ *
+ * ARGUMENTS:	    node: (int) -- the node.
+ *
+ * RETURN:	    CHashAllocator -- the allocator.
+ *
+ * NOTES:	    The node is kept in the context pointer, so the allocator
+ *		    needs no memory of its own.
+ ***/
+CHashAllocator chash_numa_allocator(int node)
+{
+  return (CHashAllocator){.alloc = chash_numa_alloc,
+			  .free = chash_numa_free,
+			  .ctx = (void *)(uintptr_t)node};
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    shard_mix
+ *
+ * DESCRIPTION:	    Finalizes a hash before its high bits pick a shard.
+ *
+ * ARGUMENTS:	    h: (uint64_t) -- the hash of the element.
+ *
+ * RETURN:	    uint64_t -- the finalized hash.
+ *
+ * NOTES:	    The finalizer of SplitMix64. It must differ from the
+ *		    Fibonacci multiplier and from the finalizer of the open
+ *		    engine, or every element of a shard would share the high
+ *		    bits those take their bucket or control byte from.
+ ***/
+static uint64_t shard_mix(uint64_t h)
+{
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+/******************************************************************************
+ * FUNCTION:	    stats_add
+ *
+ * DESCRIPTION:	    Adds the statistics of one shard to the total.
+ *
+ * ARGUMENTS:	    total: (CHashStats *) -- the total.
+ *		    shard: (const CHashStats *) -- the statistics of the shard.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    total->mean_chain accumulates the sum of the chain lengths,
+ *		    to be divided by the caller.
+ ***/
+static void stats_add(CHashStats * total, const CHashStats * shard)
+{
+  total->size += shard->size;
+  total->buckets += shard->buckets;
+  total->used += shard->used;
+  total->empty += shard->empty;
+  total->deleted += shard->deleted;
+  if (shard->max_chain > total->max_chain)
+    total->max_chain = shard->max_chain;
+  total->mean_chain += shard->mean_chain * shard->used;
+  for (int i = 0; i < CHASH_STATS_HISTOGRAM; i++)
+    total->histogram[i] += shard->histogram[i];
+  total->bytes += shard->bytes;
+  total->rehashing |= shard->rehashing;
+
+  total->lookups += shard->lookups;
+  total->hits += shard->hits;
+  total->misses += shard->misses;
+  total->probes += shard->probes;
+  total->inserts += shard->inserts;
+  total->removes += shard->removes;
+  total->evictions += shard->evictions;
+  total->expired += shard->expired;
+}
+
+#ifdef __linux__
+/******************************************************************************
+ * FUNCTION:	    node_cpus
+ *
+ * DESCRIPTION:	    Reads the processors of a NUMA node.
+ *
+ * ARGUMENTS:	    node: (int) -- the node.
+ *		    cpus: (cpu_set_t *) -- receives its processors.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the node has no processors or
+ *		    its list could not be read.
+ *
+ * NOTES:	    The list holds ranges such as "0-3,8-11".
+ ***/
+static int node_cpus(int node, cpu_set_t * cpus)
+{
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+	   node);
+  FILE * file = fopen(path, "r");
+  if (file == NULL)
+    return -1;
+
+  CPU_ZERO(cpus);
+  unsigned int first, last;
+  int count = 0;
+  while (fscanf(file, "%u", &first) == 1) {
+    last = first;
+    int separator = fgetc(file);
+    if (separator == '-') {
+      if (fscanf(file, "%u", &last) != 1)
+	break;
+      separator = fgetc(file);
+    }
+    for (unsigned int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+      CPU_SET(cpu, cpus);
+      count++;
+    }
+    if (separator != ',')
+      break;
+  }
+  fclose(file);
+  return count > 0 ? 0 : -1;
+}
+#endif
+
+/*****************************************************************************/
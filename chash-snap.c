@@ -0,0 +1,514 @@
+/******************************************************************************
+ * NAME:	    chash-snap.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the copy-on-write snapshots of tables
+ *		    created with CHashOpts.snapshots.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-bitmap.h"
+#include "chash-defer.h"
+#include "chash-internal.h"
+#include "chash-lock.h"
+#include "chash-snap.h"
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static int is_saved(const uint64_t *, unsigned int);
+static CHashElmt * copy_chain(CHash *, CHashElmt *, int *);
+static void free_chain(CHash *, CHashElmt *);
+static void drop(CHash *, CHashElmt *);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    csnap_init
+ *
+ * DESCRIPTION:	    Readies a table for snapshots.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with tbl->allocator set.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    none.
+ ***/
+int csnap_init(CHash * tbl)
+{
+  CHashSnapshots * snaps = cmem_alloc(&(tbl->allocator),
+				      sizeof(CHashSnapshots));
+  if (snaps == NULL)
+    return -1;
+
+  pthread_mutex_init(&(snaps->lock), NULL);
+  snaps->live = NULL;
+  snaps->gen = 0;
+  snaps->held = NULL;
+  tbl->snapshots = snaps;
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    csnap_destroy
+ *
+ * DESCRIPTION:	    Frees the snapshot state of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with no live snapshot.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Held elements are only left over if the last snapshot was
+ *		    released while their removal was under way.
+ ***/
+void csnap_destroy(CHash * tbl)
+{
+  CHashSnapshots * snaps = tbl->snapshots;
+  if (snaps == NULL)
+    return;
+
+  while (snaps->held != NULL) {
+    CHashElmt * next = snaps->held->next;
+    drop(tbl, snaps->held);
+    snaps->held = next;
+  }
+  pthread_mutex_destroy(&(snaps->lock));
+  cmem_free(&(tbl->allocator), snaps, sizeof(CHashSnapshots));
+  tbl->snapshots = NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    csnap_save
+ *
+ * DESCRIPTION:	    Copies the buckets a hash falls in into every live
+ *		    snapshot which has not saved them yet.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with the stripe of hash held
+ *			for writing.
+ *		    hash: (uint64_t) -- the hash whose buckets are about to
+ *			change.
+ *
+ * RETURN:	    int -- 0 on success, -1 if a copy could not be allocated.
+ *
+ * NOTES:	    Saves the bucket of both arrays during a rehash, since the
+ *		    caller may change either. A bucket saved for some of the
+ *		    snapshots before running out of memory stays saved, which
+ *		    is harmless as long as the caller then changes nothing.
+ ***/
+int csnap_save(CHash * tbl, uint64_t hash)
+{
+  for (CHashSnapshot * snap = tbl->snapshots->live; snap != NULL;
+       snap = snap->next) {
+    for (int k = 0; k < 2; k++) {
+      if (snap->arrays[k] == NULL)
+	continue;
+
+      unsigned int bucket = chash_indexof(tbl, hash, snap->buckets[k]);
+      uint64_t * bits = cbits_of(snap->saved[k], snap->buckets[k]);
+      if (is_saved(bits, bucket))
+	continue;
+
+      int failed = 0;
+      CHashElmt * copy = copy_chain(tbl, snap->arrays[k][bucket], &failed);
+      if (failed)
+	return -1;
+      snap->saved[k][bucket] = copy;
+      cbits_set(tbl, bits, bucket);
+    }
+  }
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    csnap_hold
+ *
+ * DESCRIPTION:	    Keeps an element removed from the table from being
+ *		    destroyed while a snapshot may still read it.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with no stripe held.
+ *		    elmt: (CHashElmt *) -- the element, unlinked.
+ *
+ * RETURN:	    int -- 1 if the element is held, 0 if no snapshot is live
+ *		    and the caller should destroy it.
+ *
+ * NOTES:	    Snapshots taken since the element was unlinked cannot read
+ *		    it, but stamping it with the newest one only holds it a
+ *		    little longer than needed.
+ ***/
+int csnap_hold(CHash * tbl, CHashElmt * elmt)
+{
+  CHashSnapshots * snaps = tbl->snapshots;
+  if (snaps == NULL)
+    return 0;
+
+  pthread_mutex_lock(&(snaps->lock));
+  int held = snaps->live != NULL;
+  if (held) {
+    elmt->hash = snaps->live->gen; /* No longer needed for anything else. */
+    elmt->next = snaps->held;
+    snaps->held = elmt;
+  }
+  pthread_mutex_unlock(&(snaps->lock));
+  return held;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_snapshot
+ *
+ * DESCRIPTION:	    Takes a point-in-time view of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    CHashSnapshot * -- the snapshot, or NULL if the table was
+ *		    not created with snapshots or on error.
+ *
+ * NOTES:	    Holds every stripe only to join the list of live
+ *		    snapshots. The saved arrays are allocated before, for the
+ *		    sizes of the bucket arrays at the time, and again if a
+ *		    resize replaced them in the meantime.
+ ***/
+CHashSnapshot * chash_snapshot(CHash * tbl)
+{
+  CHashSnapshots * snaps = tbl->snapshots;
+  if (snaps == NULL)
+    return NULL;
+
+  CHashSnapshot * snap = cmem_alloc(&(tbl->allocator),
+				    sizeof(CHashSnapshot));
+  if (snap == NULL)
+    return NULL;
+
+  for (;;) {
+    unsigned int buckets[2] = {
+      __atomic_load_n(&(tbl->buckets), __ATOMIC_RELAXED),
+      __atomic_load_n(&(tbl->oldbuckets), __ATOMIC_RELAXED)
+    };
+    for (int k = 0; k < 2; k++) {
+      snap->buckets[k] = buckets[k];
+      snap->saved[k] = buckets[k] == 0 ? NULL
+	: cmem_calloc(&(tbl->allocator), 1, cbits_table_bytes(buckets[k]));
+    }
+    if ((buckets[0] != 0 && snap->saved[0] == NULL)
+	|| (buckets[1] != 0 && snap->saved[1] == NULL)) {
+      for (int k = 0; k < 2; k++) {
+	if (snap->saved[k] != NULL)
+	  cmem_free(&(tbl->allocator), snap->saved[k],
+		    cbits_table_bytes(buckets[k]));
+      }
+      cmem_free(&(tbl->allocator), snap, sizeof(CHashSnapshot));
+      return NULL;
+    }
+
+    cstripe_write_all(tbl);
+    if (tbl->buckets == buckets[0] && tbl->oldbuckets == buckets[1])
+      break;
+    cstripe_unlock_all(tbl);
+    for (int k = 0; k < 2; k++) {
+      if (snap->saved[k] != NULL)
+	cmem_free(&(tbl->allocator), snap->saved[k],
+		  cbits_table_bytes(buckets[k]));
+    }
+  }
+
+  snap->table = tbl;
+  snap->size = chash_size(tbl);
+  snap->arrays[0] = tbl->table;
+  snap->arrays[1] = tbl->oldtable;
+  pthread_mutex_lock(&(snaps->lock));
+  snap->gen = ++snaps->gen;
+  snap->next = snaps->live;
+  snaps->live = snap;
+  pthread_mutex_unlock(&(snaps->lock));
+  cstripe_unlock_all(tbl);
+  return snap;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_snapshot_size
+ *
+ * DESCRIPTION:	    Returns the number of elements the table held when the
+ *		    snapshot was taken.
+ *
+ * ARGUMENTS:	    snap: (const CHashSnapshot *) -- the snapshot.
+ *
+ * RETURN:	    unsigned int -- the size.
+ *
+ * NOTES:	    none.
+ ***/
+unsigned int chash_snapshot_size(const CHashSnapshot * snap)
+{
+  return snap->size;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_snapshot_lookup
+ *
+ * DESCRIPTION:	    Queries a snapshot for *data.
+ *
+ * ARGUMENTS:	    snap: (CHashSnapshot *) -- the snapshot.
+ *		    data: (void **) -- the data in question. Receives the data
+ *			found.
+ *
+ * RETURN:	    int -- 1 if the table contained the data when the snapshot
+ *		    was taken, 0 otherwise.
+ *
+ * NOTES:	    Takes the stripe of the data for reading, as chash_lookup.
+ ***/
+int chash_snapshot_lookup(CHashSnapshot * snap, void ** data)
+{
+  if (*data == NULL)
+    return 0;
+
+  CHash * tbl = snap->table;
+  uint64_t hash = chash_hashof(tbl, *data);
+  CHashKey key = {NULL, 0};
+  unsigned int stripe = cstripe_of_hash(tbl, hash);
+  int found = 0;
+  cstripe_read(tbl, stripe);
+  for (int k = 0; !found && k < 2; k++) {
+    if (snap->arrays[k] == NULL)
+      continue;
+
+    unsigned int bucket = chash_indexof(tbl, hash, snap->buckets[k]);
+    CHashElmt * elmt = is_saved(cbits_of(snap->saved[k], snap->buckets[k]),
+				bucket)
+      ? snap->saved[k][bucket] : snap->arrays[k][bucket];
+    for (; elmt != NULL; elmt = elmt->next) {
+      if (chash_matches(tbl, &key, *data, hash, elmt)) {
+	*data = elmt->data;
+	found = 1;
+	break;
+      }
+    }
+  }
+  cstripe_unlock(tbl, stripe);
+  return found;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_snapshot_traverse
+ *
+ * DESCRIPTION:	    Invokes callback on every element the table held when the
+ *		    snapshot was taken.
+ *
+ * ARGUMENTS:	    snap: (CHashSnapshot *) -- the snapshot.
+ *		    callback: (void (*)(void *)) -- the callback function.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Visits the table one stripe at a time, like chash_traverse:
+ *		    first the buckets nobody has changed, then the saved ones.
+ ***/
+void chash_snapshot_traverse(CHashSnapshot * snap, void (*callback)(void *))
+{
+  CHash * tbl = snap->table;
+  for (unsigned int s = 0; s < tbl->stripes; s++) {
+    cstripe_read(tbl, s);
+    for (int k = 0; k < 2; k++) {
+      if (snap->arrays[k] == NULL)
+	continue;
+
+      unsigned int buckets = snap->buckets[k];
+      const uint64_t * live = cbits_of(snap->arrays[k], buckets);
+      const uint64_t * saved = cbits_of(snap->saved[k], buckets);
+      for (unsigned int i = cbits_first(tbl, live, buckets, s); i < buckets;
+	   i = cbits_next(tbl, live, buckets, i)) {
+	if (is_saved(saved, i))
+	  continue;
+	for (CHashElmt * elmt = snap->arrays[k][i]; elmt != NULL;
+	     elmt = elmt->next)
+	  callback(elmt->data);
+      }
+      for (unsigned int i = cbits_first(tbl, saved, buckets, s); i < buckets;
+	   i = cbits_next(tbl, saved, buckets, i)) {
+	for (CHashElmt * elmt = snap->saved[k][i]; elmt != NULL;
+	     elmt = elmt->next)
+	  callback(elmt->data);
+      }
+    }
+    cstripe_unlock(tbl, s);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_snapshot_release
+ *
+ * DESCRIPTION:	    Frees a snapshot, and destroys the removed elements only
+ *		    it could still read.
+ *
+ * ARGUMENTS:	    snap: (CHashSnapshot *) -- the snapshot.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Holds every stripe only to leave the list of live
+ *		    snapshots. The copies are freed and the held elements
+ *		    destroyed after releasing them. A resize the table put off
+ *		    starts with the next insertion or removal.
+ ***/
+void chash_snapshot_release(CHashSnapshot * snap)
+{
+  CHash * tbl = snap->table;
+  CHashSnapshots * snaps = tbl->snapshots;
+
+  cstripe_write_all(tbl);
+  pthread_mutex_lock(&(snaps->lock));
+  CHashSnapshot ** link = &(snaps->live);
+  while (*link != snap)
+    link = &((*link)->next);
+  *link = snap->next;
+
+  unsigned long oldest = ULONG_MAX;
+  for (CHashSnapshot * live = snaps->live; live != NULL; live = live->next)
+    oldest = live->gen;
+
+  CHashElmt * ready = NULL;
+  for (CHashElmt ** held = &(snaps->held); *held != NULL;) {
+    CHashElmt * elmt = *held;
+    if (elmt->hash < oldest) {
+      *held = elmt->next;
+      elmt->next = ready;
+      ready = elmt;
+    } else {
+      held = &(elmt->next);
+    }
+  }
+  pthread_mutex_unlock(&(snaps->lock));
+  cstripe_unlock_all(tbl);
+
+  for (int k = 0; k < 2; k++) {
+    if (snap->saved[k] == NULL)
+      continue;
+
+    unsigned int buckets = snap->buckets[k];
+    const uint64_t * bits = cbits_of(snap->saved[k], buckets);
+    for (unsigned int i = cbits_scan(bits, 0, buckets); i < buckets;
+	 i = cbits_scan(bits, i + 1, buckets))
+      free_chain(tbl, snap->saved[k][i]);
+    cmem_free(&(tbl->allocator), snap->saved[k], cbits_table_bytes(buckets));
+  }
+  cmem_free(&(tbl->allocator), snap, sizeof(CHashSnapshot));
+
+  while (ready != NULL) {
+    CHashElmt * next = ready->next;
+    drop(tbl, ready);
+    ready = next;
+  }
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    is_saved
+ *
+ * DESCRIPTION:	    Tests the bit of a bucket in the bitmap of a saved array.
+ *
+ * ARGUMENTS:	    bits: (const uint64_t *) -- the bitmap.
+ *		    bucket: (unsigned int) -- the bucket.
+ *
+ * RETURN:	    int -- 1 if the bucket was saved, 0 otherwise.
+ *
+ * NOTES:	    Loaded atomically, like the bitmaps of bucket arrays.
+ ***/
+static int is_saved(const uint64_t * bits, unsigned int bucket)
+{
+  return (__atomic_load_n(&(bits[bucket / 64]), __ATOMIC_RELAXED)
+	  >> (bucket % 64)) & 1;
+}
+
+/******************************************************************************
+ * FUNCTION:	    copy_chain
+ *
+ * DESCRIPTION:	    Copies the elements of a chain, in order.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    elmt: (CHashElmt *) -- the head of the chain, or NULL.
+ *		    failed: (int *) -- set to 1 if out of memory.
+ *
+ * RETURN:	    CHashElmt * -- the head of the copy.
+ *
+ * NOTES:	    The copies come from the node pool of the table, if it has
+ *		    one, and carry everything but the link: the hash, the data
+ *		    and the inline key, if any.
+ ***/
+static CHashElmt * copy_chain(CHash * tbl, CHashElmt * elmt, int * failed)
+{
+  CHashElmt * head = NULL, ** tail = &head;
+  for (; elmt != NULL; elmt = elmt->next) {
+    CHashElmt * copy = cmem_node_alloc(tbl);
+    if (copy == NULL) {
+      free_chain(tbl, head);
+      *failed = 1;
+      return NULL;
+    }
+    memcpy(copy, elmt, chash_elmtsize(tbl));
+    copy->next = NULL;
+    *tail = copy;
+    tail = &(copy->next);
+  }
+  return head;
+}
+
+/******************************************************************************
+ * FUNCTION:	    free_chain
+ *
+ * DESCRIPTION:	    Frees the copies of a chain.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    elmt: (CHashElmt *) -- the head of the copy, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The data belongs to the elements copied.
+ ***/
+static void free_chain(CHash * tbl, CHashElmt * elmt)
+{
+  while (elmt != NULL) {
+    CHashElmt * next = elmt->next;
+    cmem_node_free(tbl, elmt);
+    elmt = next;
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    drop
+ *
+ * DESCRIPTION:	    Destroys a held element, with its data.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with no stripe held.
+ *		    elmt: (CHashElmt *) -- the element.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Deferred tables queue the element instead.
+ ***/
+static void drop(CHash * tbl, CHashElmt * elmt)
+{
+  if (tbl->deferred != NULL) {
+    cdefer_push(tbl, elmt);
+    return;
+  }
+
+  chash_drop_data(tbl, elmt->data);
+  cmem_elmt_put(tbl, elmt);
+}
+
+/*****************************************************************************/
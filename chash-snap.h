@@ -0,0 +1,104 @@
+/******************************************************************************
+ * NAME:	    chash-snap.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the copy-on-write snapshots of
+ *		    tables created with CHashOpts.snapshots.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Copy-on-write snapshots for the chained engine
+ *
+ * Taking a snapshot copies nothing: it records the bucket arrays and the
+ * size of the table, and joins the list of live snapshots. From then on,
+ * the first writer to change a bucket copies its chain into the saved array
+ * of every live snapshot that has not saved it yet, while holding the
+ * bucket's stripe, before changing anything. A snapshot reads the buckets it
+ * saved from its own copies, and the others from the table, where they are
+ * still as they were. The saved arrays have the layout of bucket arrays, so
+ * their bitmaps tell which buckets were saved.
+ *
+ * The bucket arrays cannot be replaced while a snapshot is live, so resizing
+ * waits until the last one is released. An element removed while snapshots
+ * are live may still be read through one of them, so it is held rather than
+ * destroyed, stamped with the newest snapshot at the time in place of its
+ * hash. Releasing a snapshot destroys the held elements which no older
+ * snapshot is left to read.
+ *
+ * The list of live snapshots only changes with every stripe held, so a
+ * writer reads it under its own stripe. The held elements have a mutex.
+ */
+
+#ifndef __ET_CHASH_SNAP_H__
+#define __ET_CHASH_SNAP_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <pthread.h>
+
+#include "chain-hash.h"
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+struct _CHashSnapshot_ {
+
+  CHash * table;
+  struct _CHashSnapshot_ * next; /* The next older live snapshot. */
+  unsigned long gen;
+  unsigned int size;
+  CHashElmt ** arrays[2]; /* tbl->table and tbl->oldtable, when taken. */
+  unsigned int buckets[2];
+  CHashElmt ** saved[2]; /* The buckets changed since, as they were. */
+
+};
+
+struct _CHashSnapshots_ {
+
+  pthread_mutex_t lock; /* Guards held, and live along with the stripes. */
+  CHashSnapshot * live; /* Newest first. */
+  unsigned long gen;
+  CHashElmt * held;
+
+};
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int csnap_init(CHash * table);
+extern void csnap_destroy(CHash * table);
+extern int csnap_save(CHash * table, uint64_t hash);
+extern int csnap_hold(CHash * table, CHashElmt * elmt);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* Whether any snapshot of the table is live. Read with a stripe held. */
+static inline int csnap_live(const CHash * tbl)
+{
+  return tbl->snapshots != NULL && tbl->snapshots->live != NULL;
+}
+
+/*
+ * Saves the buckets hash falls in for the live snapshots, before a writer
+ * holding their stripe changes one of them. Returns -1 if out of memory, in
+ * which case nothing may be changed.
+ */
+static inline int csnap_write(CHash * tbl, uint64_t hash)
+{
+  return csnap_live(tbl) ? csnap_save(tbl, hash) : 0;
+}
+
+#endif /* __ET_CHASH_SNAP_H__ */
+
+/*****************************************************************************/
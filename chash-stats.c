@@ -0,0 +1,241 @@
+/******************************************************************************
+ * NAME:	    chash-stats.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for chash_stats, which reports the shape,
+ *		    memory footprint and operation counters of a table.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <string.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-bitmap.h"
+#include "chash-clock.h"
+#include "chash-filter.h"
+#include "chash-image.h"
+#include "chash-lock.h"
+#include "chash-stats.h"
+#include "chash-timer.h"
+#include "open-hash.h"
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void count_chains(CHash *, CHashStats *, CHashElmt **, unsigned int,
+			 unsigned int, unsigned long *);
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    chash_stats
+ *
+ * DESCRIPTION:	    Fills in stats for the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    stats: (CHashStats *) -- receives the statistics.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The chains are walked one stripe at a time, like
+ *		    chash_traverse.
+ ***/
+void chash_stats(CHash * tbl, CHashStats * stats)
+{
+  memset(stats, 0, sizeof(CHashStats));
+  stats->size = chash_size(tbl);
+  stats->rehashing = chash_isrehashing(tbl);
+  stats->bytes = sizeof(CHash);
+
+  if (tbl->engine == CHASH_ENGINE_OPEN) {
+    ohash_stats(tbl, stats);
+    stats->bytes += tbl->buckets + tbl->buckets * sizeof(void *)
+      * (tbl->values != NULL ? 2 : 1);
+  } else if (tbl->engine == CHASH_ENGINE_IMAGE) {
+    cimage_stats(tbl, stats);
+    stats->bytes += tbl->imagebytes;
+  } else {
+    unsigned long total = 0;
+    for (unsigned int s = 0; s < tbl->stripes; s++) {
+      cstripe_read(tbl, s);
+      if (tbl->oldtable != NULL)
+	count_chains(tbl, stats, tbl->oldtable, tbl->oldbuckets, s, &total);
+      count_chains(tbl, stats, tbl->table, tbl->buckets, s, &total);
+      cstripe_unlock(tbl, s);
+    }
+
+    if (stats->used > 0)
+      stats->mean_chain = (float)total / stats->used;
+    stats->bytes += cbits_table_bytes(tbl->buckets) + cmem_node_bytes(tbl);
+    if (tbl->oldtable != NULL)
+      stats->bytes += cbits_table_bytes(tbl->oldbuckets);
+    if (tbl->filter != NULL)
+      stats->bytes += tbl->filter->bytes;
+    if (tbl->clock != NULL)
+      stats->bytes += tbl->stripes * sizeof(CHashClock);
+    if (tbl->wheels != NULL)
+      stats->bytes += tbl->stripes * sizeof(CHashWheel);
+  }
+
+  if (stats->buckets > 0)
+    stats->load = (float)stats->size / stats->buckets;
+  if (tbl->locks != NULL)
+    stats->bytes += sizeof(CHashLocks) + tbl->stripes * sizeof(CHashStripe)
+      + (tbl->locks->epoch != NULL ? sizeof(CHashEpoch) : 0);
+
+  if (tbl->counters != NULL) {
+    unsigned int blocks = tbl->locks != NULL ? CHASH_STATS_SLOTS : 1;
+    stats->bytes += blocks * sizeof(CHashCounters);
+    for (unsigned int i = 0; i < blocks; i++) {
+      CHashCounters * counters = &(tbl->counters[i]);
+      stats->lookups += __atomic_load_n(&(counters->lookups),
+					__ATOMIC_RELAXED);
+      stats->hits += __atomic_load_n(&(counters->hits), __ATOMIC_RELAXED);
+      stats->probes += __atomic_load_n(&(counters->probes), __ATOMIC_RELAXED);
+      stats->inserts += __atomic_load_n(&(counters->inserts),
+					__ATOMIC_RELAXED);
+      stats->removes += __atomic_load_n(&(counters->removes),
+					__ATOMIC_RELAXED);
+      stats->evictions += __atomic_load_n(&(counters->evictions),
+					  __ATOMIC_RELAXED);
+      stats->expired += __atomic_load_n(&(counters->expired),
+					__ATOMIC_RELAXED);
+    }
+    stats->misses = stats->lookups - stats->hits;
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_stats_reset
+ *
+ * DESCRIPTION:	    Zeroes the operation counters of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Operations running concurrently may or may not be counted.
+ ***/
+void chash_stats_reset(CHash * tbl)
+{
+  if (tbl->counters == NULL)
+    return;
+
+  unsigned int blocks = tbl->locks != NULL ? CHASH_STATS_SLOTS : 1;
+  for (unsigned int i = 0; i < blocks; i++) {
+    CHashCounters * counters = &(tbl->counters[i]);
+    __atomic_store_n(&(counters->lookups), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->hits), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->probes), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->inserts), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->removes), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->evictions), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->expired), 0, __ATOMIC_RELAXED);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    cstats_init
+ *
+ * DESCRIPTION:	    Allocates the counter blocks of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with tbl->allocator set.
+ *		    blocks: (unsigned int) -- 1, or CHASH_STATS_SLOTS for a
+ *			concurrent table.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    Leaves tbl->counters NULL unless CONFIG_CHASH_STATS is set.
+ ***/
+int cstats_init(CHash * tbl, unsigned int blocks)
+{
+  tbl->counters = NULL;
+#ifdef CONFIG_CHASH_STATS
+  tbl->counters = cmem_calloc(&(tbl->allocator), blocks,
+			      sizeof(CHashCounters));
+  if (tbl->counters == NULL)
+    return -1;
+#else
+  (void)blocks;
+#endif
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    cstats_destroy
+ *
+ * DESCRIPTION:	    Frees the counter blocks of a table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    blocks: (unsigned int) -- as passed to cstats_init.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void cstats_destroy(CHash * tbl, unsigned int blocks)
+{
+  if (tbl->counters != NULL)
+    cmem_free(&(tbl->allocator), tbl->counters,
+	      blocks * sizeof(CHashCounters));
+  tbl->counters = NULL;
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    count_chains
+ *
+ * DESCRIPTION:	    Adds the buckets of one stripe of a bucket array to stats.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    stats: (CHashStats *) -- the statistics.
+ *		    table: (CHashElmt **) -- the bucket array.
+ *		    buckets: (unsigned int) -- its size.
+ *		    stripe: (unsigned int) -- the stripe, held by the caller.
+ *		    total: (unsigned long *) -- the sum of the chain lengths.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void count_chains(CHash * tbl, CHashStats * stats, CHashElmt ** table,
+			 unsigned int buckets, unsigned int stripe,
+			 unsigned long * total)
+{
+  for (unsigned int i = cstripe_first(tbl, stripe, buckets); i < buckets;
+       i = cstripe_next(tbl, i, buckets)) {
+    unsigned int length = 0;
+    for (CHashElmt * elmt = table[i]; elmt != NULL; elmt = elmt->next)
+      length++;
+
+    stats->buckets++;
+    stats->histogram[length < CHASH_STATS_HISTOGRAM
+		     ? length : CHASH_STATS_HISTOGRAM - 1]++;
+    if (length == 0) {
+      stats->empty++;
+      continue;
+    }
+
+    stats->used++;
+    *total += length;
+    if (length > stats->max_chain)
+      stats->max_chain = length;
+  }
+}
+
+/*****************************************************************************/
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * NAME:	    chash-stats.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the operation counters reported by
+ *		    chash_stats. The counters are only compiled in when
+ *		    CONFIG_CHASH_STATS is defined.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_CHASH_STATS_H__
+#define __ET_CHASH_STATS_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include "chain-hash.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Counter blocks of a concurrent table. Threads beyond this share blocks. */
+#define CHASH_STATS_SLOTS 16
+
+/*
+ * Adds N to one counter of the calling thread's block. The block is only
+ * shared by threads whose slots collide, so a plain load and store is used
+ * instead of an atomic add; an increment may be lost when they do.
+ */
+#ifdef CONFIG_CHASH_STATS
+#define cstats_count(Table, Field, N) do {				\
+    CHashCounters * counters_ = cstats_block(Table);			\
+    if (counters_ != NULL)						\
+      __atomic_store_n(&(counters_->Field),				\
+		       __atomic_load_n(&(counters_->Field), __ATOMIC_RELAXED) \
+		       + (N), __ATOMIC_RELAXED);			\
+  } while (0)
+#else
+#define cstats_count(Table, Field, N) ((void)(N))
+#endif
+
+/* Counts one lookup, and whether it hit. */
+#define cstats_lookup(Table, Found) do {				\
+    cstats_count(Table, lookups, 1);					\
+    if (Found)								\
+      cstats_count(Table, hits, 1);					\
+  } while (0)
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One thread's counters, padded to a cache line. */
+union _CHashCounters_ {
+
+  struct {
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long probes;
+    unsigned long inserts;
+    unsigned long removes;
+    unsigned long evictions;
+    unsigned long expired;
+  };
+  char pad[64];
+
+};
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int cstats_init(CHash * table, unsigned int blocks);
+extern void cstats_destroy(CHash * table, unsigned int blocks);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* The calling thread's counter block, or NULL if the table has none. */
+static inline CHashCounters * cstats_block(CHash * tbl)
+{
+  if (tbl->counters == NULL)
+    return NULL;
+  if (tbl->locks == NULL)
+    return tbl->counters;
+  return &(tbl->counters[cstripe_thread_slot() % CHASH_STATS_SLOTS]);
+}
+
+#endif /* __ET_CHASH_STATS_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,210 @@
+/******************************************************************************
+ * NAME:	    chash-timer.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the timer wheels of expiring tables.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+#include <time.h>
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-timer.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Bits of a time selecting the slot of a level. */
+#define CTIMER_BITS 6
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    ctimer_init
+ *
+ * DESCRIPTION:	    Allocates an empty wheel for every stripe of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with its stripes set up.
+ *
+ * RETURN:	    int -- 0 on success, -1 on error.
+ *
+ * NOTES:	    The wheels start at the current time of the table.
+ ***/
+int ctimer_init(CHash * tbl)
+{
+  CHashWheel * wheels = cmem_calloc(&(tbl->allocator), tbl->stripes,
+				    sizeof(CHashWheel));
+  if (wheels == NULL)
+    return -1;
+
+  uint64_t now = tbl->now != NULL ? tbl->now() : ctimer_clock();
+  for (unsigned int i = 0; i < tbl->stripes; i++)
+    wheels[i].now = now;
+  tbl->wheels = wheels;
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctimer_destroy
+ *
+ * DESCRIPTION:	    Frees the wheels of the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The elements are freed with the chains they are on.
+ ***/
+void ctimer_destroy(CHash * tbl)
+{
+  if (tbl->wheels != NULL)
+    cmem_free(&(tbl->allocator), tbl->wheels,
+	      tbl->stripes * sizeof(CHashWheel));
+  tbl->wheels = NULL;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctimer_clock
+ *
+ * DESCRIPTION:	    Reads the monotonic clock.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    uint64_t -- the time, in milliseconds.
+ *
+ * NOTES:	    The clock of tables created without a now function.
+ ***/
+uint64_t ctimer_clock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctimer_add
+ *
+ * DESCRIPTION:	    Links an element with a deadline on a wheel.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with the stripe of the wheel
+ *			held for writing.
+ *		    wheel: (CHashWheel *) -- the wheel of the element's stripe.
+ *		    elmt: (CHashElmt *) -- the element, on no wheel.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    A deadline already past goes in the next slot to come due.
+ *		    One more than a lap of the top level away goes in the last
+ *		    slot of it to come due, and is placed again from there.
+ ***/
+void ctimer_add(CHash * tbl, CHashWheel * wheel, CHashElmt * elmt)
+{
+  CHashTimerLink * link = chash_timerof(tbl, elmt);
+  uint64_t deadline = link->deadline > wheel->now
+    ? link->deadline : wheel->now + 1;
+
+  unsigned int level = (63 - __builtin_clzll(deadline ^ wheel->now))
+    / CTIMER_BITS;
+  if (level >= CHASH_WHEEL_LEVELS)
+    level = CHASH_WHEEL_LEVELS - 1;
+
+  /* Only the top level can be more than a lap of its slots away. */
+  unsigned int shift = level * CTIMER_BITS;
+  unsigned int slot = (deadline >> shift) % CTIMER_SLOTS;
+  if ((deadline >> shift) - (wheel->now >> shift) >= CTIMER_SLOTS)
+    slot = ((wheel->now >> shift) - 1) % CTIMER_SLOTS;
+
+  CHashElmt ** head = &(wheel->slots[level][slot]);
+  link->next = *head;
+  if (link->next != NULL)
+    chash_timerof(tbl, link->next)->pprev = &(link->next);
+  link->pprev = head;
+  *head = elmt;
+  wheel->pending[level] |= 1ULL << slot;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctimer_advance
+ *
+ * DESCRIPTION:	    Moves a wheel forward to now, and takes the elements whose
+ *		    deadline has passed off it.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table, with the stripe of the wheel
+ *			held for writing.
+ *		    wheel: (CHashWheel *) -- the wheel.
+ *		    now: (uint64_t) -- the time to move to.
+ *
+ * RETURN:	    CHashElmt * -- the expired elements, linked through the
+ *		    next member of their timer links, or NULL. They are still
+ *		    in their chains.
+ *
+ * NOTES:	    On each level, the slots due between the old and the new
+ *		    time are found in the pending mask, as a range of bits
+ *		    starting after the slot of the old time: all of them, once
+ *		    64 or more have come due. Every element of those slots is
+ *		    either expired or placed again, nearer its deadline.
+ ***/
+CHashElmt * ctimer_advance(CHash * tbl, CHashWheel * wheel, uint64_t now)
+{
+  if (now <= wheel->now)
+    return NULL;
+
+  CHashElmt * due = NULL;
+  for (unsigned int level = 0; level < CHASH_WHEEL_LEVELS; level++) {
+    unsigned int shift = level * CTIMER_BITS;
+    uint64_t elapsed = (now >> shift) - (wheel->now >> shift);
+    if (elapsed == 0)
+      break; /* Nor has any slot of a higher level come due. */
+
+    uint64_t mask = ~0ULL;
+    if (elapsed < CTIMER_SLOTS) {
+      unsigned int first = ((wheel->now >> shift) + 1) % CTIMER_SLOTS;
+      mask = (1ULL << elapsed) - 1;
+      if (first != 0)
+	mask = (mask << first) | (mask >> (CTIMER_SLOTS - first));
+    }
+
+    uint64_t slots = wheel->pending[level] & mask;
+    wheel->pending[level] &= ~slots;
+    for (; slots != 0; slots &= slots - 1) {
+      CHashElmt ** head = &(wheel->slots[level][__builtin_ctzll(slots)]);
+      for (CHashElmt * elmt = *head, * next; elmt != NULL; elmt = next) {
+	CHashTimerLink * link = chash_timerof(tbl, elmt);
+	next = link->next;
+	link->next = due;
+	link->pprev = NULL;
+	due = elmt;
+      }
+      *head = NULL;
+    }
+  }
+  wheel->now = now;
+
+  CHashElmt * expired = NULL;
+  for (CHashElmt * elmt = due, * next; elmt != NULL; elmt = next) {
+    CHashTimerLink * link = chash_timerof(tbl, elmt);
+    next = link->next;
+    if (link->deadline <= now) {
+      link->next = expired;
+      expired = elmt;
+    } else {
+      ctimer_add(tbl, wheel, elmt);
+    }
+  }
+  return expired;
+}
+
+/*****************************************************************************/
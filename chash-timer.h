@@ -0,0 +1,155 @@
+/******************************************************************************
+ * NAME:	    chash-timer.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the timer wheels of expiring
+ *		    tables.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Per-entry expiry for the chained engine
+ *
+ * Every element of an expiring table carries a CHashTimerLink holding its
+ * deadline, in milliseconds. Elements with a deadline are also linked on a
+ * hierarchical timer wheel: CHASH_WHEEL_LEVELS levels of 64 slots, where a
+ * slot of level l covers 64^l milliseconds. An element goes on the lowest
+ * level on which its deadline and the time of the wheel differ only in that
+ * level's six bits, so it lands in a slot that comes due no later than the
+ * deadline.
+ *
+ * Advancing a wheel takes every slot that came due since the last advance,
+ * on every level. Elements whose deadline has passed are expired, and the
+ * others are placed again, on a lower level unless their deadline is more
+ * than a lap of the top level away. Each slot has a bit in a per-level mask,
+ * so empty slots are never visited, and the cost is linear in the elements
+ * taken out.
+ *
+ * Like the CLOCK rings, there is one wheel per lock stripe, holding the
+ * elements of that stripe, and it only changes while the stripe is held for
+ * writing.
+ */
+
+#ifndef __ET_CHASH_TIMER_H__
+#define __ET_CHASH_TIMER_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+
+#include "chain-hash.h"
+#include "chash-internal.h"
+#include "chash-lock.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Slots per level, one for each value of six bits of a time. */
+#define CTIMER_SLOTS 64
+
+/******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+struct _CHashWheel_ {
+
+  uint64_t now; /* Every slot due at or before now has been taken. */
+  uint64_t pending[CHASH_WHEEL_LEVELS]; /* One bit per non-empty slot. */
+  CHashElmt * slots[CHASH_WHEEL_LEVELS][CTIMER_SLOTS];
+
+};
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int ctimer_init(CHash * table);
+extern void ctimer_destroy(CHash * table);
+extern uint64_t ctimer_clock(void);
+extern void ctimer_add(CHash * table, CHashWheel * wheel, CHashElmt * elmt);
+extern CHashElmt * ctimer_advance(CHash * table, CHashWheel * wheel,
+				  uint64_t now);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* The current time of the table, in milliseconds, or 0 if it never expires. */
+static inline uint64_t ctimer_now(const CHash * tbl)
+{
+  if (tbl->wheels == NULL)
+    return 0;
+  return tbl->now != NULL ? tbl->now() : ctimer_clock();
+}
+
+/* Whether an element's deadline has passed at time now. */
+static inline int ctimer_expired(const CHash * tbl, CHashElmt * elmt,
+				 uint64_t now)
+{
+  if (tbl->wheels == NULL)
+    return 0;
+
+  uint64_t deadline = chash_timerof(tbl, elmt)->deadline;
+  return deadline != 0 && deadline <= now;
+}
+
+/* Takes an element off the wheel of its stripe, if it is on it. */
+static inline void ctimer_cancel(CHash * tbl, CHashElmt * elmt)
+{
+  if (tbl->wheels == NULL)
+    return;
+
+  CHashTimerLink * link = chash_timerof(tbl, elmt);
+  if (link->pprev == NULL)
+    return;
+
+  *link->pprev = link->next;
+  if (link->next != NULL) {
+    chash_timerof(tbl, link->next)->pprev = link->pprev;
+  } else {
+    /* The last element of a slot has the slot itself as its pprev. */
+    CHashWheel * wheel = &(tbl->wheels[cstripe_of_hash(tbl, elmt->hash)]);
+    size_t slot = link->pprev - &(wheel->slots[0][0]);
+    if (slot < CHASH_WHEEL_LEVELS * CTIMER_SLOTS && *link->pprev == NULL)
+      wheel->pending[slot / CTIMER_SLOTS] &= ~(1ULL << slot % CTIMER_SLOTS);
+  }
+  link->pprev = NULL;
+}
+
+/*
+ * Gives an element of a stripe held for writing a new deadline, 0 for none,
+ * and moves it to the right slot of the wheel.
+ */
+static inline void ctimer_set(CHash * tbl, unsigned int stripe,
+			      CHashElmt * elmt, uint64_t deadline)
+{
+  if (tbl->wheels == NULL)
+    return;
+
+  ctimer_cancel(tbl, elmt);
+  chash_timerof(tbl, elmt)->deadline = deadline;
+  if (deadline != 0)
+    ctimer_add(tbl, &(tbl->wheels[stripe]), elmt);
+}
+
+/* Readies the timer links of a new element, with the default lifetime. */
+static inline void ctimer_start(CHash * tbl, unsigned int stripe,
+				CHashElmt * elmt, uint64_t now)
+{
+  if (tbl->wheels == NULL)
+    return;
+
+  chash_timerof(tbl, elmt)->pprev = NULL;
+  ctimer_set(tbl, stripe, elmt, tbl->ttl != 0 ? now + tbl->ttl : 0);
+}
+
+#endif /* __ET_CHASH_TIMER_H__ */
+
+/*****************************************************************************/
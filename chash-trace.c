@@ -0,0 +1,161 @@
+/******************************************************************************
+ * NAME:	    chash-trace.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the tracing hooks and USDT probes of traced
+ *		    tables.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef CONFIG_CHASH_USDT
+#include <sys/sdt.h>
+#endif
+
+#include "chain-hash.h"
+#include "chash-trace.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Fires the USDT probe chash:Name, if the probes are compiled in. */
+#ifdef CONFIG_CHASH_USDT
+#define ctrace_usdt(Name, Table, A, B, C)		\
+  DTRACE_PROBE4(chash, Name, Table, A, B, C)
+#else
+#define ctrace_usdt(Name, Table, A, B, C) ((void)0)
+#endif
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    ctrace_init
+ *
+ * DESCRIPTION:	    Gives a new table its hooks and thresholds.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table.
+ *		    trace: (const CHashTrace *) -- the hooks, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The table is traced if it has hooks, or if the USDT probes
+ *		    are compiled in. Thresholds of 0 take the defaults.
+ ***/
+void ctrace_init(CHash * tbl, const CHashTrace * trace)
+{
+  tbl->trace = trace != NULL ? *trace : (CHashTrace){0};
+  if (tbl->trace.longchain == 0)
+    tbl->trace.longchain = CHASH_TRACE_CHAIN;
+  if (tbl->trace.slowdestroy == 0)
+    tbl->trace.slowdestroy = CHASH_TRACE_DESTROY;
+  tbl->traced = trace != NULL || CTRACE_ALWAYS;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctrace_clock
+ *
+ * DESCRIPTION:	    Reads the monotonic clock.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    uint64_t -- the time, in nanoseconds.
+ *
+ * NOTES:	    none.
+ ***/
+uint64_t ctrace_clock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctrace_resize
+ *
+ * DESCRIPTION:	    Reports that a table started resizing.
+ *
+ * ARGUMENTS:	    tbl: (const CHash *) -- the table.
+ *		    from: (unsigned int) -- the old number of buckets or slots.
+ *		    to: (unsigned int) -- the new one.
+ *		    start: (uint64_t) -- the time the resize started, from
+ *			ctrace_start.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    A no-op for an untraced table.
+ ***/
+void ctrace_resize(const CHash * tbl, unsigned int from, unsigned int to,
+		   uint64_t start)
+{
+  if (!tbl->traced)
+    return;
+
+  uint64_t ns = ctrace_clock() - start;
+  ctrace_usdt(resize, tbl, from, to, ns);
+  if (tbl->trace.resize != NULL)
+    tbl->trace.resize(tbl->trace.ctx, tbl, from, to, ns);
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctrace_chain
+ *
+ * DESCRIPTION:	    Reports a probe which examined more than trace.longchain
+ *		    elements.
+ *
+ * ARGUMENTS:	    tbl: (const CHash *) -- the traced table.
+ *		    hash: (uint64_t) -- the hash probed for.
+ *		    probes: (unsigned int) -- the elements, or groups, examined.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Called from ctrace_probe, with the stripe of hash held.
+ ***/
+void ctrace_chain(const CHash * tbl, uint64_t hash, unsigned int probes)
+{
+  ctrace_usdt(chain, tbl, hash, probes, tbl->trace.longchain);
+  if (tbl->trace.chain != NULL)
+    tbl->trace.chain(tbl->trace.ctx, tbl, hash, probes);
+}
+
+/******************************************************************************
+ * FUNCTION:	    ctrace_destroy
+ *
+ * DESCRIPTION:	    Calls the destroy function of a traced table on data, and
+ *		    reports the call if it was slow.
+ *
+ * ARGUMENTS:	    tbl: (const CHash *) -- the traced table, with a destroy
+ *			function.
+ *		    data: (void *) -- the data to destroy.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The data has been freed by the time it is reported, so only
+ *		    its address may be used.
+ ***/
+void ctrace_destroy(const CHash * tbl, void * data)
+{
+  uint64_t start = ctrace_clock();
+  tbl->destroy(data);
+  uint64_t ns = ctrace_clock() - start;
+  if (ns <= tbl->trace.slowdestroy)
+    return;
+
+  ctrace_usdt(destroy, tbl, data, ns, tbl->trace.slowdestroy);
+  if (tbl->trace.destroy != NULL)
+    tbl->trace.destroy(tbl->trace.ctx, tbl, data, ns);
+}
+
+/*****************************************************************************/
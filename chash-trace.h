@@ -0,0 +1,85 @@
+/******************************************************************************
+ * NAME:	    chash-trace.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface for the tracing hooks of tables created
+ *		    with CHashOpts.trace, and for the USDT probes compiled in
+ *		    when CONFIG_CHASH_USDT is defined.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Latency tracing for the CHash API
+ *
+ * A traced table reports three kinds of events: resizes, probes examining
+ * more than trace.longchain elements, and calls to the destroy function
+ * taking more than trace.slowdestroy nanoseconds. They go to the hooks of its
+ * CHashTrace and, with CONFIG_CHASH_USDT, to the USDT probes chash:resize,
+ * chash:chain and chash:destroy, for perf, bpftrace or SystemTap to attach
+ * to. With the probes compiled in, every table is traced, with the default
+ * thresholds unless it was given others.
+ *
+ * An untraced table pays one test of tbl->traced at each site, and only the
+ * destroy calls of traced tables read the clock. The events themselves are
+ * reported out of line, since they are rare by construction.
+ */
+
+#ifndef __ET_CHASH_TRACE_H__
+#define __ET_CHASH_TRACE_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+
+#include "chain-hash.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Whether every table is traced, for the USDT probes. */
+#ifdef CONFIG_CHASH_USDT
+#define CTRACE_ALWAYS 1
+#else
+#define CTRACE_ALWAYS 0
+#endif
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern void ctrace_init(CHash * table, const CHashTrace * trace);
+extern uint64_t ctrace_clock(void);
+extern void ctrace_resize(const CHash * table, unsigned int from,
+			  unsigned int to, uint64_t start);
+extern void ctrace_chain(const CHash * table, uint64_t hash,
+			 unsigned int probes);
+extern void ctrace_destroy(const CHash * table, void * data);
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/* The time to pass to ctrace_resize, or 0 if the table is not traced. */
+static inline uint64_t ctrace_start(const CHash * tbl)
+{
+  return tbl->traced ? ctrace_clock() : 0;
+}
+
+/* Reports a probe for hash which examined probes elements, if it was long. */
+static inline void ctrace_probe(const CHash * tbl, uint64_t hash,
+				unsigned int probes)
+{
+  if (tbl->traced && probes > tbl->trace.longchain)
+    ctrace_chain(tbl, hash, probes);
+}
+
+#endif /* __ET_CHASH_TRACE_H__ */
+
+/*****************************************************************************/
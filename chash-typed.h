@@ -0,0 +1,277 @@
+/******************************************************************************
+ * NAME:	    chash-typed.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Header-only generator of typed hash tables, which store
+ *		    their keys and values inline and call an inlined hash and
+ *		    compare instead of function pointers.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Typed tables for the CHash API
+ *
+ * CHASH_DEFINE(name, K, V, hashfn, eqfn) expands to a table type \c name
+ * mapping keys of type \c K to values of type \c V, and to the static inline
+ * functions operating on it:
+ *
+ *   int name_init(name * table, size_t size);
+ *   void name_destroy(name * table);
+ *   V * name_get(name * table, K key);
+ *   V * name_emplace(name * table, K key, int * inserted);
+ *   int name_put(name * table, K key, V value);
+ *   int name_remove(name * table, K key, V * value);
+ *   size_t name_size(const name * table);
+ *   name_entry * name_next(const name * table, size_t * iter);
+ *
+ * \c hashfn(key) returns a uint64_t, and \c eqfn(a, b) is nonzero when two
+ * keys are equal. Either may be a function or a function-like macro, and both
+ * are expanded in place, so the compiler sees through them.
+ *
+ * The table is laid out like CHASH_ENGINE_OPEN: a power-of-two array of
+ * entries, each with a control byte holding EMPTY, DELETED or seven bits of
+ * its hash, probed linearly and never filled past 7/8. The hash is finalized
+ * with chash_typed_mix, so an identity hash is fine for integer keys. Nothing
+ * is allocated per entry, and keys and values are copied by assignment.
+ *
+ * \code
+ * CHASH_DEFINE(IntMap, int, long, CHASH_TYPED_HASH_INT, CHASH_TYPED_EQ)
+ *
+ * IntMap map;
+ * IntMap_init(&map, 16);
+ * IntMap_put(&map, 42, 7);
+ * long * value = IntMap_get(&map, 42);
+ * IntMap_destroy(&map);
+ * \endcode
+ */
+
+#ifndef __ET_CHASH_TYPED_H__
+#define __ET_CHASH_TYPED_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define CHASH_TYPED_EMPTY   0x80
+#define CHASH_TYPED_DELETED 0xfe
+
+/* Smallest capacity of a typed table. */
+#define CHASH_TYPED_MIN 16
+
+/* Unused entries may make up at most 1/8th of the table. */
+#define CHASH_TYPED_FILL(Cap) ((Cap) - (Cap) / 8)
+
+/* Hash and equality for any integer type, for use as hashfn and eqfn. */
+#define CHASH_TYPED_HASH_INT(Key) ((uint64_t)(Key))
+#define CHASH_TYPED_EQ(A, B) ((A) == (B))
+
+/**
+ * \brief Defines the typed table \c Name and its functions
+ * \param Name The name of the table type, and prefix of its functions.
+ * \param K The key type.
+ * \param V The value type.
+ * \param HashFn The hash of a key, as a uint64_t.
+ * \param EqFn The equality of two keys.
+ * \note name_get and name_emplace return a pointer into the table, which is
+ * valid until the next name_emplace or name_put. name_emplace returns the
+ * value of \c key, inserting it uninitialized first if it is not there, and
+ * sets \c *inserted accordingly. name_put returns \c 0 if it inserted the key,
+ * \c 1 if it replaced its value, and \c -1 on error. name_remove returns \c 0
+ * on success and \c -1 if the key is not there, and copies its value into
+ * \c *value unless \c value is \c NULL. name_next returns the next entry from
+ * \c *iter, which starts at \c 0, or \c NULL after the last one.
+ */
+#define CHASH_DEFINE(Name, K, V, HashFn, EqFn)				\
+									\
+  typedef struct Name##_entry {						\
+    K key;								\
+    V value;								\
+  } Name##_entry;							\
+									\
+  typedef struct Name {							\
+    unsigned char * ctrl;						\
+    Name##_entry * entries;						\
+    size_t size;							\
+    size_t deleted;							\
+    size_t capacity;							\
+  } Name;								\
+									\
+  static inline int Name##_resize(Name * tbl, size_t capacity)		\
+  {									\
+    unsigned char * ctrl = malloc(capacity);				\
+    Name##_entry * entries = malloc(capacity * sizeof(Name##_entry));	\
+    if (ctrl == NULL || entries == NULL) {				\
+      free(ctrl);							\
+      free(entries);							\
+      return -1;							\
+    }									\
+									\
+    memset(ctrl, CHASH_TYPED_EMPTY, capacity);				\
+    for (size_t i = 0; i < tbl->capacity; i++) {			\
+      if (tbl->ctrl[i] >= CHASH_TYPED_EMPTY)				\
+	continue;							\
+      uint64_t hash = chash_typed_mix(HashFn(tbl->entries[i].key));	\
+      size_t j = hash & (capacity - 1);					\
+      while (ctrl[j] != CHASH_TYPED_EMPTY)				\
+	j = (j + 1) & (capacity - 1);					\
+      ctrl[j] = hash >> 57;						\
+      entries[j] = tbl->entries[i];					\
+    }									\
+									\
+    free(tbl->ctrl);							\
+    free(tbl->entries);							\
+    tbl->ctrl = ctrl;							\
+    tbl->entries = entries;						\
+    tbl->capacity = capacity;						\
+    tbl->deleted = 0;							\
+    return 0;								\
+  }									\
+									\
+  static inline int Name##_init(Name * tbl, size_t size)		\
+  {									\
+    size_t capacity = CHASH_TYPED_MIN;					\
+    while (CHASH_TYPED_FILL(capacity) < size)				\
+      capacity *= 2;							\
+    *tbl = (Name){.ctrl = NULL, .entries = NULL, .size = 0,		\
+		  .deleted = 0, .capacity = 0};				\
+    return Name##_resize(tbl, capacity);				\
+  }									\
+									\
+  static inline void Name##_destroy(Name * tbl)				\
+  {									\
+    free(tbl->ctrl);							\
+    free(tbl->entries);							\
+    *tbl = (Name){.ctrl = NULL, .entries = NULL, .size = 0,		\
+		  .deleted = 0, .capacity = 0};				\
+  }									\
+									\
+  static inline size_t Name##_find(const Name * tbl, K key,		\
+				   uint64_t hash)			\
+  {									\
+    size_t mask = tbl->capacity - 1;					\
+    unsigned char h2 = hash >> 57;					\
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {		\
+      if (tbl->ctrl[i] == CHASH_TYPED_EMPTY)				\
+	return tbl->capacity;						\
+      if (tbl->ctrl[i] == h2 && EqFn(tbl->entries[i].key, key))		\
+	return i;							\
+    }									\
+  }									\
+									\
+  static inline V * Name##_get(Name * tbl, K key)			\
+  {									\
+    size_t i = Name##_find(tbl, key, chash_typed_mix(HashFn(key)));	\
+    return i < tbl->capacity ? &(tbl->entries[i].value) : NULL;		\
+  }									\
+									\
+  static inline V * Name##_emplace(Name * tbl, K key, int * inserted)	\
+  {									\
+    uint64_t hash = chash_typed_mix(HashFn(key));			\
+    size_t i = Name##_find(tbl, key, hash);				\
+    if (i < tbl->capacity) {						\
+      *inserted = 0;							\
+      return &(tbl->entries[i].value);					\
+    }									\
+									\
+    if (tbl->size + tbl->deleted + 1 > CHASH_TYPED_FILL(tbl->capacity)	\
+	&& Name##_resize(tbl, tbl->size + 1				\
+			 > CHASH_TYPED_FILL(tbl->capacity) / 2		\
+			 ? tbl->capacity * 2 : tbl->capacity))		\
+      return NULL;							\
+									\
+    size_t mask = tbl->capacity - 1;					\
+    for (i = hash & mask; tbl->ctrl[i] < CHASH_TYPED_EMPTY;		\
+	 i = (i + 1) & mask)						\
+      ;									\
+    if (tbl->ctrl[i] == CHASH_TYPED_DELETED)				\
+      tbl->deleted--;							\
+    tbl->ctrl[i] = hash >> 57;						\
+    tbl->entries[i].key = key;						\
+    tbl->size++;							\
+    *inserted = 1;							\
+    return &(tbl->entries[i].value);					\
+  }									\
+									\
+  static inline int Name##_put(Name * tbl, K key, V value)		\
+  {									\
+    int inserted = 0;							\
+    V * slot = Name##_emplace(tbl, key, &inserted);			\
+    if (slot == NULL)							\
+      return -1;							\
+    *slot = value;							\
+    return !inserted;							\
+  }									\
+									\
+  static inline int Name##_remove(Name * tbl, K key, V * value)		\
+  {									\
+    size_t i = Name##_find(tbl, key, chash_typed_mix(HashFn(key)));	\
+    if (i >= tbl->capacity)						\
+      return -1;							\
+									\
+    if (value != NULL)							\
+      *value = tbl->entries[i].value;					\
+    /* A probe only stops at EMPTY, so this can become EMPTY if the	\
+       next entry already is. */					\
+    if (tbl->ctrl[(i + 1) & (tbl->capacity - 1)] == CHASH_TYPED_EMPTY) {	\
+      tbl->ctrl[i] = CHASH_TYPED_EMPTY;					\
+    } else {								\
+      tbl->ctrl[i] = CHASH_TYPED_DELETED;				\
+      tbl->deleted++;							\
+    }									\
+    tbl->size--;							\
+    return 0;								\
+  }									\
+									\
+  static inline size_t Name##_size(const Name * tbl)			\
+  {									\
+    return tbl->size;							\
+  }									\
+									\
+  static inline Name##_entry * Name##_next(const Name * tbl,		\
+					   size_t * iter)		\
+  {									\
+    for (size_t i = *iter; i < tbl->capacity; i++) {			\
+      if (tbl->ctrl[i] < CHASH_TYPED_EMPTY) {				\
+	*iter = i + 1;							\
+	return &(tbl->entries[i]);					\
+      }									\
+    }									\
+    *iter = tbl->capacity;						\
+    return NULL;							\
+  }
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/**
+ * \brief Finalizes a hash so that every bit depends on every input bit. The
+ * position is taken from the low bits and the control byte from the high
+ * bits. This is the 64-bit finalizer from MurmurHash3.
+ */
+static inline uint64_t chash_typed_mix(uint64_t hash)
+{
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+#endif /* __ET_CHASH_TYPED_H__ */
+
+/*****************************************************************************/
@@ -0,0 +1,538 @@
+/******************************************************************************
+ * NAME:	    hash-functions.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the hash functions shipped with the CHash
+ *		    API.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Hash functions for the CHash API
+ *
+ * wyhash follows the final version 4 of Wang Yi's reference implementation.
+ * The integer functions are the MurmurHash3 finalizers, which are bijections,
+ * so distinct keys never collide before the reduction to a bucket.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#include "hash-functions.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define CRC32C_POLY 0x82f63b78u /* Reflected Castagnoli polynomial */
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_X86
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_ARM
+#endif
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static uint32_t fmix32(uint32_t);
+static uint64_t fmix64(uint64_t);
+static void wymum(uint64_t *, uint64_t *);
+static uint64_t wymix(uint64_t, uint64_t);
+static uint64_t read8(const unsigned char *);
+static uint64_t read4(const unsigned char *);
+static uint32_t crc32c_sw(uint32_t, const void *, size_t);
+#ifdef CRC32C_X86
+static uint32_t crc32c_sse42(uint32_t, const void *, size_t);
+#endif
+#ifdef CRC32C_ARM
+static uint32_t crc32c_armv8(uint32_t, const void *, size_t);
+#endif
+static void crc32c_init(void) __attribute__((constructor));
+
+/******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+static const uint64_t wysecret[4] = {
+  0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+  0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static uint32_t crc32c_table[8][256];
+static uint32_t (*crc32c_impl)(uint32_t, const void *, size_t) = crc32c_sw;
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash_int
+ *
+ * DESCRIPTION:	    Hashes an int with the 32-bit MurmurHash3 finalizer.
+ *
+ * ARGUMENTS:	    data: (const void *) -- pointer to the int.
+ *
+ * RETURN:	    int -- the hash.
+ *
+ * NOTES:	    none.
+ ***/
+int chash_hash_int(const void * data)
+{
+  return (int)fmix32((uint32_t)*(const int *)data);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash_u64
+ *
+ * DESCRIPTION:	    Hashes a uint64_t with the 64-bit MurmurHash3 finalizer.
+ *
+ * ARGUMENTS:	    data: (const void *) -- pointer to the uint64_t.
+ *
+ * RETURN:	    int -- the hash.
+ *
+ * NOTES:	    none.
+ ***/
+int chash_hash_u64(const void * data)
+{
+  uint64_t h = fmix64(*(const uint64_t *)data);
+  return chash_fold(h);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash_string
+ *
+ * DESCRIPTION:	    Hashes a NUL-terminated string with wyhash.
+ *
+ * ARGUMENTS:	    data: (const void *) -- the string.
+ *
+ * RETURN:	    int -- the hash.
+ *
+ * NOTES:	    none.
+ ***/
+int chash_hash_string(const void * data)
+{
+  return chash_fold(chash_wyhash(data, strlen(data), 0));
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash_string_fnv1a
+ *
+ * DESCRIPTION:	    Hashes a NUL-terminated string with 64-bit FNV-1a.
+ *
+ * ARGUMENTS:	    data: (const void *) -- the string.
+ *
+ * RETURN:	    int -- the hash.
+ *
+ * NOTES:	    Reads the string only once, stopping at the NUL.
+ ***/
+int chash_hash_string_fnv1a(const void * data)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (const unsigned char * p = data; *p != '\0'; p++) {
+    h ^= *p;
+    h *= 0x100000001b3ULL;
+  }
+  return chash_fold(h);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash_string_crc32c
+ *
+ * DESCRIPTION:	    Hashes a NUL-terminated string with CRC32C.
+ *
+ * ARGUMENTS:	    data: (const void *) -- the string.
+ *
+ * RETURN:	    int -- the hash.
+ *
+ * NOTES:	    none.
+ ***/
+int chash_hash_string_crc32c(const void * data)
+{
+  return (int)chash_crc32c(0, data, strlen(data));
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash64_int
+ *
+ * DESCRIPTION:	    Hashes an int to 64 bits with the 64-bit MurmurHash3
+ *		    finalizer.
+ *
+ * ARGUMENTS:	    data: (const void *) -- pointer to the int.
+ *
+ * RETURN:	    uint64_t -- the hash.
+ *
+ * NOTES:	    The int is zero-extended before mixing.
+ ***/
+uint64_t chash_hash64_int(const void * data)
+{
+  return fmix64((uint32_t)*(const int *)data);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash64_u64
+ *
+ * DESCRIPTION:	    Hashes a uint64_t with the 64-bit MurmurHash3 finalizer.
+ *
+ * ARGUMENTS:	    data: (const void *) -- pointer to the uint64_t.
+ *
+ * RETURN:	    uint64_t -- the hash.
+ *
+ * NOTES:	    none.
+ ***/
+uint64_t chash_hash64_u64(const void * data)
+{
+  return fmix64(*(const uint64_t *)data);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_hash64_string
+ *
+ * DESCRIPTION:	    Hashes a NUL-terminated string to 64 bits with wyhash.
+ *
+ * ARGUMENTS:	    data: (const void *) -- the string.
+ *
+ * RETURN:	    uint64_t -- the hash.
+ *
+ * NOTES:	    none.
+ ***/
+uint64_t chash_hash64_string(const void * data)
+{
+  return chash_wyhash(data, strlen(data), 0);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_key_string
+ *
+ * DESCRIPTION:	    Returns the key of a NUL-terminated string, for tables with
+ *		    inline keys.
+ *
+ * ARGUMENTS:	    data: (const void *) -- the string.
+ *		    bytes: (const void **) -- set to the string.
+ *
+ * RETURN:	    size_t -- the length of the string.
+ *
+ * NOTES:	    Agrees with any match function built on strcmp.
+ ***/
+size_t chash_key_string(const void * data, const void ** bytes)
+{
+  *bytes = data;
+  return strlen(data);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_wyhash
+ *
+ * DESCRIPTION:	    Computes the 64-bit wyhash of len bytes.
+ *
+ * ARGUMENTS:	    key: (const void *) -- the bytes.
+ *		    len: (size_t) -- the number of bytes.
+ *		    seed: (uint64_t) -- the seed.
+ *
+ * RETURN:	    uint64_t -- the hash.
+ *
+ * NOTES:	    Inputs of up to 16 bytes are read with at most four loads
+ *		    and no loop.
+ ***/
+uint64_t chash_wyhash(const void * key, size_t len, uint64_t seed)
+{
+  const unsigned char * p = key;
+  uint64_t a, b;
+
+  seed ^= wymix(seed ^ wysecret[0], wysecret[1]);
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+      b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+    if (i >= 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+	seed = wymix(read8(p) ^ wysecret[1], read8(p + 8) ^ seed);
+	see1 = wymix(read8(p + 16) ^ wysecret[2], read8(p + 24) ^ see1);
+	see2 = wymix(read8(p + 32) ^ wysecret[3], read8(p + 40) ^ see2);
+	p += 48;
+	i -= 48;
+      } while (i >= 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = wymix(read8(p) ^ wysecret[1], read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = read8(p + i - 16);
+    b = read8(p + i - 8);
+  }
+
+  a ^= wysecret[1];
+  b ^= seed;
+  wymum(&a, &b);
+  return wymix(a ^ wysecret[0] ^ len, b ^ wysecret[1]);
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_fnv1a
+ *
+ * DESCRIPTION:	    Computes the 64-bit FNV-1a hash of len bytes.
+ *
+ * ARGUMENTS:	    key: (const void *) -- the bytes.
+ *		    len: (size_t) -- the number of bytes.
+ *
+ * RETURN:	    uint64_t -- the hash.
+ *
+ * NOTES:	    none.
+ ***/
+uint64_t chash_fnv1a(const void * key, size_t len)
+{
+  const unsigned char * p = key;
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/******************************************************************************
+ * FUNCTION:	    chash_crc32c
+ *
+ * DESCRIPTION:	    Extends a CRC32C checksum over len bytes.
+ *
+ * ARGUMENTS:	    crc: (uint32_t) -- the checksum so far, or 0.
+ *		    key: (const void *) -- the bytes.
+ *		    len: (size_t) -- the number of bytes.
+ *
+ * RETURN:	    uint32_t -- the checksum.
+ *
+ * NOTES:	    The implementation is chosen once by crc32c_init.
+ ***/
+uint32_t chash_crc32c(uint32_t crc, const void * key, size_t len)
+{
+  return crc32c_impl(crc, key, len);
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/* The MurmurHash3 finalizers. */
+static uint32_t fmix32(uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+static uint64_t fmix64(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/******************************************************************************
+ * FUNCTION:	    wymum
+ *
+ * DESCRIPTION:	    Multiplies *a and *b into a 128-bit product, and stores the
+ *		    low half in *a and the high half in *b.
+ *
+ * ARGUMENTS:	    a, b: (uint64_t *) -- the operands.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Falls back to four 32-bit multiplies where the compiler has
+ *		    no 128-bit integer type.
+ ***/
+static void wymum(uint64_t * a, uint64_t * b)
+{
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static uint64_t wymix(uint64_t a, uint64_t b)
+{
+  wymum(&a, &b);
+  return a ^ b;
+}
+
+static uint64_t read8(const unsigned char * p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t read4(const unsigned char * p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/******************************************************************************
+ * FUNCTION:	    crc32c_sw
+ *
+ * DESCRIPTION:	    Portable CRC32C, eight bytes at a time (slicing-by-8).
+ *
+ * ARGUMENTS:	    crc: (uint32_t) -- the checksum so far.
+ *		    key: (const void *) -- the bytes.
+ *		    len: (size_t) -- the number of bytes.
+ *
+ * RETURN:	    uint32_t -- the checksum.
+ *
+ * NOTES:	    none.
+ ***/
+static uint32_t crc32c_sw(uint32_t crc, const void * key, size_t len)
+{
+  const unsigned char * p = key;
+  crc = ~crc;
+
+  for (; len >= 8; len -= 8, p += 8) {
+    uint32_t lo = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8
+			 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+    crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff]
+      ^ crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24]
+      ^ crc32c_table[3][p[4]] ^ crc32c_table[2][p[5]]
+      ^ crc32c_table[1][p[6]] ^ crc32c_table[0][p[7]];
+  }
+
+  while (len--)
+    crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+#ifdef CRC32C_X86
+/******************************************************************************
+ * FUNCTION:	    crc32c_sse42
+ *
+ * DESCRIPTION:	    CRC32C using the SSE4.2 crc32 instruction.
+ *
+ * ARGUMENTS:	    crc: (uint32_t) -- the checksum so far.
+ *		    key: (const void *) -- the bytes.
+ *		    len: (size_t) -- the number of bytes.
+ *
+ * RETURN:	    uint32_t -- the checksum.
+ *
+ * NOTES:	    Only called if the CPU reports SSE4.2.
+ ***/
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void * key, size_t len)
+{
+  const unsigned char * p = key;
+  uint64_t c = ~crc;
+
+  for (; len >= 8; len -= 8, p += 8)
+    c = __builtin_ia32_crc32di(c, read8(p));
+  uint32_t c32 = (uint32_t)c;
+  while (len--)
+    c32 = __builtin_ia32_crc32qi(c32, *p++);
+  return ~c32;
+}
+#endif
+
+#ifdef CRC32C_ARM
+/******************************************************************************
+ * FUNCTION:	    crc32c_armv8
+ *
+ * DESCRIPTION:	    CRC32C using the ARMv8 crc32c instructions.
+ *
+ * ARGUMENTS:	    crc: (uint32_t) -- the checksum so far.
+ *		    key: (const void *) -- the bytes.
+ *		    len: (size_t) -- the number of bytes.
+ *
+ * RETURN:	    uint32_t -- the checksum.
+ *
+ * NOTES:	    Only called if the CPU reports the CRC32 extension.
+ ***/
+__attribute__((target("+crc")))
+static uint32_t crc32c_armv8(uint32_t crc, const void * key, size_t len)
+{
+  const unsigned char * p = key;
+  crc = ~crc;
+
+  for (; len >= 8; len -= 8, p += 8)
+    crc = __builtin_aarch64_crc32cx(crc, read8(p));
+  while (len--)
+    crc = __builtin_aarch64_crc32cb(crc, *p++);
+  return ~crc;
+}
+#endif
+
+/******************************************************************************
+ * FUNCTION:	    crc32c_init
+ *
+ * DESCRIPTION:	    Runs before main. Builds the tables for the portable CRC32C
+ *		    and selects the fastest implementation for this CPU.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Running as a constructor avoids having to synchronize a
+ *		    lazy initialization between threads.
+ ***/
+static void crc32c_init(void)
+{
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+    crc32c_table[0][i] = crc;
+  }
+
+  for (uint32_t i = 0; i < 256; i++)
+    for (int t = 1; t < 8; t++)
+      crc32c_table[t][i] = (crc32c_table[t - 1][i] >> 8)
+	^ crc32c_table[0][crc32c_table[t - 1][i] & 0xff];
+
+#if defined(CRC32C_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2"))
+    crc32c_impl = crc32c_sse42;
+#elif defined(CRC32C_ARM) && defined(__ARM_FEATURE_CRC32)
+  crc32c_impl = crc32c_armv8;
+#elif defined(CRC32C_ARM) && defined(__linux__)
+  if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+    crc32c_impl = crc32c_armv8;
+#endif
+}
+
+/*****************************************************************************/
@@ -0,0 +1,166 @@
+/******************************************************************************
+ * NAME:	    hash-functions.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Common hash functions for use with the CHash API.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \file hash-functions.h
+ * \author Ethan D. Twardy
+ * \date 10/14/2026
+ * \brief Hash functions to pass to chash_init.
+ *
+ * The chash_hash_* functions match the hash parameter of chash_init and can be
+ * passed to it directly. The chash_hash64_* functions match the hash64 member
+ * of CHashOpts. They are built on the byte-oriented functions at the bottom of
+ * this file, which may also be used on their own.
+ */
+
+#ifndef __ET_HASH_FUNCTIONS_H__
+#define __ET_HASH_FUNCTIONS_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/**
+ * \brief Defines a hash function \c Name for keys of exactly \c Width bytes.
+ *
+ * The function hashes the first \c Width bytes of the data with wyhash. Since
+ * the width is a constant, the compiler can specialize the reads for it.
+ */
+#define CHASH_DEFINE_BYTES_HASH(Name, Width)		\
+  static int Name(const void * data)			\
+  {							\
+    return chash_fold(chash_wyhash(data, (Width), 0));	\
+  }
+
+/**
+ * \brief Like CHASH_DEFINE_BYTES_HASH, for use as CHashOpts.hash64.
+ */
+#define CHASH_DEFINE_BYTES_HASH64(Name, Width)		\
+  static uint64_t Name(const void * data)		\
+  {							\
+    return chash_wyhash(data, (Width), 0);		\
+  }
+
+/**
+ * \brief Folds a 64-bit hash into the int returned by a CHash hash function.
+ */
+#define chash_fold(Hash) ((int)(uint32_t)((Hash) ^ ((Hash) >> 32)))
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Hashes an \c int key.
+ * \param data Pointer to the \c int.
+ * \return int The hash.
+ */
+extern int chash_hash_int(const void * data);
+
+/**
+ * \brief Hashes a \c uint64_t key.
+ * \param data Pointer to the \c uint64_t.
+ * \return int The hash.
+ */
+extern int chash_hash_u64(const void * data);
+
+/**
+ * \brief Hashes a NUL-terminated string with wyhash.
+ * \param data Pointer to the first character.
+ * \return int The hash.
+ */
+extern int chash_hash_string(const void * data);
+
+/**
+ * \brief Hashes a NUL-terminated string with FNV-1a.
+ * \param data Pointer to the first character.
+ * \return int The hash.
+ * \note FNV-1a needs no call to strlen, which makes it competitive for very
+ * short strings, but it is slower than wyhash on anything longer.
+ */
+extern int chash_hash_string_fnv1a(const void * data);
+
+/**
+ * \brief Hashes a NUL-terminated string with CRC32C.
+ * \param data Pointer to the first character.
+ * \return int The hash.
+ * \note Fastest on machines with CRC instructions. See chash_crc32c.
+ */
+extern int chash_hash_string_crc32c(const void * data);
+
+/**
+ * \brief Hashes an \c int key to 64 bits.
+ * \param data Pointer to the \c int.
+ * \return uint64_t The hash.
+ */
+extern uint64_t chash_hash64_int(const void * data);
+
+/**
+ * \brief Hashes a \c uint64_t key to 64 bits.
+ * \param data Pointer to the \c uint64_t.
+ * \return uint64_t The hash.
+ */
+extern uint64_t chash_hash64_u64(const void * data);
+
+/**
+ * \brief Hashes a NUL-terminated string to 64 bits with wyhash.
+ * \param data Pointer to the first character.
+ * \return uint64_t The hash.
+ */
+extern uint64_t chash_hash64_string(const void * data);
+
+/**
+ * \brief The key of a NUL-terminated string, for CHashOpts.key.
+ * \param data Pointer to the first character.
+ * \param bytes Set to \c data.
+ * \return size_t The length of the string, without its NUL.
+ */
+extern size_t chash_key_string(const void * data, const void ** bytes);
+
+/**
+ * \brief 64-bit wyhash of \c len bytes.
+ * \param key The bytes to hash.
+ * \param len The number of bytes.
+ * \param seed The seed.
+ * \return uint64_t The hash.
+ */
+extern uint64_t chash_wyhash(const void * key, size_t len, uint64_t seed);
+
+/**
+ * \brief 64-bit FNV-1a of \c len bytes.
+ * \param key The bytes to hash.
+ * \param len The number of bytes.
+ * \return uint64_t The hash.
+ */
+extern uint64_t chash_fnv1a(const void * key, size_t len);
+
+/**
+ * \brief Extends the CRC32C (Castagnoli) checksum \c crc over \c len bytes.
+ * \param crc The checksum so far, \c 0 to start a new one.
+ * \param key The bytes to checksum.
+ * \param len The number of bytes.
+ * \return uint32_t The checksum.
+ * \note Uses the SSE4.2 or ARMv8 CRC32 instructions when the CPU has them,
+ * detected once at startup, and a slicing-by-8 table otherwise.
+ */
+extern uint32_t chash_crc32c(uint32_t crc, const void * key, size_t len);
+
+#endif /* __ET_HASH_FUNCTIONS_H__ */
+
+/*****************************************************************************/
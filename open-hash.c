@@ -0,0 +1,761 @@
+/******************************************************************************
+ * NAME:	    open-hash.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Source code for the open-addressing engine of the CHash API.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+/**
+ * \brief Open-addressing engine for the CHash API
+ *
+ * The data pointers are stored inline in tbl->slots, a power-of-two array.
+ * Every slot has one control byte in tbl->ctrl: EMPTY, DELETED, or, for a
+ * full slot, seven bits of the element's hash. The slots are probed in
+ * aligned groups of OHASH_GROUP, and the control bytes of a whole group are
+ * compared at once, so tbl->match is only called when the stored hash bits
+ * agree. A probe stops at the first group that still has an EMPTY slot. The
+ * values of a map table sit at the same index of tbl->values, so probes never
+ * load them.
+ *
+ * A group is compared with one SSE2 or NEON instruction where the compiler
+ * targets either, and with two 64-bit words otherwise. Sweeps over the whole
+ * table read 32 control bytes at a time, with AVX2 when the processor has it.
+ */
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* `make CONFIG_OHASH_SCALAR=1` uses the portable group functions. */
+#if defined(__SSE2__) && !defined(CONFIG_OHASH_SCALAR)
+#define OHASH_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__) \
+  && !defined(CONFIG_OHASH_SCALAR)
+#define OHASH_NEON
+#include <arm_neon.h>
+#endif
+
+/* Whole-table sweeps pick an AVX2 version at run time where it might exist. */
+#if defined(OHASH_SSE2) && defined(__x86_64__) && defined(__GNUC__)
+#define OHASH_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include "chain-hash.h"
+#include "chash-alloc.h"
+#include "chash-internal.h"
+#include "chash-stats.h"
+#include "chash-trace.h"
+#include "open-hash.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xfe
+
+/* Unused slots may make up at most 1/8th of the table. */
+#define MAX_FILL(Cap) ((Cap) - (Cap) / 8)
+
+/* The seven bits of the hash kept in the control byte of a full slot. */
+#define H2(Hash) ((Hash) >> 57)
+
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+/******************************************************************************
+ * INLINE FUNCTIONS
+ ***/
+
+/*
+ * The group_* functions return a mask with bit i set if control byte i of a
+ * group satisfies their predicate: group_match for a byte equal to h2,
+ * group_empty for EMPTY, group_free for EMPTY or DELETED (the high bit set)
+ * and group_full for a full slot. With SSE2 or NEON the sixteen bytes are
+ * compared at once. Otherwise each half of the group is tested as one word,
+ * and group_match may report a false positive for a byte that follows a true
+ * match, which is harmless since candidates are confirmed with tbl->match.
+ */
+#if defined(OHASH_SSE2)
+
+static inline unsigned int group_match(const unsigned char * ctrl,
+				       uint64_t h2)
+{
+  __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+}
+
+static inline unsigned int group_empty(const unsigned char * ctrl)
+{
+  __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(group,
+					  _mm_set1_epi8((char)CTRL_EMPTY)));
+}
+
+static inline unsigned int group_free(const unsigned char * ctrl)
+{
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#elif defined(OHASH_NEON)
+
+/* Gathers the top bit of every byte of 0x00 or 0xff into a 16-bit mask. */
+static inline unsigned int neon_mask(uint8x16_t bytes)
+{
+  static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+				      1, 2, 4, 8, 16, 32, 64, 128};
+  uint8x16_t bits = vandq_u8(bytes, vld1q_u8(weights));
+  return vaddv_u8(vget_low_u8(bits))
+    | (unsigned int)vaddv_u8(vget_high_u8(bits)) << 8;
+}
+
+static inline unsigned int group_match(const unsigned char * ctrl,
+				       uint64_t h2)
+{
+  return neon_mask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(h2)));
+}
+
+static inline unsigned int group_empty(const unsigned char * ctrl)
+{
+  return neon_mask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(CTRL_EMPTY)));
+}
+
+static inline unsigned int group_free(const unsigned char * ctrl)
+{
+  return neon_mask(vtstq_u8(vld1q_u8(ctrl), vdupq_n_u8(0x80)));
+}
+
+#else
+
+static inline uint64_t load_word(const unsigned char * ctrl)
+{
+  uint64_t word;
+  memcpy(&word, ctrl, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+/* Turns the high bits of the bytes of two words into a 16-bit mask. */
+static inline unsigned int word_mask(uint64_t low, uint64_t high)
+{
+  unsigned int mask = 0;
+  for (int half = 0; half < 2; half++) {
+    for (uint64_t bits = half ? high : low; bits; bits &= bits - 1)
+      mask |= 1u << (half * 8 + __builtin_ctzll(bits) / 8);
+  }
+  return mask;
+}
+
+static inline unsigned int group_match(const unsigned char * ctrl,
+				       uint64_t h2)
+{
+  uint64_t low = load_word(ctrl) ^ (LSBS * h2);
+  uint64_t high = load_word(ctrl + 8) ^ (LSBS * h2);
+  return word_mask((low - LSBS) & ~low & MSBS, (high - LSBS) & ~high & MSBS);
+}
+
+static inline unsigned int group_empty(const unsigned char * ctrl)
+{
+  /* 0x80 has bit 1 clear, 0xfe does not. */
+  uint64_t low = load_word(ctrl), high = load_word(ctrl + 8);
+  return word_mask(low & ~(low << 6) & MSBS, high & ~(high << 6) & MSBS);
+}
+
+static inline unsigned int group_free(const unsigned char * ctrl)
+{
+  return word_mask(load_word(ctrl) & MSBS, load_word(ctrl + 8) & MSBS);
+}
+
+#endif
+
+static inline unsigned int group_full(const unsigned char * ctrl)
+{
+  return ~group_free(ctrl) & 0xffff;
+}
+
+/******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static uint64_t mix(uint64_t);
+static uint32_t sweep_groups(const unsigned char *);
+#ifdef OHASH_DISPATCH
+static uint32_t sweep_avx2(const unsigned char *);
+#endif
+static unsigned int next_full(const unsigned char *, unsigned int,
+			      unsigned int);
+static int find_free(CHash *, uint64_t);
+static int find_match(CHash *, const void *, uint64_t, int *);
+static unsigned int probe_length(CHash *, unsigned int);
+static void erase_slot(CHash *, unsigned int);
+static int resize(CHash *, unsigned int);
+
+/******************************************************************************
+ * LOCAL VARIABLES
+ ***/
+
+/* Returns the full slots among 32 control bytes. Set by ohash_init. */
+static uint32_t (*sweep)(const unsigned char *) = sweep_groups;
+
+/******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    ohash_init
+ *
+ * DESCRIPTION:	    Allocates the control bytes and slots of an open table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table to initialize.
+ *		    size: (unsigned int) -- the requested number of slots.
+ *
+ * RETURN:	    int -- 0 on success, -1 if memory could not be allocated.
+ *
+ * NOTES:	    The number of slots is rounded up to a power of two, and
+ *		    to at least one group. Also picks the sweep function for
+ *		    the processor.
+ ***/
+int ohash_init(CHash * tbl, unsigned int size)
+{
+#ifdef OHASH_DISPATCH
+  if (__builtin_cpu_supports("avx2"))
+    __atomic_store_n(&sweep, sweep_avx2, __ATOMIC_RELAXED);
+#endif
+
+  unsigned int cap = OHASH_GROUP;
+  while (cap < size)
+    cap *= 2;
+
+  tbl->minbuckets = cap;
+  return resize(tbl, cap);
+}
+
+/******************************************************************************
+ * FUNCTION:	    ohash_put
+ *
+ * DESCRIPTION:	    Inserts *data into the first free slot along its probe
+ *		    sequence, unless an element matching it is already there.
+ *		    Same contract as chash_find_or_insert and chash_upsert.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table to insert into.
+ *		    data: (void **) -- the data to insert. Receives the
+ *			element found if mode is CHASH_PUT_FIND.
+ *		    mode: (CHashPutMode) -- what is done with a match found.
+ *		    value: (void *) -- the value of *data, on a map table.
+ *
+ * RETURN:	    int -- 0 if *data was inserted, 1 if a match was found,
+ *		    -1 on error.
+ *
+ * NOTES:	    The search remembers the first free slot it passes, so a
+ *		    miss does not probe again, unless the table has to grow
+ *		    first.
+ ***/
+int ohash_put(CHash * tbl, void ** data, CHashPutMode mode, void * value)
+{
+  uint64_t hash = mix(chash_hashof(tbl, *data));
+  int slot = -1, match = find_match(tbl, *data, hash, &slot);
+  if (match >= 0) {
+    void * old = tbl->slots[match];
+    if (mode == CHASH_PUT_FIND) {
+      *data = old;
+    } else if (mode == CHASH_PUT_VALUE) {
+      old = tbl->values[match];
+      tbl->values[match] = value;
+      if (old != value)
+	chash_drop_value(tbl, old);
+    } else if (old != *data) {
+      tbl->slots[match] = *data;
+      chash_drop_data(tbl, old);
+    }
+    return 1;
+  }
+
+  if (tbl->size + tbl->deleted + 1 > MAX_FILL(tbl->buckets)) {
+    /* Mostly tombstones: rebuild at the same size instead of growing. */
+    unsigned int cap = tbl->size + 1 > MAX_FILL(tbl->buckets) / 2
+      ? tbl->buckets * 2 : tbl->buckets;
+    if (resize(tbl, cap))
+      return -1;
+    slot = find_free(tbl, hash);
+  }
+
+  if (tbl->ctrl[slot] == CTRL_DELETED)
+    tbl->deleted--;
+  tbl->ctrl[slot] = H2(hash);
+  tbl->slots[slot] = *data;
+  if (tbl->values != NULL)
+    tbl->values[slot] = value;
+  tbl->size++;
+  cstats_count(tbl, inserts, 1);
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ohash_remove
+ *
+ * DESCRIPTION:	    Removes the element matching *data, or any element if
+ *		    *data is NULL. Same contract as chash_remove.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (void **) -- the data in question.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    The value of the element, on a map table, is destroyed
+ *		    either way.
+ ***/
+int ohash_remove(CHash * tbl, void ** data)
+{
+  int slot = -1;
+  if (*data != NULL) {
+    slot = find_match(tbl, *data, mix(chash_hashof(tbl, *data)), NULL);
+    if (slot < 0)
+      return -1;
+    chash_drop_data(tbl, tbl->slots[slot]);
+  } else {
+    slot = next_full(tbl->ctrl, tbl->buckets, 0);
+    if (slot == (int)tbl->buckets)
+      return -1;
+    *data = tbl->slots[slot];
+  }
+  if (tbl->values != NULL)
+    chash_drop_value(tbl, tbl->values[slot]);
+
+  erase_slot(tbl, slot);
+  cstats_count(tbl, removes, 1);
+  if (tbl->minload > 0 && tbl->buckets > tbl->minbuckets
+      && tbl->size < tbl->minload * tbl->buckets
+      && tbl->size < MAX_FILL(tbl->buckets / 2) / 2)
+    resize(tbl, tbl->buckets / 2); /* On failure, keep the larger table. */
+  return 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ohash_lookup
+ *
+ * DESCRIPTION:	    Queries the table for *data. Same contract as chash_lookup.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (void **) -- the data in question.
+ *		    value: (void **) -- receives the value of the element on
+ *			a map table, unless NULL.
+ *
+ * RETURN:	    int -- 1 if the data was found, 0 if it was not.
+ *
+ * NOTES:	    none.
+ ***/
+int ohash_lookup(CHash * tbl, void ** data, void ** value)
+{
+  int slot = -1;
+  if (*data != NULL) {
+    slot = find_match(tbl, *data, mix(chash_hashof(tbl, *data)), NULL);
+  } else if (tbl->size > 0) {
+    slot = next_full(tbl->ctrl, tbl->buckets, 0);
+  }
+
+  cstats_lookup(tbl, slot >= 0);
+  if (slot < 0)
+    return 0;
+  *data = tbl->slots[slot];
+  if (value != NULL)
+    *value = tbl->values[slot];
+  return 1;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ohash_traverse
+ *
+ * DESCRIPTION:	    Calls callback() on every element in the table.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    callback: (void (*)(void *)) -- the callback function.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void ohash_traverse(CHash * tbl, void (*callback)(void *))
+{
+  for (unsigned int i = next_full(tbl->ctrl, tbl->buckets, 0); i < tbl->buckets;
+       i = next_full(tbl->ctrl, tbl->buckets, i + 1))
+    callback(tbl->slots[i]);
+}
+
+/******************************************************************************
+ * FUNCTION:	    ohash_scan
+ *
+ * DESCRIPTION:	    Calls callback() on every element of one group of slots.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    cursor: (uint64_t) -- the group to visit.
+ *		    callback: (void (*)(void *, void *)) -- the callback.
+ *		    arg: (void *) -- passed through to callback.
+ *
+ * RETURN:	    uint64_t -- the next group, or 0 after the last one.
+ *
+ * NOTES:	    A resize moves every element, so an element may be missed
+ *		    or repeated if the table resizes between two calls.
+ ***/
+uint64_t ohash_scan(CHash * tbl, uint64_t cursor,
+		    void (*callback)(void *, void *), void * arg)
+{
+  uint64_t groups = tbl->buckets / OHASH_GROUP;
+  if (cursor >= groups)
+    return 0;
+
+  for (unsigned int mask = group_full(tbl->ctrl + cursor * OHASH_GROUP); mask;
+       mask &= mask - 1)
+    callback(tbl->slots[cursor * OHASH_GROUP + __builtin_ctz(mask)], arg);
+  return cursor + 1 < groups ? cursor + 1 : 0;
+}
+
+/******************************************************************************
+ * FUNCTION:	    ohash_destroy
+ *
+ * DESCRIPTION:	    Destroys every element (if tbl->destroy is set) and value
+ *		    (if tbl->destroy_value is) and frees the arrays of the
+ *		    table. Does not free tbl itself.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void ohash_destroy(CHash * tbl)
+{
+  if (tbl->destroy != NULL)
+    ohash_traverse(tbl, tbl->destroy);
+  if (tbl->values != NULL && tbl->destroy_value != NULL) {
+    for (unsigned int i = next_full(tbl->ctrl, tbl->buckets, 0);
+	 i < tbl->buckets; i = next_full(tbl->ctrl, tbl->buckets, i + 1))
+      chash_drop_value(tbl, tbl->values[i]);
+  }
+  cmem_free(&(tbl->allocator), tbl->ctrl, tbl->buckets);
+  cmem_free(&(tbl->allocator), tbl->slots, tbl->buckets * sizeof(void *));
+  cmem_free(&(tbl->allocator), tbl->values, tbl->buckets * sizeof(void *));
+}
+
+/******************************************************************************
+ * FUNCTION:	    ohash_stats
+ *
+ * DESCRIPTION:	    Fills in the shape of the table: slot usage and the probe
+ *		    length of every element.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    stats: (CHashStats *) -- zeroed by the caller.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Rehashes every element to find its home group.
+ ***/
+void ohash_stats(CHash * tbl, CHashStats * stats)
+{
+  unsigned long total = 0;
+  stats->buckets = tbl->buckets;
+  stats->deleted = tbl->deleted;
+  for (unsigned int i = 0; i < tbl->buckets; i++) {
+    if (tbl->ctrl[i] == CTRL_EMPTY)
+      stats->empty++;
+    if (tbl->ctrl[i] >= CTRL_EMPTY)
+      continue;
+
+    unsigned int length = probe_length(tbl, i);
+    stats->used++;
+    stats->histogram[length - 1 < CHASH_STATS_HISTOGRAM
+		     ? length - 1 : CHASH_STATS_HISTOGRAM - 1]++;
+    if (length > stats->max_chain)
+      stats->max_chain = length;
+    total += length;
+  }
+
+  if (stats->used > 0)
+    stats->mean_chain = (float)total / stats->used;
+}
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/******************************************************************************
+ * FUNCTION:	    mix
+ *
+ * DESCRIPTION:	    Finalizes the user's hash so that every bit depends on
+ *		    every input bit. The group index is taken from the low bits
+ *		    and the control byte from the high bits, so an identity
+ *		    hash on small integers must not leave the high bits zero.
+ *
+ * ARGUMENTS:	    h: (uint64_t) -- the hash of the element.
+ *
+ * RETURN:	    uint64_t -- the mixed hash.
+ *
+ * NOTES:	    This is the 64-bit finalizer from MurmurHash3.
+ ***/
+static uint64_t mix(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/******************************************************************************
+ * FUNCTION:	    sweep_groups
+ *
+ * DESCRIPTION:	    Returns a mask of the full slots among 32 control bytes.
+ *
+ * ARGUMENTS:	    ctrl: (const unsigned char *) -- the first byte.
+ *
+ * RETURN:	    uint32_t -- bit i is set if slot i is full.
+ *
+ * NOTES:	    The version for any processor: two groups.
+ ***/
+static uint32_t sweep_groups(const unsigned char * ctrl)
+{
+  return group_full(ctrl) | (uint32_t)group_full(ctrl + OHASH_GROUP) << 16;
+}
+
+#ifdef OHASH_DISPATCH
+/******************************************************************************
+ * FUNCTION:	    sweep_avx2
+ *
+ * DESCRIPTION:	    Same as sweep_groups, in one AVX2 instruction.
+ *
+ * ARGUMENTS:	    ctrl: (const unsigned char *) -- the first byte.
+ *
+ * RETURN:	    uint32_t -- bit i is set if slot i is full.
+ *
+ * NOTES:	    Only called once the processor is known to support AVX2.
+ ***/
+__attribute__((target("avx2")))
+static uint32_t sweep_avx2(const unsigned char * ctrl)
+{
+  return ~(uint32_t)_mm256_movemask_epi8(
+    _mm256_loadu_si256((const __m256i *)ctrl));
+}
+#endif
+
+/******************************************************************************
+ * FUNCTION:	    next_full
+ *
+ * DESCRIPTION:	    Returns the first full slot at or after from.
+ *
+ * ARGUMENTS:	    ctrl: (const unsigned char *) -- the control bytes.
+ *		    cap: (unsigned int) -- the number of slots.
+ *		    from: (unsigned int) -- the first slot to consider.
+ *
+ * RETURN:	    unsigned int -- the slot, or cap if there is none.
+ *
+ * NOTES:	    Sweeps 32 control bytes at a time with the function chosen
+ *		    by ohash_init. A table of one group is swept by group.
+ ***/
+static unsigned int next_full(const unsigned char * ctrl, unsigned int cap,
+			      unsigned int from)
+{
+  uint32_t (*sweep32)(const unsigned char *)
+    = __atomic_load_n(&sweep, __ATOMIC_RELAXED);
+  unsigned int width = cap >= 32 ? 32 : OHASH_GROUP;
+  for (unsigned int base = from & ~(width - 1); base < cap; base += width) {
+    uint32_t full = width == 32 ? sweep32(ctrl + base)
+      : group_full(ctrl + base);
+    if (base < from)
+      full &= ~0u << (from - base);
+    if (full)
+      return base + __builtin_ctz(full);
+  }
+  return cap;
+}
+
+/******************************************************************************
+ * FUNCTION:	    find_free
+ *
+ * DESCRIPTION:	    Returns the first EMPTY or DELETED slot on the probe
+ *		    sequence of hash.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    hash: (uint64_t) -- the mixed hash.
+ *
+ * RETURN:	    int -- the index of the slot.
+ *
+ * NOTES:	    The fill limit guarantees that a free slot exists.
+ ***/
+static int find_free(CHash * tbl, uint64_t hash)
+{
+  unsigned int groups = tbl->buckets / OHASH_GROUP;
+  for (unsigned int g = hash & (groups - 1);; g = (g + 1) & (groups - 1)) {
+    unsigned int mask = group_free(tbl->ctrl + g * OHASH_GROUP);
+    if (mask)
+      return g * OHASH_GROUP + __builtin_ctz(mask);
+  }
+}
+
+/******************************************************************************
+ * FUNCTION:	    find_match
+ *
+ * DESCRIPTION:	    Returns the slot holding an element which matches data.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    data: (const void *) -- the data to search for.
+ *		    hash: (uint64_t) -- the mixed hash of data.
+ *		    vacant: (int *) -- if not NULL, receives the first free slot
+ *			along the probe sequence, or is left alone if there is
+ *			none.
+ *
+ * RETURN:	    int -- the index of the slot, or -1 if there is none.
+ *
+ * NOTES:	    A miss ends at the first group with an empty slot, so when
+ *		    the table is not full, *vacant is always set on a miss.
+ ***/
+static int find_match(CHash * tbl, const void * data, uint64_t hash,
+		      int * vacant)
+{
+  unsigned int groups = tbl->buckets / OHASH_GROUP;
+  unsigned int g = hash & (groups - 1);
+  unsigned int i;
+  for (i = 0; i < groups; i++, g = (g + 1) & (groups - 1)) {
+    const unsigned char * ctrl = tbl->ctrl + g * OHASH_GROUP;
+    for (unsigned int mask = group_match(ctrl, H2(hash));
+	 mask; mask &= mask - 1) {
+      int slot = g * OHASH_GROUP + __builtin_ctz(mask);
+      if (tbl->ctrl[slot] == H2(hash) && tbl->match(data, tbl->slots[slot])) {
+	cstats_count(tbl, probes, i + 1);
+	ctrace_probe(tbl, hash, i + 1);
+	return slot;
+      }
+    }
+
+    unsigned int mask;
+    if (vacant != NULL && *vacant < 0
+	&& (mask = group_free(ctrl)))
+      *vacant = g * OHASH_GROUP + __builtin_ctz(mask);
+    if (group_empty(ctrl))
+      break;
+  }
+
+  cstats_count(tbl, probes, i < groups ? i + 1 : groups);
+  ctrace_probe(tbl, hash, i < groups ? i + 1 : groups);
+  return -1;
+}
+
+/******************************************************************************
+ * FUNCTION:	    probe_length
+ *
+ * DESCRIPTION:	    Returns the number of groups probed to reach a full slot.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    slot: (unsigned int) -- the slot.
+ *
+ * RETURN:	    unsigned int -- 1 if the slot is in its home group.
+ *
+ * NOTES:	    none.
+ ***/
+static unsigned int probe_length(CHash * tbl, unsigned int slot)
+{
+  unsigned int groups = tbl->buckets / OHASH_GROUP;
+  uint64_t hash = mix(chash_hashof(tbl, tbl->slots[slot]));
+  unsigned int home = hash & (groups - 1);
+  return ((slot / OHASH_GROUP - home) & (groups - 1)) + 1;
+}
+
+/******************************************************************************
+ * FUNCTION:	    erase_slot
+ *
+ * DESCRIPTION:	    Marks a full slot as unused.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table in question.
+ *		    slot: (unsigned int) -- the slot to erase.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    If the group still has an EMPTY slot, no probe sequence
+ *		    continues past it, so the slot can be made EMPTY too.
+ *		    Otherwise a DELETED tombstone keeps later probes going.
+ ***/
+static void erase_slot(CHash * tbl, unsigned int slot)
+{
+  unsigned char * group = tbl->ctrl + slot / OHASH_GROUP * OHASH_GROUP;
+  if (group_empty(group)) {
+    tbl->ctrl[slot] = CTRL_EMPTY;
+  } else {
+    tbl->ctrl[slot] = CTRL_DELETED;
+    tbl->deleted++;
+  }
+  tbl->slots[slot] = NULL;
+  if (tbl->values != NULL)
+    tbl->values[slot] = NULL;
+  tbl->size--;
+}
+
+/******************************************************************************
+ * FUNCTION:	    resize
+ *
+ * DESCRIPTION:	    Moves every element into freshly allocated arrays of cap
+ *		    slots, dropping all tombstones.
+ *
+ * ARGUMENTS:	    tbl: (CHash *) -- the table to resize.
+ *		    cap: (unsigned int) -- the new number of slots, a power of
+ *			two and a multiple of OHASH_GROUP.
+ *
+ * RETURN:	    int -- 0 on success, -1 if memory could not be allocated,
+ *		    in which case the table is left untouched.
+ *
+ * NOTES:	    Unlike the chained engine, this rehashes the whole table in
+ *		    one call. The values of a map table move with their keys.
+ ***/
+static int resize(CHash * tbl, unsigned int cap)
+{
+  unsigned char * ctrl = cmem_alloc(&(tbl->allocator), cap);
+  void ** slots = cmem_calloc(&(tbl->allocator), cap, sizeof(void *));
+  void ** values = tbl->map
+    ? cmem_calloc(&(tbl->allocator), cap, sizeof(void *)) : NULL;
+  if (ctrl == NULL || slots == NULL || (tbl->map && values == NULL)) {
+    cmem_free(&(tbl->allocator), ctrl, cap);
+    cmem_free(&(tbl->allocator), slots, cap * sizeof(void *));
+    cmem_free(&(tbl->allocator), values, cap * sizeof(void *));
+    return -1;
+  }
+  memset(ctrl, CTRL_EMPTY, cap);
+
+  uint64_t start = ctrace_start(tbl);
+  unsigned char * oldctrl = tbl->ctrl;
+  void ** oldslots = tbl->slots, ** oldvalues = tbl->values;
+  unsigned int oldcap = tbl->buckets;
+
+  tbl->ctrl = ctrl;
+  tbl->slots = slots;
+  tbl->values = values;
+  tbl->buckets = cap;
+  tbl->deleted = 0;
+  unsigned int i = oldctrl != NULL ? next_full(oldctrl, oldcap, 0) : oldcap;
+  for (; i < oldcap; i = next_full(oldctrl, oldcap, i + 1)) {
+    uint64_t hash = mix(chash_hashof(tbl, oldslots[i]));
+    int slot = find_free(tbl, hash);
+    ctrl[slot] = H2(hash);
+    slots[slot] = oldslots[i];
+    if (values != NULL)
+      values[slot] = oldvalues[i];
+  }
+
+  cmem_free(&(tbl->allocator), oldctrl, oldcap);
+  cmem_free(&(tbl->allocator), oldslots, oldcap * sizeof(void *));
+  cmem_free(&(tbl->allocator), oldvalues, oldcap * sizeof(void *));
+  ctrace_resize(tbl, oldcap, cap, start);
+  return 0;
+}
+
+/*****************************************************************************/
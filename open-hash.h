@@ -0,0 +1,50 @@
+/******************************************************************************
+ * NAME:	    open-hash.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Internal interface of the open-addressing engine. These
+ *		    functions are called by the CHash API when a table was
+ *		    created with CHASH_ENGINE_OPEN, and are not meant to be
+ *		    called directly.
+ *
+ * CREATED:	    10/14/2026
+ *
+ * LAST EDITED:	    10/14/2026
+ ***/
+
+#ifndef __ET_OPEN_HASH_H__
+#define __ET_OPEN_HASH_H__
+
+/******************************************************************************
+ * INCLUDES
+ ***/
+
+#include "chain-hash.h"
+#include "chash-internal.h"
+
+/******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Number of slots whose control bytes are scanned together. */
+#define OHASH_GROUP 16
+
+/******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+extern int ohash_init(CHash * table, unsigned int size);
+extern int ohash_put(CHash * table, void ** data, CHashPutMode mode,
+		     void * value);
+extern int ohash_remove(CHash * table, void ** data);
+extern int ohash_lookup(CHash * table, void ** data, void ** value);
+extern void ohash_traverse(CHash * table, void (*callback)(void *));
+extern uint64_t ohash_scan(CHash * table, uint64_t cursor,
+			   void (*callback)(void *, void *), void * arg);
+extern void ohash_destroy(CHash * table);
+extern void ohash_stats(CHash * table, CHashStats * stats);
+
+#endif /* __ET_OPEN_HASH_H__ */
+
+/*****************************************************************************/